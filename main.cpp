@@ -5,7 +5,9 @@
 #include <cstdio>
 #include <exception>
 #include <stdexcept>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 int main()
 {
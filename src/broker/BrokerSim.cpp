@@ -138,7 +138,12 @@ namespace broker
         const float sl = slippage_price();
 
         float fill_price = mid_price;
-        if (side == Side::Buy)
+        if (has_quote())
+        {
+            // Cross the quoted spread instead of the modelled one.
+            fill_price = (side == Side::Buy) ? ask_ + sl : bid_ - sl;
+        }
+        else if (side == Side::Buy)
         {
             fill_price = mid_price + hs + sl;
         }
@@ -9,7 +9,9 @@ namespace broker
 
     // FX-only, netting model (single net position per symbol).
     // Prices are treated as "mid" prices coming from your tape (e.g., bar.close).
-    // Fills apply spread/2 + slippage on top of mid.
+    // Fills apply spread/2 + slippage on top of mid, unless a bid/ask quote is
+    // set (set_quote), in which case buys fill at ask + slippage and sells at
+    // bid - slippage.
 
     enum class Side
     {
@@ -144,6 +146,20 @@ namespace broker
 
         void set_bar_index(int32_t i) { bar_index_ = i; }
 
+        // Quote in force for the next orders, e.g. the last tick at or before
+        // the order time (datahandler::TickReader::quote_at). Stays in force
+        // until replaced or cleared; without one, fills fall back to the
+        // CostsModel spread around mid.
+        void set_quote(int64_t ts, float bid, float ask)
+        {
+            quote_ts_ = ts;
+            bid_ = bid;
+            ask_ = ask;
+        }
+        void clear_quote() { bid_ = ask_ = NAN; }
+        bool has_quote() const { return !std::isnan(bid_) && !std::isnan(ask_); }
+        int64_t quote_ts() const { return quote_ts_; }
+
     private:
         uint64_t exec(Side side, int64_t ts, float mid_price, float lots);
 
@@ -213,6 +229,9 @@ namespace broker
         float avg_entry_ = NAN;      // valid if position_lots_ != 0
 
         float last_mid_ = NAN;
+        int64_t quote_ts_ = 0;
+        float bid_ = NAN;
+        float ask_ = NAN;
         uint64_t next_fill_id_ = 1;
         std::vector<Fill> fills_;
     };
@@ -1,18 +1,25 @@
 #include "data/TapeReader.hpp"
+#include "data/BarArena.hpp"
+#include "features/FeatureCache.h"
 #include "features/FeatureManager.h"
 #include "broker/BrokerSim.h"
 #include "core/EngineCtxBridge.h"
 #include "strategy/PluginLoader.h"
 #include "results/RunRecorder.h"
 #include "features/RunPackWriter.h"
+#include "data/CalendarIndex.hpp"
 #include "data/DateUtils.hpp"
+#include "data/TapeCatalog.hpp"
 #include "data/TapeTypes.hpp"
+#include "data/TickReader.hpp"
+#include <memory>
 #include <cstdio>
 #include <exception>
 #include <stdexcept>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <iostream>
-#include <fstream>
 #include <cstring>
 
 using namespace datahandler;
@@ -21,60 +28,6 @@ using namespace features;
 #define PRINT_LAST(name, vec, fmt) \
     std::printf("%-30s : " fmt "\n", name, (vec).back())
 
-static bool compute_time_range(const std::string &base_dir,
-                               const std::string &symbol,
-                               const std::string &timeframe,
-                               int start_ymd,
-                               int end_ymd,
-                               uint64_t &out_start_ts,
-                               uint64_t &out_end_ts)
-{
-    bool have_start = false;
-    uint64_t first_ts = 0;
-    uint64_t last_ts = 0;
-
-    int day = start_ymd;
-    while (day <= end_ymd)
-    {
-        std::string path = make_tape_path(base_dir, symbol, timeframe, day);
-        day = next_day(day);
-
-        if (!file_exists(path))
-            continue;
-
-        std::ifstream f(path, std::ios::binary);
-        if (!f)
-            continue;
-
-        TapeHeader hdr{};
-        f.read(reinterpret_cast<char *>(&hdr), sizeof(TapeHeader));
-        if (!f)
-            continue;
-
-        if (std::memcmp(hdr.magic, "TAPEv001", 8) != 0 ||
-            hdr.version != 1 ||
-            hdr.record_type != 2 ||
-            hdr.record_size != sizeof(Bar1m))
-        {
-            continue;
-        }
-
-        if (!have_start)
-        {
-            have_start = true;
-            first_ts = hdr.start_ts_ns;
-        }
-        last_ts = hdr.end_ts_ns;
-    }
-
-    if (!have_start)
-        return false;
-
-    out_start_ts = first_ts;
-    out_end_ts = last_ts;
-    return true;
-}
-
 class BacktestRunner
 {
 public:
@@ -109,11 +62,15 @@ public:
             const std::string timeframe = "1m";
             const int start_ymd = 20000101;
             const int end_ymd = 20251231;
+            auto catalog = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
             TapeReader reader(base_dir, symbol, timeframe, start_ymd, end_ymd);
+            reader.set_catalog(catalog);
+            reader.set_calendar(CalendarIndex::load_or_build(base_dir, symbol, timeframe, catalog));
+            reader.set_prefetch_depth(4);
 
             uint64_t data_start_ts = 0;
             uint64_t data_end_ts = 0;
-            bool has_time_range = compute_time_range(base_dir, symbol, timeframe, start_ymd, end_ymd, data_start_ts, data_end_ts);
+            bool has_time_range = catalog->time_range(start_ymd, end_ymd, data_start_ts, data_end_ts);
             uint64_t ts_span = (has_time_range && data_end_ts > data_start_ts) ? (data_end_ts - data_start_ts) : 0;
             int last_progress_pct = 0;
 
@@ -127,13 +84,32 @@ public:
 
             // Create Metrics Tracker
             RunRecorder rec({100000.0f, 252 * 24 * 60});
-            size_t expected_bars = (end_ymd - start_ymd + 1) * 24 * 60; // lol stack overflow incoming
+            size_t expected_bars = static_cast<size_t>(catalog->record_count(start_ymd, end_ymd));
             const size_t HARD_CAP = 50000000; // pick a sane ceiling for your machine
             expected_bars = std::min(expected_bars, HARD_CAP);
             rec.reserve(expected_bars, 5000);
 
             br.set_on_closed_trade(&on_closed_trade_cb, &rec);
 
+            // Bid/ask ticks, when the symbol has them for the range: orders then
+            // fill against the last quote before the bar closes instead of the
+            // modelled spread.
+            std::unique_ptr<TickReader> ticks;
+            auto tick_catalog = TapeCatalog::load_or_build(base_dir, symbol, TICK_TIMEFRAME);
+            if (!tick_catalog->range(start_ymd, end_ymd).empty())
+            {
+                ticks = std::make_unique<TickReader>(base_dir, symbol, start_ymd, end_ymd);
+                ticks->set_catalog(tick_catalog);
+                std::printf("Tick quotes: %llu ticks\n",
+                            static_cast<unsigned long long>(tick_catalog->record_count(start_ymd, end_ymd)));
+            }
+            const uint64_t BAR_NS = 60ull * 1000000000ull;
+            // A quote older than this (a gap in the tick tapes, a weekend) no
+            // longer says where the market is; those bars use the modelled spread.
+            const uint64_t MAX_QUOTE_AGE_NS = 5ull * 60ull * 1000000000ull;
+            Tick quote{};
+            uint64_t stale_quote_bars = 0;
+
             // Create feature manager
             FeatureManager fm;
 
@@ -142,6 +118,13 @@ public:
             user.feats = &fm;
             user.broker = &br;
 
+            // Start a few hundred bars early so EMA/ATR are warm at the first traded bar.
+            // Warmup bars only feed features; broker, recorder and strategy skip them.
+            const uint64_t WARMUP_BARS = 500;
+
+            // Feature columns hold every bar of the run, allocated once when bound.
+            user.feature_capacity = static_cast<size_t>(catalog->record_count(start_ymd, end_ymd) + WARMUP_BARS);
+
             EngineCtx ctx{};
             init_engine_ctx(ctx, user);
 
@@ -153,21 +136,124 @@ public:
 
             plugin.on_start(&ctx);
 
-            // Create Indicators
-            auto ema50 = fm.require_ema(50);
-            auto atr14 = fm.require_atr(14);
+            // Features served to plugins that still call get_feature, bound after
+            // on_start so they get the ring size the strategy asked for.
+            bind_feature(user, FEAT_EMA, 50);
+            bind_feature(user, FEAT_ATR, 14);
+            std::printf("Bound features: %zu\n", user.columns.size());
+            if (user.feature_window > 0)
+                std::printf("Feature lookback: %zu bars\n", user.feature_window);
+
+            // Read the run from a BarArena instead of streaming the tapes: the
+            // range (warmup days included) is loaded into memory once and
+            // shared with every other run of it in this process.
+            const bool USE_BAR_ARENA = false;
+            std::shared_ptr<const BarArena> arena;
+            std::unique_ptr<ArenaReader> arena_reader;
+            if (USE_BAR_ARENA)
+            {
+                arena = BarArena::acquire(base_dir, symbol, timeframe,
+                                          catalog->warmup_start(start_ymd, WARMUP_BARS), end_ymd);
+                arena_reader = std::make_unique<ArenaReader>(arena);
+                std::printf("Bar arena: %llu bars, %zu bytes\n",
+                            static_cast<unsigned long long>(arena->bar_count()), arena->bytes());
+            }
 
-            // ensure caches exist
-            user.ema_cache[50] = {};
-            user.atr_cache[14] = {};
+            const uint64_t start_ts = static_cast<uint64_t>(days_from_civil(start_ymd / 10000, (start_ymd / 100) % 100, start_ymd % 100)) * 86400ull * 1000000000ull;
+            uint64_t warmup = 0;
+            if (arena_reader)
+                arena_reader->seek_with_warmup(start_ts, WARMUP_BARS, warmup);
+            else
+                reader.seek_with_warmup(start_ts, WARMUP_BARS, warmup);
+            std::printf("Warmup bars: %llu\n", static_cast<unsigned long long>(warmup));
+
+            // Compute the bound features for the whole run up front, in one extra
+            // pass over the tapes, instead of bar by bar inside the run loop.
+            // Columns an earlier run (in any process) computed over the same
+            // tapes, range and warmup are mapped from the feature cache instead.
+            // Ring columns (a strategy set a lookback) can't hold the run, so
+            // they are streamed unless the cache has them.
+            const bool PRECOMPUTE_FEATURES = true;
+            const bool CACHE_FEATURES = true;
+            FeatureCache feature_cache(base_dir + "/feature_cache");
+            FeatureCacheKey cache_range;
+            cache_range.symbol = symbol;
+            cache_range.timeframe = timeframe;
+            cache_range.start_ymd = start_ymd;
+            cache_range.end_ymd = end_ymd;
+            cache_range.warmup_bars = WARMUP_BARS;
+            // Only the tapes this run reads, warmup days included: a tape
+            // rebuilt among them changes the key, a day added elsewhere doesn't.
+            cache_range.catalog_fingerprint =
+                catalog->fingerprint(catalog->warmup_start(start_ymd, WARMUP_BARS), end_ymd);
+            if (PRECOMPUTE_FEATURES && CACHE_FEATURES && !user.columns.empty())
+            {
+                const size_t mapped = load_cached_features(user, feature_cache, cache_range);
+                std::printf("Feature cache: %zu of %zu columns mapped\n", mapped, user.columns.size());
+            }
+            if (PRECOMPUTE_FEATURES && user.feature_window == 0 && features_streaming(user))
+            {
+                std::unique_ptr<TapeReader> pre;
+                std::unique_ptr<ArenaReader> pre_arena;
+                uint64_t pre_warmup = 0;
+                if (arena)
+                {
+                    pre_arena = std::make_unique<ArenaReader>(arena);
+                    pre_arena->seek_with_warmup(start_ts, WARMUP_BARS, pre_warmup);
+                }
+                else
+                {
+                    pre = std::make_unique<TapeReader>(base_dir, symbol, timeframe, start_ymd, end_ymd);
+                    pre->set_catalog(catalog);
+                    pre->set_prefetch_depth(4);
+                    pre->seek_with_warmup(start_ts, WARMUP_BARS, pre_warmup);
+                }
+
+                const bool need_open = fm.find("open").id >= 0;
+                const bool need_volume = fm.find("volume").id >= 0;
+                std::vector<float> open, high, low, close, volume;
+                high.reserve(user.feature_capacity);
+                low.reserve(user.feature_capacity);
+                close.reserve(user.feature_capacity);
+                BarColumns pc;
+                while (pre_arena ? pre_arena->nextColumns(pc) : pre->nextColumns(pc))
+                {
+                    if (need_open)
+                        open.insert(open.end(), pc.open, pc.open + pc.size);
+                    high.insert(high.end(), pc.high, pc.high + pc.size);
+                    low.insert(low.end(), pc.low, pc.low + pc.size);
+                    close.insert(close.end(), pc.close, pc.close + pc.size);
+                    if (need_volume)
+                        volume.insert(volume.end(), pc.volume, pc.volume + pc.size);
+                }
+
+                FeatureInputs cols;
+                cols.open = need_open ? open.data() : nullptr;
+                cols.high = high.data();
+                cols.low = low.data();
+                cols.close = close.data();
+                cols.volume = need_volume ? volume.data() : nullptr;
+                cols.n = close.size();
+                precompute_features(user, cols);
+                std::printf("Precomputed feature columns over %zu bars\n", cols.n);
+                if (CACHE_FEATURES)
+                {
+                    const size_t stored = store_cached_features(user, feature_cache, cache_range, cols.n);
+                    std::printf("Feature cache: stored %zu columns\n", stored);
+                }
+            }
+            const bool stream_features = features_streaming(user);
 
             size_t i = 0;
-            Bar1m bar{};
-            while (reader.nextBar(bar))
+            bool stop = false;
+            BarBatch batch;
+            while (!stop && (arena_reader ? arena_reader->nextBatch(batch) : reader.nextBatch(batch)))
             {
-                if (ts_span > 0 && bar.ts_ns >= data_start_ts)
+                // Progress once per batch (one day of bars), not per bar.
+                const uint64_t batch_ts = batch[0].ts_ns;
+                if (ts_span > 0 && batch_ts >= data_start_ts)
                 {
-                    uint64_t num = bar.ts_ns - data_start_ts;
+                    uint64_t num = batch_ts - data_start_ts;
                     double progress = static_cast<double>(num) / static_cast<double>(ts_span);
                     if (progress < 0.0)
                         progress = 0.0;
@@ -177,59 +263,88 @@ public:
                     if (pct >= last_progress_pct + 1 && pct <= 100)
                     {
                         last_progress_pct = pct;
-                        std::printf("Progress: %3d%% (ts=%llu)\n", pct, static_cast<unsigned long long>(bar.ts_ns));
+                        std::printf("Progress: %3d%% (ts=%llu)\n", pct, static_cast<unsigned long long>(batch_ts));
                     }
                 }
 
-                if (i == 0)
-                    std::cout << "CALLING on_bar at i=0\n";
-                // update ctx bar
-                ctx.bar.ts = bar.ts_ns;
-                ctx.bar.open = bar.open;
-                ctx.bar.high = bar.high;
-                ctx.bar.low = bar.low;
-                ctx.bar.close = bar.close;
-                ctx.bar.volume = bar.volume;
-                ctx.bar.index = i;
-
-                // update features & broker
-                fm.update(bar.open, bar.high, bar.low, bar.close, bar.volume);
-                br.on_bar(bar.ts_ns, bar.close);
-
-                if (br.account_blown())
+                for (const Bar1m &bar : batch)
                 {
-                    std::cout << "Account blown at bar " << i << std::endl;
-                    break;
-                }
+                    if (i < warmup)
+                    {
+                        if (stream_features)
+                            fm.update(bar.open, bar.high, bar.low, bar.close, bar.volume);
+                        record_features(user);
+                        ++i;
+                        continue;
+                    }
 
-                const bool in_market = (br.position_lots() != 0.0f);
-                rec.on_bar(bar.ts_ns, br.balance(), br.equity(), br.unrealized_pnl(), in_market);
-                br.set_bar_index((int)i);
+                    if (i == warmup)
+                        std::cout << "CALLING on_bar at i=" << i << "\n";
+                    // update ctx bar (read straight from the mapped record)
+                    ctx.bar.ts = bar.ts_ns;
+                    ctx.bar.open = bar.open;
+                    ctx.bar.high = bar.high;
+                    ctx.bar.low = bar.low;
+                    ctx.bar.close = bar.close;
+                    ctx.bar.volume = bar.volume;
+                    ctx.bar.index = i;
+
+                    // update features & broker
+                    if (stream_features)
+                        fm.update(ctx.bar.open, ctx.bar.high, ctx.bar.low, ctx.bar.close, ctx.bar.volume);
+                    br.on_bar(ctx.bar.ts, ctx.bar.close);
+
+                    if (br.account_blown())
+                    {
+                        std::cout << "Account blown at bar " << i << std::endl;
+                        stop = true;
+                        break;
+                    }
 
-                // append feature values to arrays (NaN until ready)
-                user.ema_cache[50].push_back(ema50.stream->ready ? ema50.stream->value : NAN);
-                user.atr_cache[14].push_back(atr14.stream->ready ? atr14.stream->value : NAN);
+                    const bool in_market = (br.position_lots() != 0.0f);
+                    rec.on_bar(ctx.bar.ts, br.balance(), br.equity(), br.unrealized_pnl(), in_market);
+                    br.set_bar_index((int)i);
 
-                auto fr = ctx.get_feature(&ctx, FEAT_EMA, 50);
-                if (i == 0)
-                {
-                    std::cout << "EMA FeatureRef: data=" << (void *)fr.data << " len=" << fr.len << "\n";
-                }
-                if (i == 200)
-                {
-                    std::cout << "EMA[200]=" << fr.data[200] << "\n";
-                }
+                    // append feature values to the columns (NaN until ready)
+                    record_features(user);
 
-                // call strategy
-                plugin.on_bar(&ctx);
+                    if (ticks)
+                    {
+                        const uint64_t bar_end = bar.ts_ns + BAR_NS - 1;
+                        const bool have_quote = ticks->quote_at(bar_end, quote);
+                        if (have_quote && quote.ts_ns + MAX_QUOTE_AGE_NS >= bar_end)
+                        {
+                            br.set_quote(static_cast<int64_t>(quote.ts_ns), static_cast<float>(quote.bid), static_cast<float>(quote.ask));
+                        }
+                        else
+                        {
+                            if (have_quote && stale_quote_bars++ == 0)
+                                std::printf("Stale quote at ts=%llu (%llus old), using the modelled spread\n",
+                                            static_cast<unsigned long long>(bar_end),
+                                            static_cast<unsigned long long>((bar_end - quote.ts_ns) / 1000000000ull));
+                            br.clear_quote();
+                        }
+                    }
+
+                    // call strategy
+                    plugin.on_bar(&ctx);
 
-                ++i;
+                    ++i;
+                }
             }
 
             plugin.on_end(&ctx);
             auto m = br.metrics();
             std::printf("Metrics: bars=%d, balance=%.2f, equity=%.2f, max_equity=%.2f, net_profit=%.2f, total_trades=%d, max_balance=%.2f, max_drawdown=%.2f\n", m.bars, m.balance, m.equity, m.max_equity, m.net_profit, m.total_trades, m.max_balance, m.max_balance_dd);
 
+            if (stale_quote_bars > 0)
+                std::printf("Stale quotes: %llu bars had no tick within %llus of the close\n",
+                            static_cast<unsigned long long>(stale_quote_bars),
+                            static_cast<unsigned long long>(MAX_QUOTE_AGE_NS / 1000000000ull));
+
+            std::printf("Tape I/O stall: %.3fs in %llu waits\n", reader.prefetch_stall_seconds(),
+                        static_cast<unsigned long long>(reader.prefetch_stalls()));
+
             rec.finalize();
             const auto &r = rec.series();
 
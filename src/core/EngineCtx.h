@@ -32,7 +32,18 @@ extern "C"
     {
         FEAT_EMA = 1,
         FEAT_ATR = 2,
-        // later: RSI, SMA, STD, ZSCORE, HH, LL...
+        FEAT_RSI = 3,    // Wilder RSI of close, 0-100
+        FEAT_SMA = 4,    // mean of the last period closes
+        FEAT_STD = 5,    // population stddev of the last period closes
+        FEAT_ZSCORE = 6, // (close - SMA) / STD
+        FEAT_HH = 7,     // highest high of the last period bars
+        FEAT_LL = 8,     // lowest low of the last period bars
+
+        // Not a feature: get_feature(ctx, FEAT_CTX_SIZE, 0).len is the
+        // sizeof(EngineCtx) the engine was built with. Engines that predate it
+        // return {NULL, 0} like for any unknown type, so a plugin can tell
+        // which of the fields added after v1 exist (ENGINE_CTX_HAS).
+        FEAT_CTX_SIZE = 0,
     };
 
     struct EngineCtx;
@@ -49,6 +60,38 @@ extern "C"
     typedef float (*FnPositionLots)(EngineCtx *ctx);
     typedef float (*FnAvgEntry)(EngineCtx *ctx);
 
+    // Feature binding: a strategy requires its features once in on_start and
+    // keeps the handle. Returns -1 for an unknown type or malformed spec.
+    typedef int (*FnRequireFeature)(EngineCtx *ctx, int feature_type, int period);
+    typedef int (*FnRequireFeatureSpec)(EngineCtx *ctx, const char *spec);
+    // Column of a handle, indexed by bar.index. The pointer is stable from
+    // on_start (once any lookback is set) to on_end. Precomputed and cached columns already hold every
+    // bar of the run, but only entries [0, bar.index] may be read: the rest
+    // lie in the future of the current bar.
+    typedef const float *(*FnFeatureData)(EngineCtx *ctx, int handle);
+    // Bounded lookback: a strategy that only reads the last bars of its
+    // features declares how many in on_start, before the first bar. The engine
+    // then keeps each column in a ring of that many bars (rounded up to a
+    // power of two and at least a few pages, returned; -1 when too late or
+    // the system can't map rings, the columns then keep the whole run).
+    // feature_data and get_feature still index ring columns by bar: data[i]
+    // is bar i for the last window bars before len, and an older i reads the
+    // newer bar in its slot. feature_ring gives the same values.
+    typedef int (*FnSetFeatureLookback)(EngineCtx *ctx, int bars);
+
+    // Column view that covers ring columns too: bar i is base[i & mask], for
+    // the last mask + 1 bars before len. Full-history columns have mask
+    // SIZE_MAX, so base[i] works for every i < len. base is null for a bad
+    // handle. Once the lookback is set, base and mask hold from on_start to
+    // on_end; len is the bars recorded when the view was taken.
+    struct FeatureRing
+    {
+        const float *base;
+        size_t mask;
+        size_t len;
+    };
+    typedef FeatureRing (*FnFeatureRing)(EngineCtx *ctx, int handle);
+
     // Opaque context passed into strategies
     struct EngineCtx
     {
@@ -69,6 +112,24 @@ extern "C"
 
         // Engine-owned pointer (strategy MUST NOT touch)
         void *user;
+
+        // Added after v1 and kept at the end so older plugins see the same
+        // layout; they keep using get_feature. An older engine's EngineCtx
+        // ends before them, so a plugin checks ENGINE_CTX_HAS before reading one.
+        FnRequireFeature require_feature;
+        FnRequireFeatureSpec require_feature_spec;
+        FnFeatureData feature_data;
+        FnSetFeatureLookback set_feature_lookback;
+        FnFeatureRing feature_ring;
     };
 
+    // Bytes of EngineCtx the engine provides (see FEAT_CTX_SIZE).
+    static inline size_t engine_ctx_size(EngineCtx *ctx)
+    {
+        return ctx->get_feature(ctx, FEAT_CTX_SIZE, 0).len;
+    }
+
+#define ENGINE_CTX_HAS(ctx, field) \
+    (engine_ctx_size(ctx) >= offsetof(EngineCtx, field) + sizeof((ctx)->field))
+
 } // extern "C"
@@ -1,34 +1,316 @@
 #include "core/EngineCtxBridge.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
 
 static inline EngineUserState *U(EngineCtx *ctx)
 {
     return reinterpret_cast<EngineUserState *>(ctx->user);
 }
 
-static FeatureRef ctx_get_feature(EngineCtx *ctx, int feature_type, int period)
+// Spec of a FEAT_* feature, empty when the type is unknown.
+static std::string feature_spec(int feature_type, int period)
 {
-    auto *u = U(ctx);
+    if (period <= 0)
+        return {};
+    switch (feature_type)
+    {
+    case FEAT_EMA:
+        return "ema(close," + std::to_string(period) + ")";
+    case FEAT_ATR:
+        return "atr(" + std::to_string(period) + ")";
+    case FEAT_RSI:
+        return "rsi(close," + std::to_string(period) + ")";
+    case FEAT_SMA:
+        return "sma(close," + std::to_string(period) + ")";
+    case FEAT_STD:
+        return "std(close," + std::to_string(period) + ")";
+    case FEAT_ZSCORE:
+        return "zscore(close," + std::to_string(period) + ")";
+    case FEAT_HH:
+        return "highest(high," + std::to_string(period) + ")";
+    case FEAT_LL:
+        return "lowest(low," + std::to_string(period) + ")";
+    default:
+        return {};
+    }
+}
+
+// A NaN-filled ring of window bars mirrored over the run's capacity.
+static bool open_ring(features::MirroredRing &ring, size_t window, size_t capacity)
+{
+    if (!ring.open(window, capacity))
+        return false;
+    std::fill(ring.data(), ring.data() + window, NAN);
+    return true;
+}
+
+static int bind_column(EngineUserState &user, features::FeatureHandle feature, int feature_type, int period)
+{
+    for (size_t i = 0; i < user.columns.size(); ++i)
+    {
+        FeatureColumn &c = user.columns[i];
+        if (c.feature.id == feature.id)
+        {
+            if (c.feature_type == 0)
+            {
+                c.feature_type = feature_type;
+                c.period = period;
+            }
+            return static_cast<int>(i);
+        }
+    }
+    // Columns only start at bar 0; a strategy can't bind mid-run.
+    if (user.feature_len > 0)
+        return -1;
 
-    if (feature_type == FEAT_EMA)
+    FeatureColumn c;
+    c.feature = feature;
+    c.feature_type = feature_type;
+    c.period = period;
+    if (user.feature_window > 0)
     {
-        auto it = u->ema_cache.find(period);
-        if (it == u->ema_cache.end())
-            return {nullptr, 0};
-        return {it->second.data(), it->second.size()};
+        if (!open_ring(c.ring, user.feature_window, user.feature_capacity))
+            return -1;
     }
-    if (feature_type == FEAT_ATR)
+    else
+        c.data.assign(user.feature_capacity, NAN);
+    user.columns.push_back(std::move(c));
+    return static_cast<int>(user.columns.size()) - 1;
+}
+
+int bind_feature(EngineUserState &user, int feature_type, int period)
+{
+    const std::string spec = feature_spec(feature_type, period);
+    if (spec.empty())
+        return -1;
+    return bind_column(user, user.feats->require(spec), feature_type, period);
+}
+
+int bind_feature(EngineUserState &user, const std::string &spec)
+{
+    features::FeatureHandle h;
+    try
     {
-        auto it = u->atr_cache.find(period);
-        if (it == u->atr_cache.end())
-            return {nullptr, 0};
-        return {it->second.data(), it->second.size()};
+        h = user.feats->require(spec);
     }
+    catch (const std::runtime_error &)
+    {
+        return -1;
+    }
+    return bind_column(user, h, 0, 0);
+}
 
+int set_feature_lookback(EngineUserState &user, int bars)
+{
+    if (bars <= 0 || bars > (1 << 30) || user.feature_len > 0)
+        return -1;
+    size_t window = features::MirroredRing::min_window(user.feature_capacity);
+    while (window < static_cast<size_t>(bars))
+        window <<= 1;
+    if (window <= user.feature_window)
+        return static_cast<int>(user.feature_window);
+    if (window > (1u << 30))
+        return -1;
+
+    // Map every ring first, so a failure leaves the columns as they were.
+    std::vector<features::MirroredRing> rings(user.columns.size());
+    for (size_t k = 0; k < rings.size(); ++k)
+    {
+        // Mapped columns cost no heap; they keep the whole run.
+        if (!user.columns[k].cached.is_open() && !open_ring(rings[k], window, user.feature_capacity))
+            return -1;
+    }
+
+    user.feature_window = window;
+    for (size_t k = 0; k < rings.size(); ++k)
+    {
+        FeatureColumn &c = user.columns[k];
+        if (c.cached.is_open())
+            continue;
+        c.ring = std::move(rings[k]);
+        std::vector<float>().swap(c.data);
+        c.precomputed = false;
+    }
+    return static_cast<int>(window);
+}
+
+static bool is_ring(const EngineUserState &user, const FeatureColumn &c)
+{
+    return user.feature_window > 0 && !c.cached.is_open();
+}
+
+static FeatureRing column_ring(const EngineUserState &user, const FeatureColumn &c)
+{
+    const size_t mask = is_ring(user, c) ? user.feature_window - 1 : SIZE_MAX;
+    return {c.values(), mask, user.feature_len};
+}
+
+const float *feature_column_data(const EngineUserState &user, int handle)
+{
+    if (handle < 0 || static_cast<size_t>(handle) >= user.columns.size())
+        return nullptr;
+    return user.columns[static_cast<size_t>(handle)].values();
+}
+
+FeatureRing feature_column_ring(const EngineUserState &user, int handle)
+{
+    if (handle < 0 || static_cast<size_t>(handle) >= user.columns.size())
+        return {nullptr, 0, 0};
+    return column_ring(user, user.columns[static_cast<size_t>(handle)]);
+}
+
+void record_features(EngineUserState &user)
+{
+    // A ring is only mirrored over feature_capacity bars.
+    const size_t window = user.feature_window;
+    if (user.feature_len >= user.feature_capacity)
+    {
+        if (user.columns.empty())
+            return;
+        throw std::runtime_error("Feature columns full at bar " + std::to_string(user.feature_len));
+    }
+    const float *values = user.feats->graph().values();
+    const size_t i = user.feature_len++;
+    const size_t slot = window ? (i & (window - 1)) : i;
+    for (FeatureColumn &c : user.columns)
+    {
+        if (c.precomputed)
+        {
+            if (i >= c.filled)
+                throw std::runtime_error("Precomputed feature column ends at bar " + std::to_string(i));
+            continue;
+        }
+        if (c.ring.is_open())
+            c.ring.data()[slot] = values[c.feature.id];
+        else
+            c.data[slot] = values[c.feature.id];
+    }
+}
+
+void precompute_features(EngineUserState &user, const features::FeatureInputs &bars, unsigned threads)
+{
+    if (user.feature_len > 0)
+        throw std::runtime_error("Features must be precomputed before the first bar");
+    if (bars.n > user.feature_capacity)
+        throw std::runtime_error("More bars than feature column capacity");
+    if (user.feature_window > 0)
+        throw std::runtime_error("Ring feature columns can't be precomputed");
+
+    const auto &graph = user.feats->graph();
+    std::vector<float *> out(graph.size(), nullptr);
+    for (FeatureColumn &c : user.columns)
+    {
+        if (!c.precomputed)
+            out[static_cast<size_t>(c.feature.id)] = c.data.data();
+    }
+    features::precompute_columns(graph, bars, out.data(), threads);
+    for (FeatureColumn &c : user.columns)
+    {
+        if (!c.precomputed)
+        {
+            c.precomputed = true;
+            c.filled = bars.n;
+        }
+    }
+}
+
+size_t load_cached_features(EngineUserState &user, features::FeatureCache &cache, features::FeatureCacheKey range)
+{
+    if (user.feature_len > 0)
+        throw std::runtime_error("Cached features must be loaded before the first bar");
+
+    size_t mapped = 0;
+    for (FeatureColumn &c : user.columns)
+    {
+        if (c.precomputed)
+            continue;
+        range.spec = user.feats->graph().spec(c.feature.id);
+        if (!cache.load(range, c.cached))
+            continue;
+        if (c.cached.size() > user.feature_capacity)
+        {
+            c.cached = features::CachedColumn();
+            continue;
+        }
+        std::vector<float>().swap(c.data); // the mapping replaces it
+        c.ring.close();
+        c.precomputed = true;
+        c.filled = c.cached.size();
+        ++mapped;
+    }
+    return mapped;
+}
+
+size_t store_cached_features(EngineUserState &user, features::FeatureCache &cache, features::FeatureCacheKey range,
+                             size_t n)
+{
+    size_t stored = 0;
+    for (const FeatureColumn &c : user.columns)
+    {
+        if (!c.precomputed || c.cached.is_open() || c.filled != n)
+            continue;
+        range.spec = user.feats->graph().spec(c.feature.id);
+        if (cache.store(range, c.data.data(), n))
+            ++stored;
+    }
+    return stored;
+}
+
+bool features_streaming(const EngineUserState &user)
+{
+    for (const FeatureColumn &c : user.columns)
+    {
+        if (!c.precomputed)
+            return true;
+    }
+    return false;
+}
+
+// Kept for plugins built before require_feature: a scan of the few bound
+// columns, no hashing or allocation.
+static FeatureRef ctx_get_feature(EngineCtx *ctx, int feature_type, int period)
+{
+    if (feature_type == FEAT_CTX_SIZE)
+        return {nullptr, sizeof(EngineCtx)};
+    auto *u = U(ctx);
+    for (const FeatureColumn &c : u->columns)
+    {
+        if (c.feature_type == feature_type && c.period == period)
+        {
+            return {c.values(), u->feature_len};
+        }
+    }
     return {nullptr, 0};
 }
 
+static int ctx_require_feature(EngineCtx *ctx, int feature_type, int period)
+{
+    return bind_feature(*U(ctx), feature_type, period);
+}
+
+static int ctx_require_feature_spec(EngineCtx *ctx, const char *spec)
+{
+    return spec ? bind_feature(*U(ctx), std::string(spec)) : -1;
+}
+
+static const float *ctx_feature_data(EngineCtx *ctx, int handle)
+{
+    return feature_column_data(*U(ctx), handle);
+}
+
+static int ctx_set_feature_lookback(EngineCtx *ctx, int bars)
+{
+    return set_feature_lookback(*U(ctx), bars);
+}
+
+static FeatureRing ctx_feature_ring(EngineCtx *ctx, int handle)
+{
+    return feature_column_ring(*U(ctx), handle);
+}
+
 static uint64_t ctx_buy_market(EngineCtx *ctx, float lots, float sl, float tp)
 {
     (void)sl;
@@ -72,6 +354,11 @@ static float ctx_avg_entry(EngineCtx *ctx)
 void init_engine_ctx(EngineCtx &ctx, EngineUserState &user)
 {
     ctx.get_feature = &ctx_get_feature;
+    ctx.require_feature = &ctx_require_feature;
+    ctx.require_feature_spec = &ctx_require_feature_spec;
+    ctx.feature_data = &ctx_feature_data;
+    ctx.set_feature_lookback = &ctx_set_feature_lookback;
+    ctx.feature_ring = &ctx_feature_ring;
 
     ctx.buy_market = &ctx_buy_market;
     ctx.sell_market = &ctx_sell_market;
@@ -1,18 +1,99 @@
 #pragma once
 #include "core/EngineCtx.h"
+#include "features/FeatureCache.h"
 #include "features/FeatureManager.h"
+#include "features/FeaturePrecompute.h"
+#include "features/MirroredRing.h"
 #include "broker/BrokerSim.h"
 
+#include <string>
 #include <vector>
-#include <unordered_map>
+
+// One bound feature: its graph node and the per-bar column strategies read.
+struct FeatureColumn
+{
+    features::FeatureHandle feature;
+    int feature_type = 0; // FEAT_* it was bound as, 0 for a spec
+    int period = 0;
+    std::vector<float> data;       // feature_capacity entries; empty when cached or a ring
+    features::CachedColumn cached; // the column mapped from the feature cache instead
+    features::MirroredRing ring;   // or the last feature_window bars, mirrored over the run
+    bool precomputed = false;      // values already hold the whole run
+    size_t filled = 0;             // bars precomputed
+
+    // Start of the column's storage, indexed by bar in every case.
+    const float *values() const
+    {
+        if (cached.is_open())
+            return cached.data();
+        return ring.is_open() ? ring.data() : data.data();
+    }
+};
 
 struct EngineUserState
 {
     features::FeatureManager *feats = nullptr;
     broker::BrokerSim *broker = nullptr;
 
-    std::unordered_map<int, std::vector<float>> ema_cache;
-    std::unordered_map<int, std::vector<float>> atr_cache;
+    // Columns are allocated at bind time with feature_capacity entries (the
+    // run's bar count, warmup included), so their pointers stay put. Handles
+    // are indices into columns.
+    //
+    // Once a strategy sets a lookback, streamed columns instead keep only the
+    // last feature_window bars (a power of two) in a ring, bar i at
+    // i & (window - 1). The ring's pages are mapped over feature_capacity
+    // bars of address space (MirroredRing), so the column pointer still
+    // works by bar: values()[i] is bar i for the last window bars, while an
+    // older i reads the newer bar sharing its slot.
+    size_t feature_capacity = 0;
+    size_t feature_window = 0; // 0: full history
+    size_t feature_len = 0;    // bars recorded so far
+    std::vector<FeatureColumn> columns;
 };
 
 void init_engine_ctx(EngineCtx &ctx, EngineUserState &user);
+
+// Engine side of the binding: bind_feature returns the handle of the column
+// for a FEAT_* type and period (or a FeatureGraph spec), reusing the column
+// when the same feature is already bound, or -1 when it isn't recognised or
+// bars have already been recorded.
+int bind_feature(EngineUserState &user, int feature_type, int period);
+int bind_feature(EngineUserState &user, const std::string &spec);
+
+// Switches to ring columns of at least bars entries (see feature_window;
+// MirroredRing::min_window may round it up further) and returns the window,
+// or -1 when bars <= 0, bars have already been recorded or the rings can't
+// be mapped, in which case the columns keep the whole run. Asking again
+// keeps the largest window.
+int set_feature_lookback(EngineUserState &user, int bars);
+
+// Column of a handle indexed by bar (within the window for a ring column);
+// null for a bad handle.
+const float *feature_column_data(const EngineUserState &user, int handle);
+
+// Column of a handle as base[i & mask] (see FeatureRing), ring or not.
+FeatureRing feature_column_ring(const EngineUserState &user, int handle);
+
+// Appends the current value of every bound feature that wasn't precomputed;
+// call once per bar after FeatureManager::update. Throws std::runtime_error
+// when feature_capacity bars have been recorded, ring or not.
+void record_features(EngineUserState &user);
+
+// Fills every bound column not already precomputed with the whole run
+// from its bars (warmup included, bars.n <= feature_capacity) before the
+// first bar, so the run loop only advances feature_len. Throws with ring
+// columns, which can't hold the run. See FeaturePrecompute.h for how the
+// values compare with the streamed ones.
+void precompute_features(EngineUserState &user, const features::FeatureInputs &bars, unsigned threads = 0);
+
+// Feature cache: load_cached_features maps every bound column the cache
+// holds for range (whose spec is filled in per column), as precomputed
+// columns, and returns how many it mapped. store_cached_features writes the
+// columns precompute_features computed over n bars and returns how many the
+// cache took. Both must run before the first bar.
+size_t load_cached_features(EngineUserState &user, features::FeatureCache &cache, features::FeatureCacheKey range);
+size_t store_cached_features(EngineUserState &user, features::FeatureCache &cache, features::FeatureCacheKey range,
+                             size_t n);
+
+// True while some bound column still needs FeatureManager::update each bar.
+bool features_streaming(const EngineUserState &user);
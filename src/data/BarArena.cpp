@@ -0,0 +1,335 @@
+#include "BarArena.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace datahandler {
+
+namespace {
+    void die_if(bool cond, const std::string& msg) {
+        if (cond) throw std::runtime_error(msg);
+    }
+
+    size_t round_up(size_t n, size_t align) { return (n + align - 1) / align * align; }
+
+    // One key of the registry. load_mu serialises loading the key; arena is
+    // read and written under Registry::mu.
+    struct Slot {
+        std::mutex load_mu;
+        std::weak_ptr<const BarArena> arena;
+    };
+
+    struct Registry {
+        std::mutex mu;
+        std::map<std::string, std::shared_ptr<Slot>> slots;
+
+        // Forgets keys whose arena is gone and that nobody is loading.
+        void prune() {
+            for (auto it = slots.begin(); it != slots.end();) {
+                if (it->second->arena.expired() && it->second.use_count() == 1)
+                    it = slots.erase(it);
+                else
+                    ++it;
+            }
+        }
+    };
+
+    Registry& registry() {
+        static Registry r;
+        return r;
+    }
+}
+
+std::shared_ptr<const BarArena> BarArena::acquire(const std::string& base_dir,
+                                                  const std::string& symbol,
+                                                  const std::string& timeframe,
+                                                  int start_ymd,
+                                                  int end_ymd,
+                                                  const ArenaOptions& options) {
+    die_if(end_ymd < start_ymd, "end date must be >= start date");
+    const std::string key = base_dir + '\n' + symbol + '\n' + timeframe + '\n' + std::to_string(start_ymd) + '\n' +
+                            std::to_string(end_ymd);
+
+    // A resident arena is handed out while its catalog is current, which only
+    // stats the year directories; the catalog is read (and rescanned if stale)
+    // only to load one.
+    Registry& reg = registry();
+    std::shared_ptr<Slot> slot;
+    std::shared_ptr<const BarArena> resident;
+    {
+        std::lock_guard<std::mutex> lock(reg.mu);
+        auto& s = reg.slots[key];
+        if (!s)
+            s = std::make_shared<Slot>();
+        resident = s->arena.lock();
+        slot = s;
+    }
+    if (resident && resident->catalog_->is_current(base_dir, symbol, timeframe))
+        return resident;
+
+    std::lock_guard<std::mutex> loading(slot->load_mu);
+    {
+        std::lock_guard<std::mutex> lock(reg.mu);
+        resident = slot->arena.lock();
+    }
+    if (resident && resident->catalog_->is_current(base_dir, symbol, timeframe))
+        return resident; // loaded while we waited
+    resident.reset();
+
+    auto catalog = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
+    std::shared_ptr<BarArena> arena(new BarArena());
+    arena->symbol_ = symbol;
+    arena->timeframe_ = timeframe;
+    arena->start_ymd_ = start_ymd;
+    arena->end_ymd_ = end_ymd;
+    arena->load(base_dir, catalog, options);
+
+    std::lock_guard<std::mutex> lock(reg.mu);
+    slot->arena = arena;
+    reg.prune();
+    return arena;
+}
+
+std::vector<ArenaInfo> BarArena::resident() {
+    Registry& reg = registry();
+    std::vector<ArenaInfo> out;
+    std::lock_guard<std::mutex> lock(reg.mu);
+    for (const auto& kv : reg.slots) {
+        auto arena = kv.second->arena.lock();
+        if (!arena)
+            continue;
+        ArenaInfo info;
+        info.symbol = arena->symbol_;
+        info.timeframe = arena->timeframe_;
+        info.start_ymd = arena->start_ymd_;
+        info.end_ymd = arena->end_ymd_;
+        info.bars = arena->bar_count_;
+        info.bytes = arena->mem_bytes_;
+        info.huge_pages = arena->huge_;
+        info.users = arena.use_count() - 1;
+        out.push_back(std::move(info));
+    }
+    return out;
+}
+
+size_t BarArena::resident_bytes() {
+    size_t bytes = 0;
+    for (const auto& info : resident())
+        bytes += info.bytes;
+    return bytes;
+}
+
+BarArena::~BarArena() {
+    if (!mem_)
+        return;
+#ifdef _WIN32
+    VirtualFree(mem_, 0, MEM_RELEASE);
+#else
+    ::munmap(mem_, mem_bytes_);
+#endif
+}
+
+void BarArena::allocate(uint64_t bars, bool huge_pages) {
+    if (bars == 0)
+        return;
+    const size_t bytes = static_cast<size_t>(bars) * sizeof(Bar1m);
+    die_if(bytes / sizeof(Bar1m) != bars, "Bar arena too large for the address space");
+
+#ifdef _WIN32
+    // Large pages need SeLockMemoryPrivilege; without it the call fails and
+    // normal pages are used.
+    const SIZE_T large = huge_pages ? GetLargePageMinimum() : 0;
+    if (large > 0) {
+        const size_t size = round_up(bytes, large);
+        mem_ = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (mem_) {
+            mem_bytes_ = size;
+            huge_ = true;
+        }
+    }
+    if (!mem_) {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        const size_t size = round_up(bytes, si.dwPageSize);
+        mem_ = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        die_if(!mem_, "VirtualAlloc failed for bar arena");
+        mem_bytes_ = size;
+    }
+#else
+#ifdef MAP_HUGETLB
+    // Explicit huge pages only exist when reserved (vm.nr_hugepages).
+    if (huge_pages) {
+        const size_t size = round_up(bytes, size_t{2} << 20);
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            mem_ = p;
+            mem_bytes_ = size;
+            huge_ = true;
+        }
+    }
+#endif
+    if (!mem_) {
+        const size_t size = round_up(bytes, static_cast<size_t>(::sysconf(_SC_PAGESIZE)));
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        die_if(p == MAP_FAILED, "mmap failed for bar arena");
+        mem_ = p;
+        mem_bytes_ = size;
+#ifdef MADV_HUGEPAGE
+        if (huge_pages)
+            huge_ = ::madvise(mem_, mem_bytes_, MADV_HUGEPAGE) == 0;
+#endif
+    }
+#endif
+    bars_ = static_cast<Bar1m*>(mem_);
+}
+
+void BarArena::load(const std::string& base_dir, std::shared_ptr<const TapeCatalog> catalog,
+                    const ArenaOptions& options) {
+    catalog_ = catalog;
+    fingerprint_ = catalog->fingerprint();
+    const uint64_t expected = catalog->record_count(start_ymd_, end_ymd_);
+    allocate(expected, options.huge_pages);
+    if (expected == 0)
+        return;
+
+    TapeReader reader(base_dir, symbol_, timeframe_, start_ymd_, end_ymd_);
+    reader.set_catalog(catalog);
+    if (options.prefetch_depth > 0)
+        reader.set_prefetch_depth(options.prefetch_depth);
+
+    uint64_t n = 0;
+    BarBatch batch;
+    while (reader.nextBatch(batch)) {
+        die_if(batch.size > expected - n, "Catalog record counts don't match the tapes; rebuild the catalog");
+        const int ymd = reader.current_day();
+        if (days_.empty() || days_.back().ymd != ymd)
+            days_.push_back(ArenaDay{ymd, 0, n});
+        std::memcpy(bars_ + n, batch.data, batch.size * sizeof(Bar1m));
+        days_.back().bars += static_cast<uint32_t>(batch.size);
+        n += batch.size;
+    }
+    die_if(n != expected, "Catalog record counts don't match the tapes; rebuild the catalog");
+    bar_count_ = n;
+    seal();
+}
+
+// Readers share the buffer across threads; make stray writes fault.
+void BarArena::seal() {
+#ifdef _WIN32
+    DWORD old = 0;
+    VirtualProtect(mem_, mem_bytes_, PAGE_READONLY, &old);
+#else
+    ::mprotect(mem_, mem_bytes_, PROT_READ);
+#endif
+}
+
+size_t BarArena::day_of_bar(uint64_t i) const {
+    auto it = std::upper_bound(days_.begin(), days_.end(), i,
+                               [](uint64_t bar, const ArenaDay& d) { return bar < d.first_bar; });
+    return it == days_.begin() ? 0 : static_cast<size_t>(it - days_.begin()) - 1;
+}
+
+uint64_t BarArena::lower_bound(uint64_t ts_ns) const {
+    const Bar1m* it = std::lower_bound(bars_, bars_ + bar_count_, ts_ns,
+                                       [](const Bar1m& b, uint64_t t) { return b.ts_ns < t; });
+    return static_cast<uint64_t>(it - bars_);
+}
+
+ArenaReader::ArenaReader(std::shared_ptr<const BarArena> arena)
+    : arena_(std::move(arena))
+{
+    die_if(!arena_, "ArenaReader needs an arena");
+}
+
+bool ArenaReader::nextBar(Bar1m& out) {
+    const auto& days = arena_->days();
+    while (day_ < days.size() && pos_ >= days[day_].first_bar + days[day_].bars)
+        ++day_;
+    if (day_ >= days.size())
+        return false;
+    out = arena_->bars()[pos_++];
+    cur_day_ = day_;
+    read_ = true;
+    return true;
+}
+
+bool ArenaReader::nextBatch(BarBatch& out) {
+    const auto& days = arena_->days();
+    while (day_ < days.size() && pos_ >= days[day_].first_bar + days[day_].bars)
+        ++day_;
+    if (day_ >= days.size())
+        return false;
+    const uint64_t end = days[day_].first_bar + days[day_].bars;
+    out.data = arena_->bars() + pos_;
+    out.size = static_cast<size_t>(end - pos_);
+    out.first_index = bars_read();
+    pos_ = end;
+    cur_day_ = day_;
+    read_ = true;
+    return true;
+}
+
+bool ArenaReader::nextColumns(BarColumns& out) {
+    BarBatch batch;
+    if (!nextBatch(batch))
+        return false;
+    const size_t n = batch.size;
+    col_ts_.resize(n);
+    col_px_.resize(4 * n);
+    col_vol_.resize(n);
+    double* o = col_px_.data();
+    double* h = o + n;
+    double* l = h + n;
+    double* c = l + n;
+    for (size_t i = 0; i < n; ++i) {
+        const Bar1m& r = batch.data[i];
+        col_ts_[i] = r.ts_ns;
+        o[i] = r.open;
+        h[i] = r.high;
+        l[i] = r.low;
+        c[i] = r.close;
+        col_vol_[i] = r.volume;
+    }
+    out.ts = col_ts_.data();
+    out.open = o;
+    out.high = h;
+    out.low = l;
+    out.close = c;
+    out.volume = col_vol_.data();
+    out.size = n;
+    out.first_index = batch.first_index;
+    return true;
+}
+
+bool ArenaReader::seek(uint64_t ts_ns) {
+    position(arena_->lower_bound(ts_ns));
+    origin_ = pos_;
+    return pos_ < arena_->bar_count();
+}
+
+bool ArenaReader::seek_with_warmup(uint64_t ts_ns, uint64_t warmup_bars, uint64_t& warmup_got) {
+    warmup_got = 0;
+    if (!seek(ts_ns))
+        return false;
+    warmup_got = std::min(pos_, warmup_bars);
+    position(pos_ - warmup_got);
+    origin_ = pos_;
+    return true;
+}
+
+void ArenaReader::position(uint64_t bar) {
+    pos_ = bar;
+    day_ = bar < arena_->bar_count() ? arena_->day_of_bar(bar) : arena_->days().size();
+}
+
+}  // namespace datahandler
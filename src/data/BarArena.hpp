@@ -0,0 +1,173 @@
+#pragma once
+
+#include "TapeReader.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace datahandler
+{
+
+    struct ArenaOptions
+    {
+        // Back the buffer with huge pages: explicit ones (MAP_HUGETLB /
+        // MEM_LARGE_PAGES) when the system has them reserved, else transparent
+        // huge pages on Linux. Best-effort; falls back to normal pages.
+        bool huge_pages = false;
+        size_t prefetch_depth = 4; // TapeReader prefetch depth used while loading
+    };
+
+    // One day of the arena: bars [first_bar, first_bar + bars).
+    struct ArenaDay
+    {
+        int32_t ymd;
+        uint32_t bars;
+        uint64_t first_bar;
+    };
+
+    // Resident arena, as listed by BarArena::resident().
+    struct ArenaInfo
+    {
+        std::string symbol;
+        std::string timeframe;
+        int start_ymd = 0;
+        int end_ymd = 0;
+        uint64_t bars = 0;
+        size_t bytes = 0;       // mapped, including rounding up to the page size
+        bool huge_pages = false;
+        long users = 0;         // shared_ptr owners outside the registry
+    };
+
+    // Every bar of a symbol/timeframe/date range in one contiguous, read-only
+    // buffer of Bar1m rows, loaded once per process and shared.
+    //
+    // acquire() goes through a process-wide registry keyed by base directory,
+    // symbol, timeframe and range. The registry holds weak references only:
+    // the arena lives as long as some caller keeps the returned shared_ptr,
+    // and a later acquire() after the last one is gone loads it again.
+    // Concurrent acquire() calls of the same key wait for one load; different
+    // keys load in parallel. A resident arena is only handed out while the
+    // catalog it was loaded from is current (TapeCatalog::is_current, a stat
+    // per year directory); once tapes are rewritten or added the next
+    // acquire() loads a fresh one, and holders of the old one keep it.
+    //
+    // Read it with ArenaReader, which has TapeReader's streaming API.
+    class BarArena
+    {
+    public:
+        ~BarArena();
+
+        BarArena(const BarArena &) = delete;
+        BarArena &operator=(const BarArena &) = delete;
+
+        // Shared arena of the range, loading it if no caller holds one.
+        // Options only apply to the caller that loads it. Throws
+        // std::runtime_error when the tapes can't be read or disagree with the
+        // catalog.
+        static std::shared_ptr<const BarArena> acquire(const std::string &base_dir,
+                                                       const std::string &symbol,
+                                                       const std::string &timeframe,
+                                                       int start_ymd,
+                                                       int end_ymd,
+                                                       const ArenaOptions &options = {});
+
+        // Arenas currently alive, and the bytes they hold.
+        static std::vector<ArenaInfo> resident();
+        static size_t resident_bytes();
+
+        const Bar1m *bars() const { return bars_; }
+        uint64_t bar_count() const { return bar_count_; }
+        const std::vector<ArenaDay> &days() const { return days_; }
+
+        // Day holding bar i, and the first bar with ts >= ts_ns (bar_count() if none).
+        size_t day_of_bar(uint64_t i) const;
+        uint64_t lower_bound(uint64_t ts_ns) const;
+
+        size_t bytes() const { return mem_bytes_; }
+        bool huge_pages() const { return huge_; }
+        uint64_t catalog_fingerprint() const { return fingerprint_; }
+        const std::string &symbol() const { return symbol_; }
+        const std::string &timeframe() const { return timeframe_; }
+        int start_date() const { return start_ymd_; }
+        int end_date() const { return end_ymd_; }
+
+    private:
+        BarArena() = default;
+
+        void allocate(uint64_t bars, bool huge_pages);
+        void load(const std::string &base_dir, std::shared_ptr<const TapeCatalog> catalog,
+                  const ArenaOptions &options);
+        void seal();
+
+        std::string symbol_;
+        std::string timeframe_;
+        int start_ymd_ = 0;
+        int end_ymd_ = 0;
+        uint64_t fingerprint_ = 0;
+        std::shared_ptr<const TapeCatalog> catalog_; // the one loaded from
+
+        void *mem_ = nullptr;
+        size_t mem_bytes_ = 0;
+        bool huge_ = false;
+        Bar1m *bars_ = nullptr;
+        uint64_t bar_count_ = 0;
+        std::vector<ArenaDay> days_;
+    };
+
+    // Streams a BarArena like TapeReader streams tapes: nextBar()/nextBatch()
+    // hand out zero-copy views of the arena, one day per batch, and
+    // nextColumns() the same day transposed into reader-owned columns. Readers
+    // are cheap and independent; any number can share one arena across
+    // threads. Warmup is limited to the bars the arena holds.
+    class ArenaReader
+    {
+    public:
+        explicit ArenaReader(std::shared_ptr<const BarArena> arena);
+
+        // Returns true if a bar was filled, false when no more bars.
+        bool nextBar(Bar1m &out);
+
+        // Rest of the current day in one view. Returns false when no more bars.
+        bool nextBatch(BarBatch &out);
+
+        // Rest of the current day as columns, valid until the next read call.
+        // Returns false when no more bars.
+        bool nextColumns(BarColumns &out);
+
+        // Number of bars handed out so far (run-wide index of the next bar).
+        uint64_t bars_read() const { return pos_ - origin_; }
+
+        // YYYYMMDD of the day the last bar/batch came from (0 before the first read).
+        int current_day() const { return read_ ? arena_->days()[cur_day_].ymd : 0; }
+
+        // Positions the reader on the first bar with ts_ns >= ts_ns. Resets
+        // bars_read() to 0. Returns false if no bar is at or after ts_ns.
+        bool seek(uint64_t ts_ns);
+
+        // seek(ts_ns), then backs up by up to warmup_bars bars of the arena.
+        bool seek_with_warmup(uint64_t ts_ns, uint64_t warmup_bars, uint64_t &warmup_got);
+
+        const std::shared_ptr<const BarArena> &arena() const { return arena_; }
+        const std::string &symbol() const { return arena_->symbol(); }
+        const std::string &timeframe() const { return arena_->timeframe(); }
+        int start_date() const { return arena_->start_date(); }
+        int end_date() const { return arena_->end_date(); }
+
+    private:
+        void position(uint64_t bar);
+
+        std::shared_ptr<const BarArena> arena_;
+        uint64_t pos_ = 0;    // arena index of the next bar
+        uint64_t origin_ = 0; // arena index of bars_read() == 0
+        size_t day_ = 0;      // day holding pos_ (or the last day at the end)
+        size_t cur_day_ = 0;  // day of the last bar handed out
+        bool read_ = false;
+
+        std::vector<uint64_t> col_ts_; // nextColumns() buffers
+        std::vector<double> col_px_;   // open|high|low|close, one day each
+        std::vector<float> col_vol_;
+    };
+
+} // namespace datahandler
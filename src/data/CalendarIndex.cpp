@@ -0,0 +1,204 @@
+#include "CalendarIndex.hpp"
+#include "DateUtils.hpp"
+#include "ResampleReader.hpp"
+#include "TapeReader.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace datahandler {
+
+namespace {
+    namespace fs = std::filesystem;
+
+    constexpr char CALENDAR_MAGIC[8] = {'C', 'A', 'L', 'v', '0', '0', '1', '\0'};
+    constexpr uint64_t NS_PER_MIN = 60ull * 1000000000ull;
+
+    void die_if(bool cond, const std::string& msg) {
+        if (cond) throw std::runtime_error(msg);
+    }
+
+    template <typename T>
+    bool read_vec(std::FILE* f, std::vector<T>& v, uint64_t n) {
+        v.resize(static_cast<size_t>(n));
+        return v.empty() || std::fread(v.data(), sizeof(T), v.size(), f) == v.size();
+    }
+
+    template <typename T>
+    void write_vec(std::ofstream& f, const std::vector<T>& v) {
+        f.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(T)));
+    }
+}
+
+void CalendarIndex::build(const std::string& base_dir,
+                          const std::string& symbol,
+                          const std::string& timeframe,
+                          std::shared_ptr<const TapeCatalog> catalog) {
+    // Cached resamples are named "<label>@<origin>"; the label sets the step.
+    const uint32_t minutes = timeframe_minutes(timeframe.substr(0, timeframe.find('@')));
+    die_if(minutes == 0, "Unrecognised timeframe: " + timeframe);
+
+    CalendarHeader hdr{};
+    std::memcpy(hdr.magic, CALENDAR_MAGIC, 8);
+    hdr.version = 1;
+    hdr.step_ns = minutes * NS_PER_MIN;
+    hdr.catalog_fingerprint = catalog->fingerprint();
+
+    const auto& entries = catalog->entries();
+    std::vector<CalendarDay> days;
+    days.reserve(entries.size());
+    for (const auto& e : entries) {
+        CalendarDay d{};
+        d.ymd = e.ymd;
+        d.first_bar = hdr.bar_count;
+        days.push_back(d);
+        hdr.bar_count += e.record_count;
+    }
+    hdr.day_count = static_cast<uint32_t>(days.size());
+
+    std::vector<uint64_t> words;
+    std::vector<uint32_t> bar_slots;
+    if (hdr.bar_count > 0) {
+        const uint64_t first_ts = entries.front().first_ts_ns;
+        const uint64_t last_ts = entries.back().last_ts_ns;
+        die_if(last_ts < first_ts, "Catalog time range is inverted");
+        hdr.phase_ns = first_ts % hdr.step_ns;
+        hdr.first_slot = first_ts / hdr.step_ns;
+        hdr.slot_count = (last_ts - first_ts) / hdr.step_ns + 1;
+        die_if(hdr.slot_count > UINT32_MAX, "Calendar grid too large for " + symbol + " " + timeframe);
+
+        words.assign(static_cast<size_t>((hdr.slot_count + 63) / 64), 0);
+        bar_slots.reserve(static_cast<size_t>(hdr.bar_count));
+
+        TapeReader reader(base_dir, symbol, timeframe, entries.front().ymd, entries.back().ymd);
+        reader.set_catalog(catalog);
+        reader.set_read_ahead(true);
+
+        uint64_t prev = 0;
+        BarBatch batch;
+        while (reader.nextBatch(batch)) {
+            for (const Bar1m& bar : batch) {
+                const uint64_t ts = bar.ts_ns;
+                die_if(ts % hdr.step_ns != hdr.phase_ns || ts < first_ts || ts > last_ts,
+                       "Bar off the " + timeframe + " grid in " + symbol + " " + std::to_string(reader.current_day()));
+                die_if(!bar_slots.empty() && ts <= prev,
+                       "Bars out of order in " + symbol + " " + std::to_string(reader.current_day()));
+                prev = ts;
+
+                const uint64_t s = ts / hdr.step_ns - hdr.first_slot;
+                words[static_cast<size_t>(s >> 6)] |= uint64_t{1} << (s & 63);
+                bar_slots.push_back(static_cast<uint32_t>(s));
+            }
+        }
+        die_if(bar_slots.size() != hdr.bar_count, "Catalog record counts don't match the tapes; rebuild the catalog");
+    }
+
+    std::vector<uint64_t> ranks(words.size());
+    uint64_t n = 0;
+    for (size_t w = 0; w < words.size(); ++w) {
+        ranks[w] = n;
+        n += static_cast<uint64_t>(std::popcount(words[w]));
+    }
+
+    hdr_ = hdr;
+    words_ = std::move(words);
+    ranks_ = std::move(ranks);
+    bar_slots_ = std::move(bar_slots);
+    days_ = std::move(days);
+}
+
+bool CalendarIndex::load(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+
+    CalendarHeader hdr{};
+    bool ok = std::fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+              std::memcmp(hdr.magic, CALENDAR_MAGIC, 8) == 0 &&
+              hdr.version == 1 && hdr.step_ns > 0 && hdr.slot_count <= UINT32_MAX &&
+              hdr.bar_count <= hdr.slot_count;
+
+    std::vector<uint64_t> words;
+    std::vector<uint32_t> bar_slots;
+    std::vector<CalendarDay> days;
+    ok = ok && read_vec(f, words, (hdr.slot_count + 63) / 64) &&
+         read_vec(f, bar_slots, hdr.bar_count) &&
+         read_vec(f, days, hdr.day_count);
+    std::fclose(f);
+    if (!ok)
+        return false;
+
+    // Counts are derived, not stored; a bitmap that disagrees with the bar
+    // table is a damaged file.
+    std::vector<uint64_t> ranks(words.size());
+    uint64_t n = 0;
+    for (size_t w = 0; w < words.size(); ++w) {
+        ranks[w] = n;
+        n += static_cast<uint64_t>(std::popcount(words[w]));
+    }
+    if (n != hdr.bar_count)
+        return false;
+
+    hdr_ = hdr;
+    words_ = std::move(words);
+    ranks_ = std::move(ranks);
+    bar_slots_ = std::move(bar_slots);
+    days_ = std::move(days);
+    return true;
+}
+
+void CalendarIndex::save(const std::string& path) const {
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error("Cannot write calendar: " + tmp);
+        f.write(reinterpret_cast<const char*>(&hdr_), sizeof(hdr_));
+        write_vec(f, words_);
+        write_vec(f, bar_slots_);
+        write_vec(f, days_);
+        if (!f)
+            throw std::runtime_error("Failed writing calendar: " + tmp);
+    }
+
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec)
+        throw std::runtime_error("Failed renaming calendar: " + path + " (" + ec.message() + ")");
+}
+
+std::shared_ptr<const CalendarIndex> CalendarIndex::load_or_build(const std::string& base_dir,
+                                                                  const std::string& symbol,
+                                                                  const std::string& timeframe,
+                                                                  std::shared_ptr<const TapeCatalog> catalog) {
+    if (!catalog)
+        catalog = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
+
+    auto cal = std::make_shared<CalendarIndex>();
+    const std::string path = make_calendar_path(base_dir, symbol, timeframe);
+    if (cal->load(path) && cal->catalog_fingerprint() == catalog->fingerprint())
+        return cal;
+
+    cal->build(base_dir, symbol, timeframe, catalog);
+    if (cal->bar_count() > 0) {
+        try {
+            cal->save(path);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "Warning: %s\n", e.what());
+        }
+    }
+    return cal;
+}
+
+size_t CalendarIndex::day_of_bar(uint64_t i) const {
+    auto it = std::upper_bound(days_.begin(), days_.end(), i,
+                               [](uint64_t bar, const CalendarDay& d) { return bar < d.first_bar; });
+    return static_cast<size_t>(it - days_.begin()) - 1;
+}
+
+}  // namespace datahandler
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "TapeCatalog.hpp"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace datahandler
+{
+
+#pragma pack(push, 1)
+    struct CalendarHeader
+    {
+        char magic[8];                // "CALv001\0"
+        uint32_t version;             // 1
+        uint32_t day_count;
+        uint64_t step_ns;             // grid spacing: one slot per timeframe bar
+        uint64_t phase_ns;            // slot s starts at phase_ns + s * step_ns
+        uint64_t first_slot;          // global slot of bar 0
+        uint64_t slot_count;          // slots from first_slot through the last bar
+        uint64_t bar_count;
+        uint64_t catalog_fingerprint; // TapeCatalog::fingerprint() the index was built from
+        uint8_t reserved[8];
+    };
+
+    // One catalog day: its tape and the global index of its first bar.
+    struct CalendarDay
+    {
+        int32_t ymd;
+        uint32_t reserved;
+        uint64_t first_bar;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(CalendarHeader) == 72, "CalendarHeader must be 72 bytes");
+    static_assert(sizeof(CalendarDay) == 16, "CalendarDay must be 16 bytes");
+
+    // Dense time grid over every bar of a symbol/timeframe catalog.
+    //
+    // Slots are global: slot = (ts - phase) / step counted from the Unix epoch,
+    // so two symbols on the same timeframe share slot numbers and aligning them
+    // is a subtraction. Bars are numbered 0..bar_count()-1 in catalog order
+    // (a run starting at the first catalogued day gets the same numbers).
+    //
+    // A bitmap marks the slots holding a bar; a running count of set bits before
+    // each 64-slot word turns "bars before slot s" into one popcount, and a per
+    // bar slot table answers the reverse. Both directions are O(1). For 26 years
+    // of 1m bars that is ~1.7 MB of bitmap, as much again of counts, and 4 bytes
+    // per bar.
+    //
+    // Lives at BASE_DIR/bars/SYMBOL/TIMEFRAME/SYMBOL_TIMEFRAME.calendar (see
+    // make_calendar_path) and records the catalog fingerprint it was built
+    // from, so a stale file is detected and rebuilt.
+    class CalendarIndex
+    {
+    public:
+        static constexpr uint64_t NO_BAR = UINT64_MAX;
+
+        CalendarIndex() = default;
+
+        // Reads every bar timestamp of the catalogued days. The grid step comes
+        // from the timeframe label ("1m", "4h", "D@-420", see timeframe_minutes)
+        // and the phase from the first bar. Throws std::runtime_error on an
+        // unrecognised timeframe, a bar off the grid or out of order, or a grid
+        // wider than 2^32 slots.
+        void build(const std::string &base_dir,
+                   const std::string &symbol,
+                   const std::string &timeframe,
+                   std::shared_ptr<const TapeCatalog> catalog);
+
+        // Returns false if the file is missing or not a valid calendar.
+        bool load(const std::string &path);
+
+        // Writes via a temp file + rename. Throws on I/O failure.
+        void save(const std::string &path) const;
+
+        // Loads the calendar, rebuilding it (and trying to save it) when it is
+        // missing or was built from a different catalog.
+        static std::shared_ptr<const CalendarIndex> load_or_build(const std::string &base_dir,
+                                                                  const std::string &symbol,
+                                                                  const std::string &timeframe,
+                                                                  std::shared_ptr<const TapeCatalog> catalog);
+
+        uint64_t step_ns() const { return hdr_.step_ns; }
+        uint64_t phase_ns() const { return hdr_.phase_ns; }
+        uint64_t first_slot() const { return hdr_.first_slot; }
+        uint64_t end_slot() const { return hdr_.first_slot + hdr_.slot_count; }
+        uint64_t slot_count() const { return hdr_.slot_count; }
+        uint64_t bar_count() const { return hdr_.bar_count; }
+        uint64_t catalog_fingerprint() const { return hdr_.catalog_fingerprint; }
+
+        // Slot whose interval [ts_of_slot(s), ts_of_slot(s + 1)) holds ts_ns
+        // (slot 0 for times before the phase).
+        uint64_t slot_of_ts(uint64_t ts_ns) const
+        {
+            return ts_ns < hdr_.phase_ns ? 0 : (ts_ns - hdr_.phase_ns) / hdr_.step_ns;
+        }
+        uint64_t ts_of_slot(uint64_t slot) const { return hdr_.phase_ns + slot * hdr_.step_ns; }
+
+        bool has_bar(uint64_t slot) const
+        {
+            if (slot < hdr_.first_slot || slot >= end_slot())
+                return false;
+            const uint64_t s = slot - hdr_.first_slot;
+            return (words_[s >> 6] >> (s & 63)) & 1;
+        }
+
+        // Bars in slots before `slot`: the index of the first bar at or after it.
+        uint64_t rank(uint64_t slot) const
+        {
+            if (slot <= hdr_.first_slot)
+                return 0;
+            if (slot >= end_slot())
+                return hdr_.bar_count;
+            const uint64_t s = slot - hdr_.first_slot;
+            const uint64_t below = (uint64_t{1} << (s & 63)) - 1;
+            return ranks_[s >> 6] + static_cast<uint64_t>(std::popcount(words_[s >> 6] & below));
+        }
+
+        // Index of the bar stamped exactly ts_ns, or NO_BAR.
+        uint64_t bar_at(uint64_t ts_ns) const
+        {
+            if (ts_ns < hdr_.phase_ns || (ts_ns - hdr_.phase_ns) % hdr_.step_ns != 0)
+                return NO_BAR;
+            const uint64_t slot = slot_of_ts(ts_ns);
+            return has_bar(slot) ? rank(slot) : NO_BAR;
+        }
+
+        // Index of the first bar with ts >= ts_ns (bar_count() if none), and of
+        // the last bar with ts <= ts_ns (NO_BAR if none).
+        uint64_t lower_bound(uint64_t ts_ns) const
+        {
+            if (ts_ns <= hdr_.phase_ns)
+                return 0;
+            return rank((ts_ns - hdr_.phase_ns + hdr_.step_ns - 1) / hdr_.step_ns);
+        }
+        uint64_t at_or_before(uint64_t ts_ns) const
+        {
+            if (ts_ns < hdr_.phase_ns)
+                return NO_BAR;
+            const uint64_t n = rank(slot_of_ts(ts_ns) + 1);
+            return n == 0 ? NO_BAR : n - 1;
+        }
+
+        uint64_t slot_of_bar(uint64_t i) const { return hdr_.first_slot + bar_slots_[i]; }
+        uint64_t ts_of_bar(uint64_t i) const { return ts_of_slot(slot_of_bar(i)); }
+
+        // Catalog days in ymd order, and the day holding bar i.
+        const std::vector<CalendarDay> &days() const { return days_; }
+        size_t day_of_bar(uint64_t i) const;
+
+    private:
+        CalendarHeader hdr_{};
+        std::vector<uint64_t> words_;     // bit s: slot first_slot + s holds a bar
+        std::vector<uint64_t> ranks_;     // set bits in words_ before each word
+        std::vector<uint32_t> bar_slots_; // slot of each bar, from first_slot
+        std::vector<CalendarDay> days_;
+    };
+
+} // namespace datahandler
@@ -0,0 +1,214 @@
+#include "Crc32c.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_X86 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CRC32C_TARGET
+#else
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#endif
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+namespace datahandler {
+
+namespace {
+    constexpr uint32_t POLY = 0x82F63B78u;
+
+    // Interleaved stripe lengths for the hardware path. Three independent
+    // streams hide the crc32 instruction's 3-cycle latency; the partial CRCs
+    // are then shifted into place with table lookups. Three MID_STRIPEs fill
+    // a 4 KiB tape checksum block in one round.
+    constexpr size_t LONG_STRIPE = 8192;
+    constexpr size_t MID_STRIPE = 1344;
+    constexpr size_t SHORT_STRIPE = 256;
+
+    // a * b modulo the polynomial, both reflected (bit 31 is x^0). a != 0.
+    uint32_t multmodp(uint32_t a, uint32_t b) {
+        uint32_t m = 1u << 31;
+        uint32_t p = 0;
+        for (;;) {
+            if (a & m) {
+                p ^= b;
+                if ((a & (m - 1)) == 0)
+                    break;
+            }
+            m >>= 1;
+            b = (b & 1) ? (b >> 1) ^ POLY : b >> 1;
+        }
+        return p;
+    }
+
+    struct Tables {
+        uint32_t slice[8][256];       // slice[k][n]: byte n followed by k zero bytes
+        uint32_t x2n[32];             // x^(2^k) mod P
+        uint32_t long_shift[4][256];  // register advanced over LONG_STRIPE zero bytes
+        uint32_t mid_shift[4][256];   // ... over MID_STRIPE zero bytes
+        uint32_t short_shift[4][256]; // ... over SHORT_STRIPE zero bytes
+
+        Tables() {
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? (c >> 1) ^ POLY : c >> 1;
+                slice[0][n] = c;
+            }
+            for (uint32_t n = 0; n < 256; ++n)
+                for (int k = 1; k < 8; ++k)
+                    slice[k][n] = (slice[k - 1][n] >> 8) ^ slice[0][slice[k - 1][n] & 0xff];
+
+            uint32_t p = 1u << 30; // x^1
+            x2n[0] = p;
+            for (int k = 1; k < 32; ++k)
+                x2n[k] = p = multmodp(p, p);
+
+            fill_shift(long_shift, LONG_STRIPE);
+            fill_shift(mid_shift, MID_STRIPE);
+            fill_shift(short_shift, SHORT_STRIPE);
+        }
+
+        // x^(8 * bytes) mod P: the operator that appends `bytes` zero bytes.
+        uint32_t zeros_op(uint64_t bytes) const {
+            uint32_t p = 1u << 31; // x^0
+            for (unsigned k = 3; bytes; bytes >>= 1, ++k)
+                if (bytes & 1)
+                    p = multmodp(x2n[k & 31], p);
+            return p;
+        }
+
+        // The operator is linear, so it splits into one table per register byte.
+        void fill_shift(uint32_t (&t)[4][256], size_t bytes) {
+            const uint32_t op = zeros_op(bytes);
+            for (uint32_t n = 0; n < 256; ++n)
+                for (int i = 0; i < 4; ++i)
+                    t[i][n] = multmodp(op, n << (8 * i));
+        }
+    };
+
+    const Tables& tables() {
+        static const Tables t;
+        return t;
+    }
+
+    inline uint32_t shift(const uint32_t (&t)[4][256], uint32_t c) {
+        return t[0][c & 0xff] ^ t[1][(c >> 8) & 0xff] ^ t[2][(c >> 16) & 0xff] ^ t[3][c >> 24];
+    }
+
+    inline uint64_t load64(const uint8_t* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    // The functions below work on the raw register (pre- and post-inversion
+    // are done by crc32c()).
+    uint32_t crc_table(uint32_t c, const uint8_t* p, size_t n) {
+        const auto& t = tables().slice;
+        for (; n > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0; --n)
+            c = t[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+        for (; n >= 8; n -= 8, p += 8) {
+            const uint64_t w = load64(p) ^ c;
+            c = t[7][w & 0xff] ^ t[6][(w >> 8) & 0xff] ^ t[5][(w >> 16) & 0xff] ^ t[4][(w >> 24) & 0xff] ^
+                t[3][(w >> 32) & 0xff] ^ t[2][(w >> 40) & 0xff] ^ t[1][(w >> 48) & 0xff] ^ t[0][w >> 56];
+        }
+        for (; n > 0; --n)
+            c = t[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+        return c;
+    }
+
+#if defined(CRC32C_X86)
+    CRC32C_TARGET uint64_t stripes_sse42(uint64_t c0, const uint8_t*& p, size_t& n, size_t stripe,
+                                         const uint32_t (&t)[4][256]) {
+        while (n >= 3 * stripe) {
+            uint64_t c1 = 0, c2 = 0;
+            const uint8_t* end = p + stripe;
+            do {
+                c0 = _mm_crc32_u64(c0, load64(p));
+                c1 = _mm_crc32_u64(c1, load64(p + stripe));
+                c2 = _mm_crc32_u64(c2, load64(p + 2 * stripe));
+                p += 8;
+            } while (p < end);
+            c0 = shift(t, static_cast<uint32_t>(c0)) ^ c1;
+            c0 = shift(t, static_cast<uint32_t>(c0)) ^ c2;
+            p += 2 * stripe;
+            n -= 3 * stripe;
+        }
+        return c0;
+    }
+
+    CRC32C_TARGET uint32_t crc_sse42(uint32_t crc, const uint8_t* p, size_t n) {
+        uint64_t c = crc;
+        for (; n > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0; --n)
+            c = _mm_crc32_u8(static_cast<uint32_t>(c), *p++);
+        c = stripes_sse42(c, p, n, LONG_STRIPE, tables().long_shift);
+        c = stripes_sse42(c, p, n, MID_STRIPE, tables().mid_shift);
+        c = stripes_sse42(c, p, n, SHORT_STRIPE, tables().short_shift);
+        for (; n >= 8; n -= 8, p += 8)
+            c = _mm_crc32_u64(c, load64(p));
+        for (; n > 0; --n)
+            c = _mm_crc32_u8(static_cast<uint32_t>(c), *p++);
+        return static_cast<uint32_t>(c);
+    }
+#elif defined(CRC32C_ARM)
+    uint32_t crc_armv8(uint32_t c, const uint8_t* p, size_t n) {
+        for (; n > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0; --n)
+            c = __crc32cb(c, *p++);
+        for (; n >= 8; n -= 8, p += 8)
+            c = __crc32cd(c, load64(p));
+        for (; n > 0; --n)
+            c = __crc32cb(c, *p++);
+        return c;
+    }
+#endif
+
+    using CrcFn = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+    CrcFn pick_impl() {
+#if defined(CRC32C_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        if (info[2] & (1 << 20))
+            return crc_sse42;
+#else
+        if (__builtin_cpu_supports("sse4.2"))
+            return crc_sse42;
+#endif
+#elif defined(CRC32C_ARM)
+        return crc_armv8;
+#endif
+        return crc_table;
+    }
+
+    CrcFn impl() {
+        static const CrcFn f = pick_impl();
+        return f;
+    }
+}
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t n) {
+    return ~impl()(~crc, static_cast<const uint8_t*>(data), n);
+}
+
+uint32_t crc32c_combine(uint32_t crc_a, uint32_t crc_b, uint64_t len_b) {
+    // Callers fold equal-sized blocks, so the operator is usually the last one.
+    thread_local uint64_t last_len = 0;
+    thread_local uint32_t last_op = 1u << 31;
+    if (len_b != last_len) {
+        last_op = tables().zeros_op(len_b);
+        last_len = len_b;
+    }
+    return multmodp(last_op, crc_a) ^ crc_b;
+}
+
+bool crc32c_hardware() {
+    return impl() != crc_table;
+}
+
+}  // namespace datahandler
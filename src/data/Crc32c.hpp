@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace datahandler
+{
+
+    // CRC32C (Castagnoli, reflected polynomial 0x82F63B78), the checksum used by
+    // iSCSI, ext4 and most storage formats. crc is the CRC of the bytes before
+    // data (0 to start), so a buffer can be checksummed in pieces:
+    //   crc32c(crc32c(0, a, na), b, nb) == crc32c(0, ab, na + nb)
+    //
+    // Uses the SSE4.2 crc32 instruction (three interleaved streams) when the
+    // CPU has it, the ARMv8 CRC extension when built for it, and a
+    // slicing-by-8 table otherwise.
+    uint32_t crc32c(uint32_t crc, const void *data, size_t n);
+
+    // CRC of A followed by B, given crc_a = CRC(A), crc_b = CRC(B) and len_b = |B|.
+    // Costs O(log len_b), so per-block CRCs fold into a whole-file CRC without
+    // touching the data again.
+    uint32_t crc32c_combine(uint32_t crc_a, uint32_t crc_b, uint64_t len_b);
+
+    // True when crc32c() runs on a hardware instruction.
+    bool crc32c_hardware();
+
+} // namespace datahandler
@@ -1,6 +1,11 @@
 #include "DateUtils.hpp"
 #include <cstdio>
+
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
 
 namespace datahandler {
 
@@ -24,8 +29,13 @@ static int ymd_to_int(int y, int m, int d) {
 }
 
 bool file_exists(const std::string& path) {
+#ifdef _WIN32
     DWORD attrs = GetFileAttributesA(path.c_str());
     return (attrs != INVALID_FILE_ATTRIBUTES) && !(attrs & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st{};
+    return ::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+#endif
 }
 
 int next_day(int yyyymmdd) {
@@ -44,6 +54,91 @@ int next_day(int yyyymmdd) {
     return ymd_to_int(y, m, d);
 }
 
+int64_t days_from_civil(int y, int m, int d) {
+    // H. Hinnant's algorithm: shift the year to start in March so Feb is last.
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+void civil_from_days(int64_t days, int& y, int& m, int& d) {
+    // Inverse of the above: eras of 400 years, years starting in March.
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    m = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    y = static_cast<int>(static_cast<int64_t>(yoe) + era * 400 + (m <= 2));
+}
+
+int ymd_from_days(int64_t days) {
+    int y, m, d;
+    civil_from_days(days, y, m, d);
+    return ymd_to_int(y, m, d);
+}
+
+// Day number of the n-th (1-based; 0 = last) Sunday of a month.
+static int64_t nth_sunday(int y, int m, int n) {
+    if (n == 0) {
+        const int64_t last = days_from_civil(y, m, days_in_month(y, m));
+        return last - weekday_from_days(last);
+    }
+    const int64_t first = days_from_civil(y, m, 1);
+    return first + (7 - weekday_from_days(first)) % 7 + 7 * (n - 1);
+}
+
+int new_york_utc_offset_minutes(uint64_t ts_ns) {
+    const int64_t days = static_cast<int64_t>(ts_ns / NS_PER_DAY);
+    int y, m, d;
+    civil_from_days(days, y, m, d);
+    if (m < 3 || m > 11)
+        return -300;
+
+    // Both switches happen at 02:00 local: 07:00 UTC in spring, 06:00 UTC in autumn.
+    const int64_t begin_day = y >= 2007 ? nth_sunday(y, 3, 2) : nth_sunday(y, 4, 1);
+    const int64_t end_day = y >= 2007 ? nth_sunday(y, 11, 1) : nth_sunday(y, 10, 0);
+    const uint64_t begin = static_cast<uint64_t>(begin_day) * NS_PER_DAY + 7 * 60 * NS_PER_MINUTE;
+    const uint64_t end = static_cast<uint64_t>(end_day) * NS_PER_DAY + 6 * 60 * NS_PER_MINUTE;
+    return (ts_ns >= begin && ts_ns < end) ? -240 : -300;
+}
+
+// UTC time of `minute` minutes after local midnight of New York day `days`.
+static uint64_t new_york_to_utc(int64_t days, int64_t minute) {
+    const int64_t min_ns = static_cast<int64_t>(NS_PER_MINUTE);
+    const int64_t local = days * static_cast<int64_t>(NS_PER_DAY) + minute * min_ns;
+    // Guess standard time, then take the offset in force at the guess; that
+    // is exact for any time outside the hour a switch skips or repeats.
+    const int64_t guess = local + 300 * min_ns;
+    return static_cast<uint64_t>(local - new_york_utc_offset_minutes(static_cast<uint64_t>(guess)) * min_ns);
+}
+
+TradingDay trading_day(uint64_t ts_ns, DayBoundary boundary) {
+    TradingDay out;
+    int64_t label = 0;
+    if (boundary == DayBoundary::UtcMidnight) {
+        label = static_cast<int64_t>(ts_ns / NS_PER_DAY);
+        out.start_ns = static_cast<uint64_t>(label) * NS_PER_DAY;
+        out.end_ns = out.start_ns + NS_PER_DAY;
+    } else {
+        // Local time shifted by 7 h puts 17:00 New York at midnight; the
+        // session is labelled with the local date it ends on.
+        const int64_t offset_ns = static_cast<int64_t>(new_york_utc_offset_minutes(ts_ns)) * static_cast<int64_t>(NS_PER_MINUTE);
+        const int64_t shifted = static_cast<int64_t>(ts_ns) + offset_ns + 7 * 60 * static_cast<int64_t>(NS_PER_MINUTE);
+        label = shifted / static_cast<int64_t>(NS_PER_DAY);
+        out.start_ns = new_york_to_utc(label - 1, 17 * 60);
+        out.end_ns = new_york_to_utc(label, 17 * 60);
+    }
+    out.ymd = ymd_from_days(label);
+    out.weekday = weekday_from_days(label);
+    return out;
+}
+
 static std::string two(int x) {
     char buf[3];
     std::snprintf(buf, sizeof(buf), "%02d", x);
@@ -66,4 +161,52 @@ std::string make_tape_path(const std::string& base_dir,
            symbol + "_" + four(y) + two(m) + two(d) + ".tape";
 }
 
+std::string make_index_path(const std::string& base_dir,
+                            const std::string& symbol,
+                            const std::string& timeframe,
+                            int yyyymmdd) {
+    std::string p = make_tape_path(base_dir, symbol, timeframe, yyyymmdd);
+    p.replace(p.size() - 5, 5, ".idx");
+    return p;
+}
+
+std::string make_pack_path(const std::string& base_dir,
+                           const std::string& symbol,
+                           const std::string& timeframe,
+                           int year) {
+    return base_dir + "/bars/" + symbol + "/" + timeframe + "/" + four(year) + "/" +
+           symbol + "_" + four(year) + ".tapepack";
+}
+
+std::string make_catalog_path(const std::string& base_dir,
+                              const std::string& symbol,
+                              const std::string& timeframe) {
+    return base_dir + "/bars/" + symbol + "/" + timeframe + "/" +
+           symbol + "_" + timeframe + ".catalog";
+}
+
+std::string make_calendar_path(const std::string& base_dir,
+                               const std::string& symbol,
+                               const std::string& timeframe) {
+    std::string p = make_catalog_path(base_dir, symbol, timeframe);
+    p.replace(p.size() - 8, 8, ".calendar");
+    return p;
+}
+
+std::string make_zonemap_path(const std::string& base_dir,
+                              const std::string& symbol,
+                              const std::string& timeframe) {
+    std::string p = make_catalog_path(base_dir, symbol, timeframe);
+    p.replace(p.size() - 8, 8, ".zonemap");
+    return p;
+}
+
+std::string make_build_info_path(const std::string& base_dir,
+                                 const std::string& symbol,
+                                 const std::string& timeframe) {
+    std::string p = make_catalog_path(base_dir, symbol, timeframe);
+    p.replace(p.size() - 8, 8, ".build");
+    return p;
+}
+
 }  // namespace datahandler
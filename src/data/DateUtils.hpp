@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 namespace datahandler {
@@ -9,10 +10,115 @@ bool file_exists(const std::string& path);
 
 int next_day(int yyyymmdd);
 
+// Days since 1970-01-01 for a proleptic Gregorian date.
+int64_t days_from_civil(int y, int m, int d);
+
+// Inverse of days_from_civil, and the same as a YYYYMMDD integer.
+void civil_from_days(int64_t days, int& y, int& m, int& d);
+int ymd_from_days(int64_t days);
+
+// 0 = Sunday .. 6 = Saturday.
+inline int weekday_from_days(int64_t days) {
+    return static_cast<int>(((days + 4) % 7 + 7) % 7);
+}
+
+constexpr uint64_t NS_PER_MINUTE = 60ull * 1000000000ull;
+constexpr uint64_t NS_PER_DAY = 1440ull * NS_PER_MINUTE;
+
+// UTC offset of New York local time at ts_ns: -240 minutes while US daylight
+// saving time is in effect, -300 otherwise. Uses the 2007 rule (second Sunday
+// of March to first Sunday of November, 02:00 local) from 2007 on and the
+// 1987 rule (first Sunday of April to last Sunday of October) before.
+int new_york_utc_offset_minutes(uint64_t ts_ns);
+
+// Where one day ends and the next begins.
+enum class DayBoundary : uint8_t {
+    UtcMidnight, // calendar day in UTC
+    NewYork1700, // FX trading day: rolls over at 17:00 New York time (EST or
+                 // EDT), labelled with the date it ends on, so Sunday evening
+                 // opens Monday's session. Days are 23 or 25 h across DST changes.
+};
+
+struct TradingDay {
+    uint64_t start_ns = 0; // first ns of the day
+    uint64_t end_ns = 0;   // first ns of the next day
+    int ymd = 0;           // label, YYYYMMDD
+    int weekday = 0;       // of the label, 0 = Sunday
+};
+
+// The day holding ts_ns.
+TradingDay trading_day(uint64_t ts_ns, DayBoundary boundary);
+
+// trading_day() for a stream of mostly increasing timestamps. The current
+// day's bounds are cached, so a timestamp inside it costs one unsigned
+// compare; crossing into another day (either direction) recomputes them.
+class DayClock {
+public:
+    explicit DayClock(DayBoundary boundary = DayBoundary::UtcMidnight) : boundary_(boundary) {}
+
+    const TradingDay& day(uint64_t ts_ns) {
+        if (ts_ns - day_.start_ns >= span_)
+            refresh(ts_ns);
+        return day_;
+    }
+
+    int ymd(uint64_t ts_ns) { return day(ts_ns).ymd; }
+    int weekday(uint64_t ts_ns) { return day(ts_ns).weekday; }
+
+    // Minutes since the start of the day holding ts_ns (0..1499 across DST changes).
+    uint32_t minute_of_day(uint64_t ts_ns) {
+        return static_cast<uint32_t>((ts_ns - day(ts_ns).start_ns) / NS_PER_MINUTE);
+    }
+
+    DayBoundary boundary() const { return boundary_; }
+
+private:
+    void refresh(uint64_t ts_ns) {
+        day_ = trading_day(ts_ns, boundary_);
+        span_ = day_.end_ns - day_.start_ns;
+    }
+
+    DayBoundary boundary_;
+    TradingDay day_{};
+    uint64_t span_ = 0; // end_ns - start_ns; 0 until the first call
+};
+
 // Path: BASE_DIR/bars/SYMBOL/TIMEFRAME/YYYY/SYMBOL_YYYYMMDD.tape
 std::string make_tape_path(const std::string& base_dir,
                            const std::string& symbol,
                            const std::string& timeframe,
                            int yyyymmdd);
 
+// Same as make_tape_path with the .idx sidecar extension.
+std::string make_index_path(const std::string& base_dir,
+                            const std::string& symbol,
+                            const std::string& timeframe,
+                            int yyyymmdd);
+
+// Multi-day container for one year: BASE_DIR/bars/SYMBOL/TIMEFRAME/YYYY/SYMBOL_YYYY.tapepack
+std::string make_pack_path(const std::string& base_dir,
+                           const std::string& symbol,
+                           const std::string& timeframe,
+                           int year);
+
+// Path: BASE_DIR/bars/SYMBOL/TIMEFRAME/SYMBOL_TIMEFRAME.catalog
+std::string make_catalog_path(const std::string& base_dir,
+                              const std::string& symbol,
+                              const std::string& timeframe);
+
+// Path: BASE_DIR/bars/SYMBOL/TIMEFRAME/SYMBOL_TIMEFRAME.calendar
+std::string make_calendar_path(const std::string& base_dir,
+                               const std::string& symbol,
+                               const std::string& timeframe);
+
+// Path: BASE_DIR/bars/SYMBOL/TIMEFRAME/SYMBOL_TIMEFRAME.zonemap
+std::string make_zonemap_path(const std::string& base_dir,
+                              const std::string& symbol,
+                              const std::string& timeframe);
+
+// Path: BASE_DIR/bars/SYMBOL/TIMEFRAME/SYMBOL_TIMEFRAME.build
+std::string make_build_info_path(const std::string& base_dir,
+                                 const std::string& symbol,
+                                 const std::string& timeframe);
+
 }  // namespace datahandler
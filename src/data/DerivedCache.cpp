@@ -0,0 +1,106 @@
+#include "DerivedCache.hpp"
+#include "DateUtils.hpp"
+#include "TapeCatalog.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace datahandler {
+
+DerivedTapeWriter::DerivedTapeWriter(std::string base_dir,
+                                     std::string symbol,
+                                     std::string cache_tf,
+                                     TapeLayout layout)
+    : base_dir_(std::move(base_dir)),
+      symbol_(std::move(symbol)),
+      cache_tf_(std::move(cache_tf)),
+      writer_(0, layout) {}
+
+void DerivedTapeWriter::add(const Bar1m& bar, int ymd) {
+    if (ymd != day_ymd_) {
+        flush();
+        day_ymd_ = ymd;
+    }
+    day_.push_back(bar);
+}
+
+void DerivedTapeWriter::flush() {
+    if (day_.empty())
+        return;
+    const std::string path = make_tape_path(base_dir_, symbol_, cache_tf_, day_ymd_);
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    writer_.write_day(path, day_.data(), day_.size());
+    day_.clear();
+    ++days_;
+}
+
+size_t DerivedTapeWriter::finish() {
+    flush();
+    const std::string cat_path = make_catalog_path(base_dir_, symbol_, cache_tf_);
+    TapeCatalog cat;
+    cat.load(cat_path);
+    cat.update(base_dir_, symbol_, cache_tf_);
+    cat.save(cat_path);
+    return days_;
+}
+
+void write_build_info(const std::string& base_dir,
+                      const std::string& symbol,
+                      const std::string& cache_tf,
+                      const std::string& source_tf,
+                      const std::string& kind,
+                      int start_ymd,
+                      int end_ymd) {
+    const auto src = TapeCatalog::load_or_build(base_dir, symbol, source_tf);
+    const auto span = src->range(start_ymd, end_ymd);
+    if (span.empty())
+        return;
+
+    const std::string info_path = make_build_info_path(base_dir, symbol, cache_tf);
+    std::FILE* f = std::fopen(info_path.c_str(), "w");
+    if (!f)
+        throw std::runtime_error("Cannot write build info: " + info_path);
+    std::fprintf(f, "%d %d %s\n", span.first[0].ymd, span.last[-1].ymd, kind.c_str());
+    if (std::fclose(f) != 0)
+        throw std::runtime_error("Failed writing build info: " + info_path);
+}
+
+bool cache_built_from(const std::string& base_dir,
+                      const std::string& symbol,
+                      const std::string& cache_tf,
+                      const std::string& source_tf,
+                      const std::string& kind,
+                      int start_ymd,
+                      int end_ymd) {
+    const std::string info_path = make_build_info_path(base_dir, symbol, cache_tf);
+    std::FILE* f = std::fopen(info_path.c_str(), "r");
+    if (!f)
+        return false;
+    int first = 0, last = 0;
+    char built_kind[16] = {};
+    const bool ok = std::fscanf(f, "%d %d %15s", &first, &last, built_kind) == 3;
+    std::fclose(f);
+    if (!ok || kind != built_kind)
+        return false;
+
+    const auto src = TapeCatalog::load_or_build(base_dir, symbol, source_tf);
+    const auto a = src->range(start_ymd, end_ymd);
+    if (a.empty() || first > a.first[0].ymd || last < a.last[-1].ymd)
+        return false;
+
+    // Every source tape the cache was built from must predate it.
+    std::error_code ec;
+    const int64_t built = static_cast<int64_t>(std::filesystem::last_write_time(info_path, ec).time_since_epoch().count());
+    if (ec)
+        return false;
+    for (const auto& e : src->range(first, last)) {
+        if (e.mtime > built)
+            return false;
+    }
+    return true;
+}
+
+}  // namespace datahandler
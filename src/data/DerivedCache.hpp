@@ -0,0 +1,93 @@
+#pragma once
+
+#include "TapeReader.hpp"
+#include "TapeWriter.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace datahandler
+{
+
+    // Timeframes derived from the 1m or tick tapes (resampled bars, event
+    // bars) can be cached as tapes of their own. A cached bar is filed under
+    // one day but may be built from several source days, and some source days
+    // leave no cached bar of their own (a session day opened the evening
+    // before, a multi-day bucket, a quiet day), so a cache can't be checked
+    // against its source day by day. Instead each build records the source
+    // days it read in BASE_DIR/bars/SYMBOL/<cache_tf>/SYMBOL_<cache_tf>.build
+    // (make_build_info_path), written last so its write time dates the build.
+
+    // Writes the bars of a derived timeframe as daily tapes under
+    // BASE_DIR/bars/SYMBOL/<cache_tf>/, each bar filed under the day add()
+    // gives it; bars must arrive in time order. Coarse and event bars are a
+    // few hundred a day at most, so no .idx sidecar is written.
+    class DerivedTapeWriter
+    {
+    public:
+        DerivedTapeWriter(std::string base_dir,
+                          std::string symbol,
+                          std::string cache_tf,
+                          TapeLayout layout);
+
+        void add(const Bar1m &bar, int ymd);
+
+        // Writes the last day and refreshes the cache_tf catalog. Returns the
+        // number of days written. Throws std::runtime_error on I/O failure.
+        size_t finish();
+
+    private:
+        void flush();
+
+        std::string base_dir_;
+        std::string symbol_;
+        std::string cache_tf_;
+        TapeWriter writer_;
+        std::vector<Bar1m> day_;
+        int day_ymd_ = 0;
+        size_t days_ = 0;
+    };
+
+    // Drains a reader with the nextBatch()/batch_day() interface of
+    // ResampleReader and EventBarReader into DerivedTapeWriter.
+    template <class Reader>
+    size_t write_derived_tapes(Reader &reader,
+                               const std::string &base_dir,
+                               const std::string &symbol,
+                               const std::string &cache_tf,
+                               TapeLayout layout)
+    {
+        DerivedTapeWriter out(base_dir, symbol, cache_tf, layout);
+        BarBatch batch;
+        while (reader.nextBatch(batch))
+        {
+            for (size_t i = 0; i < batch.size; ++i)
+                out.add(batch[i], reader.batch_day(i));
+        }
+        return out.finish();
+    }
+
+    // Records that cache_tf was just built from the source_tf tapes in
+    // [start_ymd, end_ymd]. kind tells builds from different sources apart
+    // ("bars", "ticks"). Writes nothing when the range holds no source tapes.
+    // Throws std::runtime_error on I/O failure.
+    void write_build_info(const std::string &base_dir,
+                          const std::string &symbol,
+                          const std::string &cache_tf,
+                          const std::string &source_tf,
+                          const std::string &kind,
+                          int start_ymd,
+                          int end_ymd);
+
+    // True when the last build of cache_tf read source_tf tapes of this kind
+    // covering every source day in [start_ymd, end_ymd], and none of the
+    // source tapes it read was written after it.
+    bool cache_built_from(const std::string &base_dir,
+                          const std::string &symbol,
+                          const std::string &cache_tf,
+                          const std::string &source_tf,
+                          const std::string &kind,
+                          int start_ymd,
+                          int end_ymd);
+
+} // namespace datahandler
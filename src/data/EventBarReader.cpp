@@ -0,0 +1,309 @@
+#include "EventBarReader.hpp"
+#include "DateUtils.hpp"
+#include "DerivedCache.hpp"
+#include "TapeCatalog.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+namespace datahandler {
+
+namespace {
+    struct TypeName {
+        const char* name;
+        EventBarType type;
+    };
+
+    constexpr TypeName TYPE_NAMES[] = {
+        {"range", EventBarType::Range},
+        {"renko", EventBarType::Renko},
+        {"ticks", EventBarType::TickCount},
+        {"volume", EventBarType::Volume},
+    };
+
+    void die_if(bool cond, const std::string& msg) {
+        if (cond) throw std::runtime_error(msg);
+    }
+}
+
+bool parse_event_bar_spec(const std::string& label, EventBarSpec& out) {
+    const size_t colon = label.find(':');
+    if (colon == std::string::npos)
+        return false;
+    const std::string name = label.substr(0, colon);
+    const std::string size = label.substr(colon + 1);
+
+    for (const auto& t : TYPE_NAMES) {
+        if (name != t.name)
+            continue;
+        char* end = nullptr;
+        const double v = std::strtod(size.c_str(), &end);
+        if (size.empty() || *end != '\0' || !(v > 0.0))
+            return false;
+        out.type = t.type;
+        out.size = v;
+        return true;
+    }
+    return false;
+}
+
+std::string event_timeframe_name(const EventBarSpec& spec) {
+    const char* name = "range";
+    for (const auto& t : TYPE_NAMES) {
+        if (t.type == spec.type)
+            name = t.name;
+    }
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%s_%.10g", name, spec.size);
+    return buf;
+}
+
+EventBarReader::EventBarReader(std::string base_dir,
+                               std::string symbol,
+                               EventBarSpec spec,
+                               int start_ymd,
+                               int end_ymd)
+    : base_dir_(std::move(base_dir))
+    , symbol_(std::move(symbol))
+    , spec_(spec)
+    , start_ymd_(start_ymd)
+    , end_ymd_(end_ymd)
+{
+    die_if(!(spec_.size > 0.0), "Event bar size must be positive");
+}
+
+bool EventBarReader::cache_covers_range(bool ticks) const {
+    // Bars carry state across days and quiet days may close none, so the
+    // cached days can't be matched to source days one for one.
+    return cache_built_from(base_dir_, symbol_, cache_timeframe(), ticks ? TICK_TIMEFRAME : "1m",
+                            ticks ? "ticks" : "bars", start_ymd_, end_ymd_);
+}
+
+void EventBarReader::open_source() {
+    opened_ = true;
+    bool ticks = source_ == EventSource::Ticks;
+    if (source_ == EventSource::Auto) {
+        const auto tick_catalog = TapeCatalog::load_or_build(base_dir_, symbol_, TICK_TIMEFRAME);
+        ticks = !tick_catalog->range(start_ymd_, end_ymd_).empty();
+    }
+    die_if(!ticks && spec_.type == EventBarType::TickCount, "Tick-count bars need tick tapes");
+
+    from_cache_ = use_cache_ && cache_covers_range(ticks);
+    if (from_cache_)
+        bars_ = std::make_unique<TapeReader>(base_dir_, symbol_, cache_timeframe(), start_ymd_, end_ymd_);
+    else if (ticks)
+        ticks_ = std::make_unique<TickReader>(base_dir_, symbol_, start_ymd_, end_ymd_);
+    else
+        bars_ = std::make_unique<TapeReader>(base_dir_, symbol_, "1m", start_ymd_, end_ymd_);
+}
+
+bool EventBarReader::nextBar(Bar1m& out) {
+    while (pos_ >= chunk_.size) {
+        if (!next_chunk())
+            return false;
+    }
+    out = chunk_[pos_++];
+    ++bars_read_;
+    return true;
+}
+
+bool EventBarReader::nextBatch(BarBatch& out) {
+    while (pos_ >= chunk_.size) {
+        if (!next_chunk())
+            return false;
+    }
+    out.data = chunk_.data + pos_;
+    out.size = chunk_.size - pos_;
+    out.first_index = bars_read_;
+    batch_start_ = pos_;
+
+    bars_read_ += out.size;
+    pos_ = chunk_.size;
+    return true;
+}
+
+int EventBarReader::batch_day(size_t i) const {
+    return from_cache_ ? bars_->current_day() : out_ymd_[batch_start_ + i];
+}
+
+bool EventBarReader::next_chunk() {
+    if (!opened_)
+        open_source();
+    pos_ = 0;
+    chunk_ = BarBatch{};
+
+    if (from_cache_)
+        return bars_->nextBatch(chunk_);
+
+    out_.clear();
+    out_ymd_.clear();
+    while (out_.empty() && !src_done_) {
+        if (ticks_) {
+            TickBatch in;
+            if (!ticks_->nextBatch(in)) {
+                src_done_ = true;
+                break;
+            }
+            const int ymd = ticks_->current_day();
+            for (const Tick& t : in)
+                add(t.ts_ns, 0.5 * (t.bid + t.ask), t.size > 0.0f ? t.size : 1.0, ymd);
+        } else {
+            BarBatch in;
+            if (!bars_->nextBatch(in)) {
+                src_done_ = true;
+                break;
+            }
+            const int ymd = bars_->current_day();
+            for (const Bar1m& bar : in)
+                add_bar(bar, ymd);
+        }
+    }
+
+    chunk_.data = out_.data();
+    chunk_.size = out_.size();
+    return !out_.empty();
+}
+
+void EventBarReader::add_bar(const Bar1m& bar, int ymd) {
+    // A 1m bar is stamped at its open but only known once the minute is over.
+    const uint64_t known_ns = bar.ts_ns + NS_PER_MINUTE - 1;
+    if (spec_.type == EventBarType::Volume) {
+        if (!building_)
+            start(bar.open);
+        high_ = std::max(high_, double(bar.high));
+        low_ = std::min(low_, double(bar.low));
+        close_ = bar.close;
+        volume_ += bar.volume;
+        if (volume_ >= spec_.size)
+            emit(known_ns, ymd);
+        return;
+    }
+
+    // Range and renko: walk the minute's path; its volume goes with the close.
+    const double o = bar.open, h = bar.high, l = bar.low, c = bar.close;
+    const bool up = c >= o;
+    add(known_ns, o, 0.0, ymd);
+    add(known_ns, up ? l : h, 0.0, ymd);
+    add(known_ns, up ? h : l, 0.0, ymd);
+    add(known_ns, c, bar.volume, ymd);
+}
+
+void EventBarReader::start(double px) {
+    open_ = high_ = low_ = close_ = px;
+    volume_ = 0.0;
+    ticks_in_bar_ = 0;
+    building_ = true;
+}
+
+void EventBarReader::add(uint64_t ts_ns, double px, double volume, int ymd) {
+    const double size = spec_.size;
+    switch (spec_.type) {
+    case EventBarType::TickCount:
+    case EventBarType::Volume:
+        if (!building_)
+            start(px);
+        high_ = std::max(high_, px);
+        low_ = std::min(low_, px);
+        close_ = px;
+        volume_ += volume;
+        ++ticks_in_bar_;
+        if (spec_.type == EventBarType::TickCount ? static_cast<double>(ticks_in_bar_) >= size : volume_ >= size)
+            emit(ts_ns, ymd);
+        return;
+
+    case EventBarType::Range:
+        if (!building_)
+            start(px);
+        for (;;) {
+            const double hi = std::max(high_, px);
+            const double lo = std::min(low_, px);
+            if (hi - lo < size) {
+                high_ = hi;
+                low_ = lo;
+                close_ = px;
+                volume_ += volume;
+                return;
+            }
+            // The move reaches the limit: close on the boundary and open the
+            // next bar there; a gap wider than the range makes several bars.
+            if (px > high_)
+                close_ = high_ = low_ + size;
+            else
+                close_ = low_ = high_ - size;
+            volume_ += volume;
+            volume = 0.0;
+            const double boundary = close_;
+            emit(ts_ns, ymd);
+            start(boundary);
+        }
+
+    case EventBarType::Renko:
+        // building_ stays set after the first price: the pending volume
+        // carries over to the next brick.
+        if (!building_) {
+            start(px);
+            top_ = bottom_ = px;
+        }
+        volume_ += volume;
+        while (px >= top_ + size) {
+            open_ = low_ = top_;
+            close_ = high_ = top_ + size;
+            bottom_ = top_;
+            top_ += size;
+            emit(ts_ns, ymd);
+        }
+        while (px <= bottom_ - size) {
+            open_ = high_ = bottom_;
+            close_ = low_ = bottom_ - size;
+            top_ = bottom_;
+            bottom_ -= size;
+            emit(ts_ns, ymd);
+        }
+        return;
+    }
+}
+
+void EventBarReader::emit(uint64_t ts_ns, int ymd) {
+    if (emitted_ && ts_ns <= last_ts_)
+        ts_ns = last_ts_ + 1;
+    last_ts_ = ts_ns;
+    emitted_ = true;
+
+    Bar1m bar{};
+    bar.ts_ns = ts_ns;
+    bar.open = open_;
+    bar.high = high_;
+    bar.low = low_;
+    bar.close = close_;
+    bar.volume = static_cast<float>(volume_);
+    out_.push_back(bar);
+    out_ymd_.push_back(ymd);
+
+    volume_ = 0.0;
+    building_ = spec_.type == EventBarType::Renko;
+}
+
+size_t write_event_bar_cache(const std::string& base_dir,
+                             const std::string& symbol,
+                             const EventBarSpec& spec,
+                             int start_ymd,
+                             int end_ymd,
+                             EventSource source,
+                             TapeLayout layout) {
+    EventBarReader reader(base_dir, symbol, spec, start_ymd, end_ymd);
+    reader.set_source(source);
+    reader.set_use_cache(false);
+    const std::string cache_tf = reader.cache_timeframe();
+
+    const size_t days = write_derived_tapes(reader, base_dir, symbol, cache_tf, layout);
+
+    // Written last: its time stamps the cache against the source tapes.
+    write_build_info(base_dir, symbol, cache_tf, reader.from_ticks() ? TICK_TIMEFRAME : "1m",
+                     reader.from_ticks() ? "ticks" : "bars", start_ymd, end_ymd);
+    return days;
+}
+
+}  // namespace datahandler
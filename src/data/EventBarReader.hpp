@@ -0,0 +1,151 @@
+#pragma once
+
+#include "TapeReader.hpp"
+#include "TapeWriter.hpp"
+#include "TickReader.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace datahandler
+{
+
+    // Bars that close on price movement or activity instead of the clock.
+    enum class EventBarType : uint8_t
+    {
+        Range,     // high - low reaches size; closes on the boundary, the next bar opens there
+        Renko,     // bricks of size: a brick up needs price >= top + size, down <= bottom - size
+        TickCount, // every size ticks (tick data only)
+        Volume,    // once the summed volume reaches size
+    };
+
+    struct EventBarSpec
+    {
+        EventBarType type = EventBarType::Range;
+        double size = 0.0; // price range / brick size, ticks, or volume per bar
+    };
+
+    // Parses "range:<price>", "renko:<price>", "ticks:<n>" or "volume:<v>"
+    // (e.g. "range:0.0010"). Returns false if the label isn't recognised or
+    // the size isn't positive.
+    bool parse_event_bar_spec(const std::string &label, EventBarSpec &out);
+
+    // Timeframe directory of cached event bars, e.g. "range_0.001", "ticks_500".
+    std::string event_timeframe_name(const EventBarSpec &spec);
+
+    enum class EventSource : uint8_t
+    {
+        Auto,  // ticks when the symbol has tick tapes in the range, else 1m bars
+        Ticks, // mid price (bid + ask) / 2; volume is the tick size, or 1 when the feed has none
+        Bars,  // 1m bars walked open, nearer extreme, farther extreme, close
+    };
+
+    // Streams range, renko, tick-count or volume bars built in one pass from
+    // the finest data the symbol has. Each bar is a Bar1m stamped with the time
+    // of the tick that completed it, or the last nanosecond of the 1m bar that
+    // did (a 1m bar is stamped at its open but only known at its close), so a
+    // run sees it exactly when it became known; bars completed by the same
+    // source record are stamped 1 ns apart to keep timestamps increasing. Renko bricks have no wicks
+    // (high/low are the brick ends) and carry the volume traded since the last
+    // brick. A bar still open when the range ends is dropped.
+    //
+    // From 1m bars the path inside each minute is unknown: it is taken as
+    // open, the extreme nearer the open, the other extreme, close, which is
+    // exact whenever a minute moves less than one range/brick. Volume bars
+    // close on whole 1m bars. Tick-count bars need tick tapes.
+    //
+    // When the bars were cached with write_event_bar_cache() from the same
+    // kind of source over a range holding this one, the cached tapes are read
+    // directly instead (bars near the start then carry the state of the
+    // cache's earlier days, as in a longer run).
+    class EventBarReader
+    {
+    public:
+        // Throws std::runtime_error for a non-positive size.
+        EventBarReader(std::string base_dir,
+                       std::string symbol,
+                       EventBarSpec spec,
+                       int start_ymd,
+                       int end_ymd);
+
+        // Set before the first read.
+        void set_source(EventSource source) { source_ = source; }
+        void set_use_cache(bool on) { use_cache_ = on; }
+
+        // Same contract as TapeReader::nextBar/nextBatch. A batch holds the bars
+        // completed by one source chunk (a tick block or a 1m day), so it is
+        // valid until the next read call.
+        bool nextBar(Bar1m &out);
+        bool nextBatch(BarBatch &out);
+
+        uint64_t bars_read() const { return bars_read_; }
+
+        // YYYYMMDD of the source day on which bar i of the last batch closed.
+        int batch_day(size_t i) const;
+
+        bool from_cache() const { return from_cache_; }
+        bool from_ticks() const { return ticks_ != nullptr; }
+
+        std::string cache_timeframe() const { return event_timeframe_name(spec_); }
+        const EventBarSpec &spec() const { return spec_; }
+        const std::string &symbol() const { return symbol_; }
+
+    private:
+        void open_source();
+        bool cache_covers_range(bool ticks) const;
+        bool next_chunk();
+        void add(uint64_t ts_ns, double px, double volume, int ymd);
+        void add_bar(const Bar1m &bar, int ymd);
+        void start(double px);
+        void emit(uint64_t ts_ns, int ymd);
+
+        std::string base_dir_;
+        std::string symbol_;
+        EventBarSpec spec_;
+        int start_ymd_;
+        int end_ymd_;
+        EventSource source_ = EventSource::Auto;
+        bool use_cache_ = true;
+
+        bool opened_ = false;
+        bool from_cache_ = false;
+        std::unique_ptr<TapeReader> bars_; // 1m or cached bars
+        std::unique_ptr<TickReader> ticks_;
+        bool src_done_ = false;
+
+        // Bar being built.
+        double open_ = 0.0;
+        double high_ = 0.0;
+        double low_ = 0.0;
+        double close_ = 0.0;
+        double volume_ = 0.0;
+        uint64_t ticks_in_bar_ = 0;
+        bool building_ = false;
+        double top_ = 0.0;        // renko: ends of the last brick
+        double bottom_ = 0.0;
+        uint64_t last_ts_ = 0;    // stamp of the last bar emitted
+        bool emitted_ = false;
+
+        std::vector<Bar1m> out_;   // bars completed by the last source chunk
+        std::vector<int> out_ymd_; // closing day of each out_ bar
+        BarBatch chunk_;           // out_, or the last cached batch
+        size_t pos_ = 0;           // next bar of chunk_ to hand out
+        size_t batch_start_ = 0;   // chunk_ index of the last nextBatch() view
+        uint64_t bars_read_ = 0;
+    };
+
+    // Builds event bars over [start_ymd, end_ymd] and writes them as daily
+    // tapes (and catalog) under BASE_DIR/bars/SYMBOL/<event_timeframe_name()>/,
+    // each bar filed under the day it closed, plus the source days and kind
+    // they were built from (make_build_info_path). Returns the number of days
+    // written.
+    size_t write_event_bar_cache(const std::string &base_dir,
+                                 const std::string &symbol,
+                                 const EventBarSpec &spec,
+                                 int start_ymd,
+                                 int end_ymd,
+                                 EventSource source = EventSource::Auto,
+                                 TapeLayout layout = TapeLayout::Rows);
+
+} // namespace datahandler
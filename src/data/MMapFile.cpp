@@ -1,10 +1,25 @@
 #include "MMapFile.hpp"
 
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace datahandler {
 
-void MMapFile::open_readonly(const std::string& path) {
+#ifdef _WIN32
+
+void MMapFile::open_readonly(const std::string& path, const MapPolicy& policy) {
+    close();
+
+    const DWORD flags = FILE_ATTRIBUTE_NORMAL |
+                        (policy.sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0);
     file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
-                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+                        OPEN_EXISTING, flags, nullptr);
     if (file_ == INVALID_HANDLE_VALUE)
         throw std::runtime_error("CreateFile failed: " + path);
 
@@ -20,6 +35,10 @@ void MMapFile::open_readonly(const std::string& path) {
     data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
     if (!data_)
         throw std::runtime_error("MapViewOfFile failed");
+
+    // No MAP_POPULATE on Windows: treat it as an eager prefetch.
+    if (policy.will_need || policy.populate)
+        will_need();
 }
 
 void MMapFile::close() {
@@ -38,4 +57,87 @@ void MMapFile::close() {
     size_ = 0;
 }
 
+void MMapFile::will_need() const {
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+    if (!data_)
+        return;
+    WIN32_MEMORY_RANGE_ENTRY range{data_, size_};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+}
+
+void MMapFile::swap(MMapFile& other) noexcept {
+    std::swap(file_, other.file_);
+    std::swap(mapping_, other.mapping_);
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+}
+
+#else  // POSIX
+
+void MMapFile::open_readonly(const std::string& path, const MapPolicy& policy) {
+    close();
+
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0)
+        throw std::runtime_error("open failed: " + path);
+
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0)
+        throw std::runtime_error("fstat failed: " + path);
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0)
+        throw std::runtime_error("mmap failed (empty file): " + path);
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (policy.populate)
+        flags |= MAP_POPULATE;
+#endif
+
+    void* p = ::mmap(nullptr, size_, PROT_READ, flags, fd_, 0);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("mmap failed: " + path);
+    data_ = p;
+
+    if (policy.sequential) {
+        ::madvise(data_, size_, MADV_SEQUENTIAL);
+#ifdef POSIX_FADV_SEQUENTIAL
+        ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+#ifdef MADV_HUGEPAGE
+    if (policy.huge_pages)
+        ::madvise(data_, size_, MADV_HUGEPAGE);
+#endif
+    if (policy.will_need)
+        will_need();
+}
+
+void MMapFile::close() {
+    if (data_) {
+        ::munmap(data_, size_);
+        data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+}
+
+void MMapFile::will_need() const {
+    if (!data_)
+        return;
+    ::madvise(data_, size_, MADV_WILLNEED);
+}
+
+void MMapFile::swap(MMapFile& other) noexcept {
+    std::swap(fd_, other.fd_);
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+}
+
+#endif
+
 }  // namespace datahandler
@@ -4,10 +4,21 @@
 #include <string>
 #include <stdexcept>
 
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 namespace datahandler {
 
+// Access-pattern hints applied when a file is mapped.
+// All hints are best-effort: a platform that lacks one silently ignores it.
+struct MapPolicy {
+    bool sequential = true;   // MADV_SEQUENTIAL: aggressive kernel read-ahead, early page drop
+    bool will_need = false;   // MADV_WILLNEED / PrefetchVirtualMemory: start async read on open
+    bool populate = false;    // MAP_POPULATE: pre-fault the whole mapping inside mmap() (Linux)
+    bool huge_pages = false;  // MADV_HUGEPAGE: THP backing (Linux, needs read-only THP for fs)
+};
+
 // RAII memory-mapped file for read-only access.
 class MMapFile {
 public:
@@ -17,16 +28,34 @@ public:
     MMapFile(const MMapFile&) = delete;
     MMapFile& operator=(const MMapFile&) = delete;
 
-    void open_readonly(const std::string& path);
+    MMapFile(MMapFile&& other) noexcept { swap(other); }
+    MMapFile& operator=(MMapFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+
+    void open_readonly(const std::string& path, const MapPolicy& policy = {});
     void close();
 
+    // Ask the OS to start reading the whole mapping in the background.
+    void will_need() const;
+
+    void swap(MMapFile& other) noexcept;
+
     void* data() const { return data_; }
     size_t size() const { return size_; }
     bool is_open() const { return data_ != nullptr; }
 
 private:
+#ifdef _WIN32
     HANDLE file_ = INVALID_HANDLE_VALUE;
     HANDLE mapping_ = NULL;
+#else
+    int fd_ = -1;
+#endif
     void* data_ = nullptr;
     size_t size_ = 0;
 };
@@ -0,0 +1,116 @@
+#include "MergedBarStream.hpp"
+
+#include <algorithm>
+
+namespace datahandler {
+
+namespace {
+    // Comparator for std::push_heap/pop_heap that keeps the smallest
+    // (ts_ns, symbol_id) at the front.
+    template <typename H>
+    bool later(const H& a, const H& b) {
+        return a.ts_ns != b.ts_ns ? a.ts_ns > b.ts_ns : a.symbol_id > b.symbol_id;
+    }
+}
+
+MergedBarStream::MergedBarStream(const std::string& base_dir,
+                                 const std::vector<std::string>& symbols,
+                                 const std::string& timeframe,
+                                 int start_ymd,
+                                 int end_ymd)
+    : symbols_(symbols)
+{
+    sources_.resize(symbols_.size());
+    for (size_t i = 0; i < symbols_.size(); ++i)
+        sources_[i].reader = std::make_unique<TapeReader>(base_dir, symbols_[i], timeframe, start_ymd, end_ymd);
+    heap_.reserve(symbols_.size());
+    step_.reserve(symbols_.size());
+    pending_.reserve(symbols_.size());
+}
+
+bool MergedBarStream::next(MergedStep& out) {
+    if (!started_) {
+        start();
+    } else {
+        // Advance only now, so the previous step's pointers stayed valid even
+        // when a source had to move on to its next day.
+        for (uint32_t id : pending_) {
+            ++sources_[id].pos;
+            if (fill(id))
+                push(id);
+        }
+    }
+    pending_.clear();
+
+    if (heap_.empty())
+        return false;
+
+    const uint64_t ts = heap_.front().ts_ns;
+    step_.clear();
+    while (!heap_.empty() && heap_.front().ts_ns == ts) {
+        std::pop_heap(heap_.begin(), heap_.end(), later<Head>);
+        const uint32_t id = heap_.back().symbol_id;
+        heap_.pop_back();
+        const Source& s = sources_[id];
+        step_.push_back(SymbolBar{id, &s.batch[s.pos]});
+        pending_.push_back(id);
+    }
+
+    out.ts_ns = ts;
+    out.bars = step_.data();
+    out.size = step_.size();
+    return true;
+}
+
+bool MergedBarStream::seek(uint64_t ts_ns) {
+    reset();
+    bool any = false;
+    for (auto& s : sources_)
+        any |= s.reader->seek(ts_ns);
+    return any;
+}
+
+bool MergedBarStream::seek_with_warmup(uint64_t ts_ns, uint64_t warmup_bars) {
+    reset();
+    bool any = false;
+    uint64_t got = 0;
+    for (auto& s : sources_)
+        any |= s.reader->seek_with_warmup(ts_ns, warmup_bars, got);
+    return any;
+}
+
+void MergedBarStream::reset() {
+    for (auto& s : sources_) {
+        s.batch = BarBatch{};
+        s.pos = 0;
+    }
+    heap_.clear();
+    pending_.clear();
+    started_ = false;
+}
+
+bool MergedBarStream::fill(uint32_t id) {
+    Source& s = sources_[id];
+    while (s.pos >= s.batch.size) {
+        if (!s.reader->nextBatch(s.batch))
+            return false;
+        s.pos = 0;
+    }
+    return true;
+}
+
+void MergedBarStream::push(uint32_t id) {
+    const Source& s = sources_[id];
+    heap_.push_back(Head{s.batch[s.pos].ts_ns, id});
+    std::push_heap(heap_.begin(), heap_.end(), later<Head>);
+}
+
+void MergedBarStream::start() {
+    heap_.clear();
+    for (uint32_t id = 0; id < sources_.size(); ++id)
+        if (fill(id))
+            push(id);
+    started_ = true;
+}
+
+}  // namespace datahandler
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "TapeReader.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace datahandler
+{
+
+    // One symbol's bar within a merged step.
+    struct SymbolBar
+    {
+        uint32_t symbol_id; // index into MergedBarStream::symbols()
+        const Bar1m *bar;
+    };
+
+    // Every bar that shares one timestamp, ordered by symbol_id.
+    // Valid until the next call to MergedBarStream::next().
+    struct MergedStep
+    {
+        uint64_t ts_ns = 0;
+        const SymbolBar *bars = nullptr;
+        size_t size = 0;
+
+        const SymbolBar *begin() const { return bars; }
+        const SymbolBar *end() const { return bars + size; }
+        const SymbolBar &operator[](size_t i) const { return bars[i]; }
+    };
+
+    // Replays several symbols of one timeframe on a shared clock: a k-way merge
+    // on ts_ns over one TapeReader per symbol. Each reader is drained a day at a
+    // time through nextBatch(), so bars are never copied and the per-step cost
+    // is a heap pop/push per symbol that has a bar at that timestamp.
+    class MergedBarStream
+    {
+    public:
+        MergedBarStream(const std::string &base_dir,
+                        const std::vector<std::string> &symbols,
+                        const std::string &timeframe,
+                        int start_ymd,
+                        int end_ymd);
+
+        // Next timestamp with at least one bar. Returns false when every symbol is exhausted.
+        bool next(MergedStep &out);
+
+        // Positions every reader on its first bar at/after ts_ns. Returns false
+        // if no symbol has a bar there.
+        bool seek(uint64_t ts_ns);
+
+        // Like seek(), but each symbol backs up by up to warmup_bars of its own
+        // bars. Steps with ts_ns below the requested ts are warmup.
+        bool seek_with_warmup(uint64_t ts_ns, uint64_t warmup_bars);
+
+        const std::vector<std::string> &symbols() const { return symbols_; }
+
+        // Per-symbol reader, e.g. to set a map policy or prefetch depth before reading.
+        TapeReader &reader(uint32_t symbol_id) { return *sources_[symbol_id].reader; }
+
+    private:
+        struct Source
+        {
+            std::unique_ptr<TapeReader> reader;
+            BarBatch batch;
+            size_t pos = 0;
+        };
+
+        struct Head
+        {
+            uint64_t ts_ns;
+            uint32_t symbol_id;
+        };
+
+        void reset();
+        bool fill(uint32_t id);      // true if the source has a current bar
+        void push(uint32_t id);
+        void start();
+
+        std::vector<std::string> symbols_;
+        std::vector<Source> sources_;
+        std::vector<Head> heap_;      // min-heap on (ts_ns, symbol_id)
+        std::vector<SymbolBar> step_;
+        std::vector<uint32_t> pending_; // sources whose current bar was handed out
+        bool started_ = false;
+    };
+
+} // namespace datahandler
@@ -0,0 +1,191 @@
+#include "ResampleReader.hpp"
+#include "DateUtils.hpp"
+#include "DerivedCache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace datahandler {
+
+namespace {
+    // floor(a / b) for b > 0.
+    int64_t floor_div(int64_t a, int64_t b) {
+        const int64_t q = a / b;
+        return (a % b != 0 && a < 0) ? q - 1 : q;
+    }
+}
+
+uint32_t timeframe_minutes(const std::string& timeframe) {
+    if (timeframe == "D")
+        return 1440;
+    if (timeframe.size() < 2)
+        return 0;
+
+    uint32_t n = 0;
+    for (size_t i = 0; i + 1 < timeframe.size(); ++i) {
+        const char c = timeframe[i];
+        if (c < '0' || c > '9' || n > 100000)
+            return 0;
+        n = n * 10 + static_cast<uint32_t>(c - '0');
+    }
+    switch (timeframe.back()) {
+    case 'm': return n;
+    case 'h': case 'H': return n * 60;
+    case 'd': case 'D': return n * 1440;
+    default: return 0;
+    }
+}
+
+ResampleReader::ResampleReader(std::string base_dir,
+                               std::string symbol,
+                               std::string timeframe,
+                               int start_ymd,
+                               int end_ymd)
+    : base_dir_(std::move(base_dir))
+    , symbol_(std::move(symbol))
+    , timeframe_(std::move(timeframe))
+    , start_ymd_(start_ymd)
+    , end_ymd_(end_ymd)
+{
+    const uint32_t minutes = timeframe_minutes(timeframe_);
+    if (minutes == 0)
+        throw std::runtime_error("Unrecognised timeframe: " + timeframe_);
+    tf_ns_ = minutes * NS_PER_MINUTE;
+}
+
+std::string cache_timeframe_name(const std::string& timeframe, int origin_minutes) {
+    return origin_minutes == 0 ? timeframe : timeframe + "@" + std::to_string(origin_minutes);
+}
+
+TapeReader& ResampleReader::source() {
+    if (!src_)
+        open_source();
+    return *src_;
+}
+
+bool ResampleReader::cache_covers_range(const std::string& cache_tf) const {
+    // Cached bars are filed under the day their bucket opened, so session
+    // days, multi-day buckets and shifted origins leave some 1m days without
+    // a cached tape; compare against what the cache was built from instead.
+    return cache_built_from(base_dir_, symbol_, cache_tf, "1m", "bars", start_ymd_, end_ymd_);
+}
+
+void ResampleReader::open_source() {
+    const std::string cache_tf = cache_timeframe();
+    from_cache_ = use_cache_ && tf_ns_ != NS_PER_MINUTE && cache_covers_range(cache_tf);
+    src_ = std::make_unique<TapeReader>(base_dir_, symbol_, from_cache_ ? cache_tf : std::string("1m"),
+                                        start_ymd_, end_ymd_);
+}
+
+bool ResampleReader::nextBar(Bar1m& out) {
+    while (pos_ >= chunk_.size) {
+        if (!next_chunk())
+            return false;
+    }
+    out = chunk_[pos_++];
+    ++bars_read_;
+    return true;
+}
+
+bool ResampleReader::nextBatch(BarBatch& out) {
+    while (pos_ >= chunk_.size) {
+        if (!next_chunk())
+            return false;
+    }
+    out.data = chunk_.data + pos_;
+    out.size = chunk_.size - pos_;
+    out.first_index = bars_read_;
+    batch_start_ = pos_;
+
+    bars_read_ += out.size;
+    pos_ = chunk_.size;
+    return true;
+}
+
+int ResampleReader::batch_day(size_t i) const {
+    return from_cache_ ? src_->current_day() : out_ymd_[batch_start_ + i];
+}
+
+bool ResampleReader::next_chunk() {
+    if (!src_)
+        open_source();
+    pos_ = 0;
+    chunk_ = BarBatch{};
+
+    if (from_cache_)
+        return src_->nextBatch(chunk_);
+
+    out_.clear();
+    out_ymd_.clear();
+    while (out_.empty() && !src_done_) {
+        BarBatch in;
+        if (!src_->nextBatch(in)) {
+            src_done_ = true;
+            if (open_) {
+                out_.push_back(cur_);
+                out_ymd_.push_back(cur_ymd_);
+                open_ = false;
+            }
+            break;
+        }
+        const int ymd = src_->current_day();
+        for (const Bar1m& bar : in)
+            add(bar, ymd);
+    }
+
+    chunk_.data = out_.data();
+    chunk_.size = out_.size();
+    return !out_.empty();
+}
+
+void ResampleReader::add(const Bar1m& bar, int ymd) {
+    uint64_t bucket;
+    if (session_days()) {
+        bucket = clock_.day(bar.ts_ns).start_ns;
+    } else {
+        const int64_t origin = static_cast<int64_t>(origin_minutes_) * static_cast<int64_t>(NS_PER_MINUTE);
+        const int64_t tf = static_cast<int64_t>(tf_ns_);
+        bucket = static_cast<uint64_t>(floor_div(static_cast<int64_t>(bar.ts_ns) - origin, tf) * tf + origin);
+    }
+
+    if (open_ && bucket == cur_.ts_ns) {
+        cur_.high = std::max(cur_.high, bar.high);
+        cur_.low = std::min(cur_.low, bar.low);
+        cur_.close = bar.close;
+        cur_.volume += bar.volume;
+        return;
+    }
+
+    if (open_) {
+        out_.push_back(cur_);
+        out_ymd_.push_back(cur_ymd_);
+    }
+    cur_ = bar;
+    cur_.ts_ns = bucket;
+    cur_ymd_ = ymd;
+    open_ = true;
+}
+
+size_t write_timeframe_cache(const std::string& base_dir,
+                             const std::string& symbol,
+                             const std::string& timeframe,
+                             int start_ymd,
+                             int end_ymd,
+                             int origin_minutes,
+                             TapeLayout layout,
+                             DayBoundary boundary) {
+    ResampleReader reader(base_dir, symbol, timeframe, start_ymd, end_ymd);
+    reader.set_origin_minutes(origin_minutes);
+    reader.set_day_boundary(boundary);
+    reader.set_use_cache(false);
+    const std::string cache_tf = reader.cache_timeframe();
+
+    const size_t days = write_derived_tapes(reader, base_dir, symbol, cache_tf, layout);
+
+    // Written last: its time stamps the cache against the 1m tapes.
+    write_build_info(base_dir, symbol, cache_tf, "1m", "bars", start_ymd, end_ymd);
+    return days;
+}
+
+}  // namespace datahandler
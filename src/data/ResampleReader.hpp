@@ -0,0 +1,132 @@
+#pragma once
+
+#include "DateUtils.hpp"
+#include "TapeReader.hpp"
+#include "TapeWriter.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace datahandler
+{
+
+    // Minutes in a timeframe label: "<n>m", "<n>h", "<n>d" or "D" (one day).
+    // Returns 0 if the label isn't recognised.
+    uint32_t timeframe_minutes(const std::string &timeframe);
+
+    // Timeframe directory of resampled tapes: the label, plus "@<origin>" when
+    // bucket boundaries are shifted (e.g. "4h", "D@-420").
+    std::string cache_timeframe_name(const std::string &timeframe, int origin_minutes);
+
+    // Streams bars of any whole-minute timeframe built from the 1m tapes in one
+    // pass. A bar covers [bucket, bucket + tf) with bucket = floor((ts - origin) / tf)
+    // * tf + origin and is stamped with the bucket start, like the 1m bars are
+    // stamped with their minute. Open is the first 1m open, close the last
+    // close, high/low the extremes and volume the sum. Buckets without any 1m
+    // bar (weekends, holidays, missing minutes) produce no bar, and a bucket may
+    // span tape days. The only buffer is reused from one source day to the next.
+    //
+    // When write_timeframe_cache() built the timeframe from every 1m day in
+    // range and none of those tapes changed since (see DerivedCache.hpp), the
+    // cached tapes are read directly instead.
+    class ResampleReader
+    {
+    public:
+        // Throws std::runtime_error for an unrecognised timeframe.
+        ResampleReader(std::string base_dir,
+                       std::string symbol,
+                       std::string timeframe,
+                       int start_ymd,
+                       int end_ymd);
+
+        // Shifts bucket boundaries by this many minutes from UTC midnight (e.g.
+        // for a session that doesn't start at 00:00 UTC). Set before the first read.
+        void set_origin_minutes(int minutes) { origin_minutes_ = minutes; }
+        int origin_minutes() const { return origin_minutes_; }
+
+        // With DayBoundary::NewYork1700 a one-day timeframe follows the FX
+        // session instead of a fixed origin: each bar runs from 17:00 New York
+        // to 17:00 the next day (21:00 or 22:00 UTC with DST) and is stamped
+        // with the session start. Other timeframes ignore it. Session bars
+        // are not on a fixed grid, so they have no CalendarIndex.
+        void set_day_boundary(DayBoundary boundary) { clock_ = DayClock(boundary); }
+        DayBoundary day_boundary() const { return clock_.boundary(); }
+
+        // Read cached tapes when they cover the range (default on). Set before the first read.
+        void set_use_cache(bool on) { use_cache_ = on; }
+
+        // Same contract as TapeReader::nextBar/nextBatch. A batch holds the bars
+        // completed by one source day, so it is valid until the next read call.
+        bool nextBar(Bar1m &out);
+        bool nextBatch(BarBatch &out);
+
+        uint64_t bars_read() const { return bars_read_; }
+
+        // YYYYMMDD of the tape day on which bar i of the last batch opened.
+        int batch_day(size_t i) const;
+
+        // The 1m (or cached) reader underneath, e.g. to set a map policy or
+        // prefetch depth. Created on first use.
+        TapeReader &source();
+        const TapeReader &source() const { return *src_; }
+        bool from_cache() const { return from_cache_; }
+
+        // Where write_timeframe_cache() puts this reader's timeframe and origin
+        // ("<label>@NY" for session days).
+        std::string cache_timeframe() const
+        {
+            return session_days() ? timeframe_ + "@NY" : cache_timeframe_name(timeframe_, origin_minutes_);
+        }
+
+        const std::string &symbol() const { return symbol_; }
+        const std::string &timeframe() const { return timeframe_; }
+
+    private:
+        void open_source();
+        bool cache_covers_range(const std::string &cache_tf) const;
+        bool next_chunk();
+        void add(const Bar1m &bar, int ymd);
+        bool session_days() const { return tf_ns_ == NS_PER_DAY && clock_.boundary() == DayBoundary::NewYork1700; }
+
+        std::string base_dir_;
+        std::string symbol_;
+        std::string timeframe_;
+        int start_ymd_;
+        int end_ymd_;
+        uint64_t tf_ns_;
+        int origin_minutes_ = 0;
+        DayClock clock_;
+        bool use_cache_ = true;
+
+        std::unique_ptr<TapeReader> src_;
+        bool from_cache_ = false;
+
+        Bar1m cur_{};          // bucket being built
+        int cur_ymd_ = 0;
+        bool open_ = false;
+        bool src_done_ = false;
+
+        std::vector<Bar1m> out_;   // bars completed by the last source day
+        std::vector<int> out_ymd_; // opening day of each out_ bar
+        BarBatch chunk_;           // out_, or the last cached batch
+        size_t pos_ = 0;           // next bar of chunk_ to hand out
+        size_t batch_start_ = 0;   // chunk_ index of the last nextBatch() view
+        uint64_t bars_read_ = 0;
+    };
+
+    // Resamples [start_ymd, end_ymd] and writes the result as daily tapes (and
+    // catalog) under BASE_DIR/bars/SYMBOL/<cache_timeframe()>/, each bar filed
+    // under the day it opened, plus the 1m days they were built from
+    // (write_build_info). Returns the number of days written.
+    // boundary is passed to ResampleReader::set_day_boundary().
+    size_t write_timeframe_cache(const std::string &base_dir,
+                                 const std::string &symbol,
+                                 const std::string &timeframe,
+                                 int start_ymd,
+                                 int end_ymd,
+                                 int origin_minutes = 0,
+                                 TapeLayout layout = TapeLayout::Rows,
+                                 DayBoundary boundary = DayBoundary::UtcMidnight);
+
+} // namespace datahandler
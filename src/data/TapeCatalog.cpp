@@ -0,0 +1,396 @@
+#include "TapeCatalog.hpp"
+#include "TapeTypes.hpp"
+#include "DateUtils.hpp"
+#include "TapePack.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace datahandler {
+
+namespace {
+    namespace fs = std::filesystem;
+
+    constexpr char CATALOG_MAGIC[8] = {'C', 'A', 'T', 'v', '0', '0', '1', '\0'};
+
+    bool read_tape_header(const fs::path& path, TapeHeader& hdr) {
+        std::ifstream f(path, std::ios::binary);
+        if (!f)
+            return false;
+        f.read(reinterpret_cast<char*>(&hdr), sizeof(TapeHeader));
+        if (!f)
+            return false;
+        return is_supported_tape(hdr) || is_tick_tape(hdr);
+    }
+
+    // "SYMBOL_YYYYMMDD.tape" -> YYYYMMDD, or 0 if the name doesn't match.
+    int parse_day(const std::string& name, const std::string& symbol) {
+        const std::string prefix = symbol + "_";
+        if (name.size() != prefix.size() + 8 + 5 ||
+            name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - 5, 5, ".tape") != 0)
+            return 0;
+        int ymd = 0;
+        for (size_t i = prefix.size(); i < prefix.size() + 8; ++i) {
+            const char c = name[i];
+            if (c < '0' || c > '9')
+                return 0;
+            ymd = ymd * 10 + (c - '0');
+        }
+        return ymd;
+    }
+
+    // "SYMBOL_YYYY.tapepack" -> YYYY, or 0 if the name doesn't match.
+    int parse_pack_year(const std::string& name, const std::string& symbol) {
+        const std::string prefix = symbol + "_";
+        if (name.size() != prefix.size() + 4 + 9 ||
+            name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - 9, 9, ".tapepack") != 0)
+            return 0;
+        int year = 0;
+        for (size_t i = prefix.size(); i < prefix.size() + 4; ++i) {
+            const char c = name[i];
+            if (c < '0' || c > '9')
+                return 0;
+            year = year * 10 + (c - '0');
+        }
+        return year;
+    }
+
+    uint64_t fnv1a(const void* data, size_t n) {
+        uint64_t h = 1469598103934665603ull;
+        const auto* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < n; ++i) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    fs::path tape_root(const std::string& base_dir, const std::string& symbol, const std::string& timeframe) {
+        return fs::path(base_dir) / "bars" / symbol / timeframe;
+    }
+
+    // FNV-1a over the name and write time of every year directory under root,
+    // in name order. Files directly in root (the catalog and other indexes)
+    // don't count, so saving them leaves the stamp alone.
+    uint64_t year_dirs_stamp(const fs::path& root) {
+        std::vector<std::pair<std::string, int64_t>> years;
+        std::error_code ec;
+        for (fs::directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+            std::error_code st;
+            if (!it->is_directory(st))
+                continue;
+            const auto t = it->last_write_time(st);
+            if (!st)
+                years.emplace_back(it->path().filename().string(),
+                                   static_cast<int64_t>(t.time_since_epoch().count()));
+        }
+        std::sort(years.begin(), years.end());
+
+        uint64_t h = 1469598103934665603ull;
+        auto mix = [&h](const void* data, size_t n) {
+            const auto* p = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < n; ++i) {
+                h ^= p[i];
+                h *= 1099511628211ull;
+            }
+        };
+        for (const auto& y : years) {
+            mix(y.first.data(), y.first.size() + 1);
+            mix(&y.second, sizeof(y.second));
+        }
+        return h != 0 ? h : 1;
+    }
+}
+
+bool TapeCatalog::load(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+
+    CatalogHeader hdr{};
+    bool ok = std::fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+              std::memcmp(hdr.magic, CATALOG_MAGIC, 8) == 0 &&
+              hdr.version == 2 &&
+              hdr.entry_size == sizeof(CatalogEntry);
+
+    std::vector<CatalogEntry> entries;
+    if (ok) {
+        entries.resize(static_cast<size_t>(hdr.entry_count));
+        ok = entries.empty() ||
+             std::fread(entries.data(), sizeof(CatalogEntry), entries.size(), f) == entries.size();
+    }
+    std::fclose(f);
+
+    if (!ok)
+        return false;
+
+    entries_ = std::move(entries);
+    tree_stamp_ = hdr.tree_stamp;
+    rehash();
+    return true;
+}
+
+void TapeCatalog::save(const std::string& path) const {
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error("Cannot write catalog: " + tmp);
+
+        CatalogHeader hdr{};
+        std::memcpy(hdr.magic, CATALOG_MAGIC, 8);
+        hdr.version = 2;
+        hdr.entry_size = sizeof(CatalogEntry);
+        hdr.entry_count = entries_.size();
+        hdr.tree_stamp = tree_stamp_;
+
+        f.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        f.write(reinterpret_cast<const char*>(entries_.data()),
+                static_cast<std::streamsize>(entries_.size() * sizeof(CatalogEntry)));
+        if (!f)
+            throw std::runtime_error("Failed writing catalog: " + tmp);
+    }
+
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec)
+        throw std::runtime_error("Failed renaming catalog: " + path + " (" + ec.message() + ")");
+}
+
+size_t TapeCatalog::update(const std::string& base_dir,
+                           const std::string& symbol,
+                           const std::string& timeframe) {
+    std::unordered_map<int, CatalogEntry> known;
+    known.reserve(entries_.size());
+    for (const auto& e : entries_)
+        known.emplace(e.ymd, e);
+
+    std::vector<CatalogEntry> fresh;
+    fresh.reserve(entries_.size() + 366);
+    size_t changed = 0;
+
+    // Stamped before the scan: a tape written while it runs leaves the stamp
+    // stale, so the next load rescans.
+    const fs::path root = tape_root(base_dir, symbol, timeframe);
+    const uint64_t stamp = year_dirs_stamp(root);
+    std::error_code ec;
+    for (const auto& year : fs::directory_iterator(root, ec)) {
+        if (!year.is_directory())
+            continue;
+        for (const auto& file : fs::directory_iterator(year.path(), ec)) {
+            if (!file.is_regular_file())
+                continue;
+            const std::string name = file.path().filename().string();
+            const int ymd = parse_day(name, symbol);
+            if (ymd == 0) {
+                const int pack_year = parse_pack_year(name, symbol);
+                if (pack_year != 0)
+                    changed += scan_pack(file.path().string(), pack_year,
+                                         static_cast<uint64_t>(file.file_size()),
+                                         static_cast<int64_t>(file.last_write_time().time_since_epoch().count()),
+                                         known, fresh);
+                continue;
+            }
+
+            const uint64_t bytes = static_cast<uint64_t>(file.file_size());
+            const int64_t mtime = static_cast<int64_t>(file.last_write_time().time_since_epoch().count());
+
+            auto it = known.find(ymd);
+            if (it != known.end() && it->second.pack_offset == 0 &&
+                it->second.file_bytes == bytes && it->second.mtime == mtime) {
+                fresh.push_back(it->second);
+                known.erase(it);
+                continue;
+            }
+
+            TapeHeader hdr{};
+            if (!read_tape_header(file.path(), hdr) || hdr.record_count == 0)
+                continue;
+
+            CatalogEntry e{};
+            e.ymd = ymd;
+            e.version = static_cast<uint16_t>(hdr.version);
+            e.record_type = static_cast<uint16_t>(hdr.record_type);
+            e.record_count = hdr.record_count;
+            e.first_ts_ns = hdr.start_ts_ns;
+            e.last_ts_ns = hdr.end_ts_ns;
+            e.file_bytes = bytes;
+            e.mtime = mtime;
+            fresh.push_back(e);
+
+            if (it != known.end())
+                known.erase(it);
+            ++changed;
+        }
+    }
+
+    // Whatever is left in `known` no longer exists on disk.
+    changed += known.size();
+
+    // Standalone tapes sort ahead of a packed copy of the same day, which is dropped.
+    std::sort(fresh.begin(), fresh.end(), [](const CatalogEntry& a, const CatalogEntry& b) {
+        return a.ymd != b.ymd ? a.ymd < b.ymd : a.pack_offset < b.pack_offset;
+    });
+    fresh.erase(std::unique(fresh.begin(), fresh.end(),
+                            [](const CatalogEntry& a, const CatalogEntry& b) { return a.ymd == b.ymd; }),
+                fresh.end());
+    entries_ = std::move(fresh);
+    tree_stamp_ = stamp;
+    rehash();
+    return changed;
+}
+
+bool TapeCatalog::is_current(const std::string& base_dir,
+                             const std::string& symbol,
+                             const std::string& timeframe) const {
+    return tree_stamp_ != 0 && tree_stamp_ == year_dirs_stamp(tape_root(base_dir, symbol, timeframe));
+}
+
+size_t TapeCatalog::scan_pack(const std::string& path, int year, uint64_t bytes, int64_t mtime,
+                              std::unordered_map<int, CatalogEntry>& known,
+                              std::vector<CatalogEntry>& fresh) const {
+    // Unchanged container: reuse its entries if they are all still listed
+    // (days shadowed by a standalone tape aren't, so those force a re-read).
+    PackHeader ph{};
+    if (!TapePack::read_header(path, ph))
+        return 0;
+    const Span old = range(year * 10000, year * 10000 + 1231);
+    size_t listed = 0;
+    for (const auto& e : old)
+        if (e.pack_offset != 0 && e.file_bytes == bytes && e.mtime == mtime)
+            ++listed;
+    if (listed == ph.day_count) {
+        for (const auto& e : old) {
+            if (e.pack_offset != 0 && e.file_bytes == bytes && e.mtime == mtime) {
+                fresh.push_back(e);
+                known.erase(e.ymd);
+            }
+        }
+        return 0;
+    }
+
+    TapePack pack;
+    try {
+        if (!pack.open(path))
+            return 0;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Warning: %s\n", e.what());
+        return 0;
+    }
+
+    size_t changed = 0;
+    for (const auto& d : pack.days()) {
+        TapeHeader hdr{};
+        std::memcpy(&hdr, pack.day_data(d), sizeof(hdr));
+        if (std::memcmp(hdr.magic, "TAPEv001", 8) != 0 || !(is_supported_tape(hdr) || is_tick_tape(hdr)) || hdr.record_count == 0)
+            continue;
+
+        CatalogEntry e{};
+        e.ymd = d.ymd;
+        e.version = static_cast<uint16_t>(hdr.version);
+        e.record_type = static_cast<uint16_t>(hdr.record_type);
+        e.record_count = hdr.record_count;
+        e.first_ts_ns = hdr.start_ts_ns;
+        e.last_ts_ns = hdr.end_ts_ns;
+        e.file_bytes = bytes;
+        e.mtime = mtime;
+        e.pack_offset = d.offset;
+        fresh.push_back(e);
+
+        // A standalone tape of the same day shadows this copy; leave it to the
+        // daily file scan.
+        auto prev = std::lower_bound(old.begin(), old.end(), d.ymd,
+                                     [](const CatalogEntry& c, int ymd) { return c.ymd < ymd; });
+        const bool listed_before = prev != old.end() && prev->ymd == d.ymd;
+        if (listed_before && prev->pack_offset == 0)
+            continue;
+        known.erase(d.ymd);
+        if (!listed_before || std::memcmp(&*prev, &e, sizeof(e)) != 0)
+            ++changed;
+    }
+    return changed;
+}
+
+std::shared_ptr<const TapeCatalog> TapeCatalog::load_or_build(const std::string& base_dir,
+                                                              const std::string& symbol,
+                                                              const std::string& timeframe) {
+    auto cat = std::make_shared<TapeCatalog>();
+    const std::string path = make_catalog_path(base_dir, symbol, timeframe);
+    if (cat->load(path) && cat->is_current(base_dir, symbol, timeframe))
+        return cat;
+
+    // Missing, or some year directory changed since it was saved: days added,
+    // removed or rebuilt show up as new, missing or changed size/mtime.
+    // Saved even when no day changed, so the new stamp spares the next load
+    // the rescan.
+    cat->update(base_dir, symbol, timeframe);
+    if (!cat->entries().empty()) {
+        try {
+            cat->save(path);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "Warning: %s\n", e.what());
+        }
+    }
+    return cat;
+}
+
+TapeCatalog::Span TapeCatalog::range(int start_ymd, int end_ymd) const {
+    auto lo = std::lower_bound(entries_.begin(), entries_.end(), start_ymd,
+                               [](const CatalogEntry& e, int ymd) { return e.ymd < ymd; });
+    auto hi = std::upper_bound(lo, entries_.end(), end_ymd,
+                               [](int ymd, const CatalogEntry& e) { return ymd < e.ymd; });
+    Span s;
+    s.first = entries_.data() + (lo - entries_.begin());
+    s.last = entries_.data() + (hi - entries_.begin());
+    return s;
+}
+
+bool TapeCatalog::time_range(int start_ymd, int end_ymd, uint64_t& first_ts, uint64_t& last_ts) const {
+    const Span s = range(start_ymd, end_ymd);
+    if (s.empty())
+        return false;
+    first_ts = s.first->first_ts_ns;
+    last_ts = (s.last - 1)->last_ts_ns;
+    return true;
+}
+
+uint64_t TapeCatalog::record_count(int start_ymd, int end_ymd) const {
+    uint64_t n = 0;
+    for (const auto& e : range(start_ymd, end_ymd))
+        n += e.record_count;
+    return n;
+}
+
+uint64_t TapeCatalog::fingerprint(int start_ymd, int end_ymd) const {
+    const Span s = range(start_ymd, end_ymd);
+    return fnv1a(s.first, s.size() * sizeof(CatalogEntry));
+}
+
+int TapeCatalog::warmup_start(int start_ymd, uint64_t warmup_bars) const {
+    const Span before = range(0, start_ymd - 1);
+    int ymd = start_ymd;
+    uint64_t got = 0;
+    for (const CatalogEntry* e = before.last; e != before.first && got < warmup_bars;) {
+        --e;
+        got += e->record_count;
+        ymd = e->ymd;
+    }
+    return ymd;
+}
+
+void TapeCatalog::rehash() {
+    fingerprint_ = fnv1a(entries_.data(), entries_.size() * sizeof(CatalogEntry));
+}
+
+}  // namespace datahandler
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace datahandler
+{
+
+#pragma pack(push, 1)
+    struct CatalogHeader
+    {
+        char magic[8];        // "CATv001\0"
+        uint32_t version;     // 2
+        uint32_t entry_size;  // sizeof(CatalogEntry)
+        uint64_t entry_count;
+        uint64_t tree_stamp;  // year directories seen by the last update (0: unknown)
+        uint8_t reserved[8];
+    };
+
+    // One daily tape. Sorted by ymd in the file and in memory.
+    struct CatalogEntry
+    {
+        int32_t ymd;            // YYYYMMDD
+        uint16_t version;       // TapeHeader::version
+        uint16_t record_type;   // TapeHeader::record_type
+        uint64_t record_count;
+        uint64_t first_ts_ns;
+        uint64_t last_ts_ns;
+        uint64_t file_bytes;    // of the tape, or of the whole container for packed days
+        int64_t mtime;          // filesystem write time (raw ticks), for incremental updates
+        uint64_t pack_offset;   // 0: standalone tape; else offset of the day in SYMBOL_YYYY.tapepack
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(CatalogHeader) == 40, "CatalogHeader must be 40 bytes");
+    static_assert(sizeof(CatalogEntry) == 56, "CatalogEntry must be 56 bytes");
+
+    // Per symbol/timeframe listing of every daily tape on disk, whether stored
+    // as its own file or inside a year container (see TapePack).
+    // Lives at BASE_DIR/bars/SYMBOL/TIMEFRAME/SYMBOL_TIMEFRAME.catalog
+    // (see make_catalog_path). Loading is a single read of the file; updating
+    // lists the year directories and only re-reads headers of tapes whose size
+    // or write time changed. A day present both standalone and in a container
+    // is listed once, as the standalone tape.
+    //
+    // The catalog also records the names and write times of the year
+    // directories it was built from. Adding, removing or renaming a file in a
+    // directory changes its write time, and the writers here replace tapes by
+    // renaming a temp file over them, so comparing those stamps (one stat per
+    // year) tells whether the catalog still matches the tree. A tape
+    // overwritten in place by some other tool needs an explicit update
+    // (tapetool catalog).
+    class TapeCatalog
+    {
+    public:
+        struct Span
+        {
+            const CatalogEntry *first = nullptr;
+            const CatalogEntry *last = nullptr; // one past the end
+
+            const CatalogEntry *begin() const { return first; }
+            const CatalogEntry *end() const { return last; }
+            size_t size() const { return static_cast<size_t>(last - first); }
+            bool empty() const { return first == last; }
+        };
+
+        TapeCatalog() = default;
+
+        // Returns false if the file is missing or not a valid catalog.
+        bool load(const std::string &path);
+
+        // Writes via a temp file + rename. Throws on I/O failure.
+        void save(const std::string &path) const;
+
+        // Rescans the tape tree. Returns the number of added, changed or removed days.
+        size_t update(const std::string &base_dir,
+                      const std::string &symbol,
+                      const std::string &timeframe);
+
+        // True when the year directories still look as they did at the last
+        // update: one stat per year, no per-tape checks.
+        bool is_current(const std::string &base_dir,
+                        const std::string &symbol,
+                        const std::string &timeframe) const;
+
+        // Loads the catalog and, unless is_current, brings it up to date with
+        // the tape tree (see update), building it if it is missing, and saves
+        // it (a read-only data directory is not an error).
+        static std::shared_ptr<const TapeCatalog> load_or_build(const std::string &base_dir,
+                                                                const std::string &symbol,
+                                                                const std::string &timeframe);
+
+        const std::vector<CatalogEntry> &entries() const { return entries_; }
+
+        // Entries with start_ymd <= ymd <= end_ymd.
+        Span range(int start_ymd, int end_ymd) const;
+
+        // Totals over a range; false if the range holds no tapes.
+        bool time_range(int start_ymd, int end_ymd, uint64_t &first_ts, uint64_t &last_ts) const;
+        uint64_t record_count(int start_ymd, int end_ymd) const;
+
+        // FNV-1a over all entries: changes whenever any tape is added, rebuilt or removed.
+        uint64_t fingerprint() const { return fingerprint_; }
+
+        // The same over the entries of range(start_ymd, end_ymd) only, for data
+        // derived from those days, which tapes outside the range can't affect.
+        uint64_t fingerprint(int start_ymd, int end_ymd) const;
+
+        // First day of the warmup_bars bars before start_ymd (what
+        // TapeReader::seek_with_warmup reads from a day's start), or start_ymd
+        // when the catalog has none before it.
+        int warmup_start(int start_ymd, uint64_t warmup_bars) const;
+
+    private:
+        void rehash();
+        size_t scan_pack(const std::string &path, int year, uint64_t bytes, int64_t mtime,
+                         std::unordered_map<int, CatalogEntry> &known,
+                         std::vector<CatalogEntry> &fresh) const;
+
+        std::vector<CatalogEntry> entries_;
+        uint64_t fingerprint_ = 0;
+        uint64_t tree_stamp_ = 0;
+    };
+
+} // namespace datahandler
@@ -0,0 +1,102 @@
+#include "TapeChecksum.hpp"
+#include "Crc32c.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace datahandler {
+
+namespace {
+    void die_if(bool cond, const char* msg) {
+        if (cond) throw std::runtime_error(msg);
+    }
+
+    constexpr size_t HEADER_CRC_BYTES = offsetof(TapeHeader, header_crc);
+}
+
+void add_tape_checksums(std::vector<uint8_t>& tape, uint32_t block_size) {
+    die_if(block_size == 0, "add_tape_checksums: block size must be > 0");
+    die_if(tape.size() <= sizeof(TapeHeader), "add_tape_checksums: tape has no payload");
+
+    TapeHeader hdr{};
+    std::memcpy(&hdr, tape.data(), sizeof(hdr));
+    if (hdr.crc_block_size != 0 && hdr.crc_table_offset > sizeof(TapeHeader) &&
+        hdr.crc_table_offset <= tape.size())
+        tape.resize(static_cast<size_t>(hdr.crc_table_offset));
+
+    const size_t end = static_cast<size_t>(align_up(tape.size(), 8));
+    const size_t payload = end - sizeof(TapeHeader);
+    const size_t blocks = (payload + block_size - 1) / block_size;
+    tape.resize(end + blocks * sizeof(uint32_t), 0);
+
+    uint32_t file_crc = 0;
+    for (size_t b = 0; b < blocks; ++b) {
+        const size_t off = sizeof(TapeHeader) + b * block_size;
+        const size_t len = std::min<size_t>(block_size, end - off);
+        const uint32_t crc = crc32c(0, tape.data() + off, len);
+        std::memcpy(tape.data() + end + b * sizeof(uint32_t), &crc, sizeof(crc));
+        file_crc = crc32c_combine(file_crc, crc, len);
+    }
+
+    hdr.crc_block_size = block_size;
+    hdr.crc_block_count = static_cast<uint32_t>(blocks);
+    hdr.crc_table_offset = end;
+    hdr.file_crc = file_crc;
+    hdr.header_crc = crc32c(0, &hdr, HEADER_CRC_BYTES);
+    std::memcpy(tape.data(), &hdr, sizeof(hdr));
+}
+
+bool TapeChecksums::bind(const uint8_t* tape, size_t size) {
+    tape_ = nullptr;
+    block_count_ = 0;
+    die_if(size < sizeof(TapeHeader), "File too small");
+
+    TapeHeader hdr{};
+    std::memcpy(&hdr, tape, sizeof(hdr));
+    if (hdr.crc_block_size == 0)
+        return false;
+
+    die_if(crc32c(0, &hdr, HEADER_CRC_BYTES) != hdr.header_crc, "Tape header checksum mismatch");
+    const uint64_t end = hdr.crc_table_offset;
+    die_if(end <= sizeof(TapeHeader) || end % 8 != 0 || end > size, "Bad checksum table offset");
+    const uint64_t payload = end - sizeof(TapeHeader);
+    die_if(hdr.crc_block_count != (payload + hdr.crc_block_size - 1) / hdr.crc_block_size ||
+           hdr.crc_block_count > (size - end) / sizeof(uint32_t),
+           "Bad checksum table size");
+
+    tape_ = tape;
+    end_ = end;
+    block_size_ = hdr.crc_block_size;
+    block_count_ = hdr.crc_block_count;
+    file_crc_ = hdr.file_crc;
+    return true;
+}
+
+uint32_t TapeChecksums::stored_crc(size_t b) const {
+    uint32_t crc;
+    std::memcpy(&crc, tape_ + end_ + b * sizeof(uint32_t), sizeof(crc));
+    return crc;
+}
+
+bool TapeChecksums::check_block(size_t b) const {
+    const uint64_t off = sizeof(TapeHeader) + static_cast<uint64_t>(b) * block_size_;
+    const size_t len = static_cast<size_t>(std::min<uint64_t>(block_size_, end_ - off));
+    return crc32c(0, tape_ + off, len) == stored_crc(b);
+}
+
+size_t TapeChecksums::check_all() const {
+    uint32_t file_crc = 0;
+    for (size_t b = 0; b < block_count_; ++b) {
+        const uint64_t off = sizeof(TapeHeader) + static_cast<uint64_t>(b) * block_size_;
+        const size_t len = static_cast<size_t>(std::min<uint64_t>(block_size_, end_ - off));
+        const uint32_t crc = crc32c(0, tape_ + off, len);
+        if (crc != stored_crc(b))
+            return b;
+        file_crc = crc32c_combine(file_crc, crc, len);
+    }
+    return file_crc == file_crc_ ? ALL_OK : block_count_;
+}
+
+}  // namespace datahandler
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "TapeTypes.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace datahandler
+{
+
+    // Payload bytes per block CRC: one page, so lazy verification checks about
+    // as much as a reader actually faults in.
+    constexpr uint32_t TAPE_CRC_BLOCK = 4096;
+
+    // Tape checksums, stored in the TapeHeader fields after record_count:
+    //   header_crc  covers the header bytes before it (checksum fields included),
+    //   file_crc    covers the payload [sizeof(TapeHeader), crc_table_offset),
+    //   block CRCs  one per crc_block_size bytes of that payload, as a uint32_t
+    //               table at crc_table_offset (8-byte aligned, after the payload).
+    // Every layout keeps its offsets, so readers that predate checksums still
+    // read checksummed tapes, and tapes without them (crc_block_size == 0) load
+    // as before.
+    //
+    // Appends the block table to a complete tape (all of `tape`) and fills the
+    // header fields. A table already present is replaced.
+    void add_tape_checksums(std::vector<uint8_t> &tape, uint32_t block_size = TAPE_CRC_BLOCK);
+
+    // Verifies the checksums of one tape held in memory (mapped file or
+    // container slice). Holds pointers into the tape; keep it mapped.
+    class TapeChecksums
+    {
+    public:
+        static constexpr size_t ALL_OK = static_cast<size_t>(-1);
+
+        // Returns false when the tape carries no checksums. Throws
+        // std::runtime_error when the header CRC doesn't match or the checksum
+        // fields don't fit the tape.
+        bool bind(const uint8_t *tape, size_t size);
+
+        bool present() const { return block_count_ > 0; }
+        size_t block_count() const { return block_count_; }
+        uint32_t block_size() const { return block_size_; }
+        uint64_t payload_end() const { return end_; }
+
+        // Block holding tape byte `offset` (offset >= sizeof(TapeHeader)).
+        size_t block_of(uint64_t offset) const
+        {
+            return static_cast<size_t>((offset - sizeof(TapeHeader)) / block_size_);
+        }
+
+        bool check_block(size_t b) const;
+
+        // One pass over the whole payload: returns ALL_OK, the first block whose
+        // CRC doesn't match, or block_count() when only the file CRC is wrong.
+        size_t check_all() const;
+
+    private:
+        uint32_t stored_crc(size_t b) const;
+
+        const uint8_t *tape_ = nullptr;
+        uint64_t end_ = 0; // crc_table_offset
+        uint32_t block_size_ = 0;
+        size_t block_count_ = 0;
+        uint32_t file_crc_ = 0;
+    };
+
+} // namespace datahandler
@@ -0,0 +1,531 @@
+#include "TapeCodec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace datahandler {
+
+namespace {
+    void die_if(bool cond, const char* msg) {
+        if (cond) throw std::runtime_error(msg);
+    }
+
+    // Widest stream we pack; keeps every value inside one unaligned 8-byte load.
+    constexpr unsigned MAX_BITS = 57;
+    // Slack after each block so the decoder's 8-byte loads never leave the file.
+    constexpr size_t BLOCK_PAD = 8;
+
+    enum Stream { S_TS, S_OPEN, S_HIGH, S_LOW, S_CLOSE, S_VOL, S_COUNT };
+    enum TickStream { T_TS, T_BID, T_SPREAD, T_SIZE, T_COUNT };
+
+    constexpr double POW10[10] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+    inline uint64_t zigzag(int64_t v) {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t u) {
+        return static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+    }
+
+    // Two's-complement add; a corrupt block must not be undefined behaviour.
+    inline int64_t wrap_add(int64_t a, int64_t b) {
+        return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+    }
+
+    inline unsigned bit_width(uint64_t max_value) {
+        return static_cast<unsigned>(std::bit_width(max_value));
+    }
+
+    inline size_t stream_bytes(size_t count, unsigned bits) {
+        return (count * bits + 7) / 8;
+    }
+
+    // True when x survives scaling to an integer at `scale` bit-for-bit.
+    inline bool exact_at(double x, double scale) {
+        const double scaled = x * scale;
+        if (!(std::fabs(scaled) < 9007199254740992.0))
+            return false;
+        const double back = static_cast<double>(std::llround(scaled)) / scale;
+        return std::bit_cast<uint64_t>(back) == std::bit_cast<uint64_t>(x);
+    }
+
+    // Smallest number of decimals that reproduces every price exactly, or -1.
+    int pick_decimals(const Bar1m* recs, size_t n) {
+        for (int d = 0; d < 10; ++d) {
+            const double scale = POW10[d];
+            bool ok = true;
+            for (size_t i = 0; i < n && ok; ++i)
+                ok = exact_at(recs[i].open, scale) && exact_at(recs[i].high, scale) &&
+                     exact_at(recs[i].low, scale) && exact_at(recs[i].close, scale);
+            if (ok)
+                return d;
+        }
+        return -1;
+    }
+
+    int pick_decimals(const Tick* ticks, size_t n) {
+        for (int d = 0; d < 10; ++d) {
+            const double scale = POW10[d];
+            bool ok = true;
+            for (size_t i = 0; i < n && ok; ++i)
+                ok = exact_at(ticks[i].bid, scale) && exact_at(ticks[i].ask, scale);
+            if (ok)
+                return d;
+        }
+        return -1;
+    }
+
+    // Common check for integral volumes/sizes stored as offsets (exact in a float).
+    inline bool integral_size(float v) {
+        return v >= 0.0f && v < 16777216.0f && v == std::floor(v) && !std::signbit(v);
+    }
+
+    // ORs n values of `bits` width into dst, LSB first. dst must be zeroed and
+    // have 8 bytes of slack past stream_bytes(n, bits).
+    void pack(uint8_t* dst, const uint64_t* v, size_t n, unsigned bits) {
+        if (bits == 0)
+            return;
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t bit = static_cast<uint64_t>(i) * bits;
+            uint64_t w;
+            std::memcpy(&w, dst + (bit >> 3), 8);
+            w |= v[i] << (bit & 7);
+            std::memcpy(dst + (bit >> 3), &w, 8);
+        }
+    }
+
+    // Inverse of pack() for one width. Groups of 8 values span exactly B bytes,
+    // so every load offset and shift is a constant and the loop has no
+    // loop-carried state; the generic form spent most of a tick decode here.
+    template <unsigned B>
+    void unpack_fixed(const uint8_t* src, uint64_t* out, size_t n) {
+        constexpr uint64_t mask = (uint64_t{1} << B) - 1;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8, src += B) {
+            [&]<size_t... J>(std::index_sequence<J...>) {
+                ((void)[&] {
+                    uint64_t w;
+                    std::memcpy(&w, src + (J * B) / 8, 8);
+                    out[i + J] = (w >> ((J * B) % 8)) & mask;
+                }(), ...);
+            }(std::make_index_sequence<8>{});
+        }
+        for (size_t bit = 0; i < n; ++i, bit += B) {
+            uint64_t w;
+            std::memcpy(&w, src + bit / 8, 8);
+            out[i] = (w >> (bit % 8)) & mask;
+        }
+    }
+
+    using UnpackFn = void (*)(const uint8_t*, uint64_t*, size_t);
+
+    template <size_t... B>
+    constexpr std::array<UnpackFn, sizeof...(B)> make_unpackers(std::index_sequence<B...>) {
+        return {&unpack_fixed<static_cast<unsigned>(B) + 1>...};
+    }
+
+    constexpr auto UNPACKERS = make_unpackers(std::make_index_sequence<MAX_BITS>{});
+
+    void unpack(const uint8_t* src, uint64_t* out, size_t n, unsigned bits) {
+        if (bits == 0) {
+            std::fill(out, out + n, 0);
+            return;
+        }
+        UNPACKERS[bits - 1](src, out, n);
+    }
+}
+
+bool encode_packed_tape(const Bar1m* recs, size_t n, std::vector<uint8_t>& out) {
+    if (n == 0)
+        return false;
+
+    const int decimals = pick_decimals(recs, n);
+    if (decimals < 0)
+        return false;
+    const double scale = POW10[decimals];
+
+    uint64_t ts_unit = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (recs[i].ts_ns < recs[i - 1].ts_ns)
+            return false;
+        ts_unit = std::gcd(ts_unit, recs[i].ts_ns - recs[i - 1].ts_ns);
+    }
+    if (ts_unit == 0)
+        ts_unit = 1;
+
+    const uint32_t block_count = static_cast<uint32_t>((n + PACKED_BLOCK_BARS - 1) / PACKED_BLOCK_BARS);
+    const size_t offsets_at = sizeof(TapeHeader) + sizeof(PackedDirectory);
+    size_t off = offsets_at + block_count * sizeof(uint64_t);
+
+    out.assign(off, 0);
+
+    TapeHeader hdr{};
+    std::memcpy(hdr.magic, "TAPEv001", 8);
+    hdr.version = 3;
+    hdr.record_type = RECORD_BAR_1M_PACKED;
+    hdr.record_size = sizeof(Bar1m);
+    hdr.start_ts_ns = recs[0].ts_ns;
+    hdr.end_ts_ns = recs[n - 1].ts_ns;
+    hdr.record_count = n;
+    std::memcpy(out.data(), &hdr, sizeof(hdr));
+
+    PackedDirectory dir{};
+    dir.block_size = PACKED_BLOCK_BARS;
+    dir.block_count = block_count;
+    dir.price_decimals = static_cast<uint32_t>(decimals);
+    dir.ts_unit = ts_unit;
+    std::memcpy(out.data() + sizeof(TapeHeader), &dir, sizeof(dir));
+
+    auto P = [scale](double x) { return std::llround(x * scale); };
+
+    uint64_t vals[S_COUNT][PACKED_BLOCK_BARS];
+    for (uint32_t b = 0; b < block_count; ++b) {
+        const size_t s = static_cast<size_t>(b) * PACKED_BLOCK_BARS;
+        const size_t c = std::min<size_t>(PACKED_BLOCK_BARS, n - s);
+        const Bar1m* r = recs + s;
+
+        PackedBlockHeader bh{};
+        bh.ts0 = r[0].ts_ns;
+        bh.ref_close = (s == 0) ? P(r[0].open) : P(recs[s - 1].close);
+        bh.count = static_cast<uint32_t>(c);
+
+        // Timestamps: (delta / ts_unit) - min over bars 1..c-1.
+        int64_t ts_min = 0;
+        for (size_t i = 1; i < c; ++i) {
+            const int64_t d = static_cast<int64_t>((r[i].ts_ns - r[i - 1].ts_ns) / ts_unit);
+            ts_min = (i == 1) ? d : std::min(ts_min, d);
+        }
+        bh.ts_min = ts_min;
+        vals[S_TS][0] = 0;
+        for (size_t i = 1; i < c; ++i)
+            vals[S_TS][i] = static_cast<uint64_t>((r[i].ts_ns - r[i - 1].ts_ns) / ts_unit) - static_cast<uint64_t>(ts_min);
+
+        int64_t prev = bh.ref_close;
+        for (size_t i = 0; i < c; ++i) {
+            const int64_t close = P(r[i].close);
+            vals[S_OPEN][i] = zigzag(P(r[i].open) - prev);
+            vals[S_HIGH][i] = zigzag(P(r[i].high) - prev);
+            vals[S_LOW][i] = zigzag(P(r[i].low) - prev);
+            vals[S_CLOSE][i] = zigzag(close - prev);
+            prev = close;
+        }
+
+        // Volumes: integral offsets from the block minimum, else raw float bits.
+        bool integral = true;
+        int64_t vol_min = 0;
+        for (size_t i = 0; i < c && integral; ++i) {
+            const float v = r[i].volume;
+            integral = integral_size(v);
+            if (integral)
+                vol_min = (i == 0) ? static_cast<int64_t>(v) : std::min(vol_min, static_cast<int64_t>(v));
+        }
+        bh.vol_raw = integral ? 0 : 1;
+        bh.vol_min = integral ? vol_min : 0;
+        for (size_t i = 0; i < c; ++i)
+            vals[S_VOL][i] = integral ? static_cast<uint64_t>(static_cast<int64_t>(r[i].volume) - vol_min)
+                                      : std::bit_cast<uint32_t>(r[i].volume);
+
+        size_t payload = 0;
+        for (int k = 0; k < S_COUNT; ++k) {
+            uint64_t mx = 0;
+            for (size_t i = 0; i < c; ++i)
+                mx |= vals[k][i];
+            const unsigned bits = bit_width(mx);
+            if (bits > MAX_BITS)
+                return false;
+            bh.bits[k] = static_cast<uint8_t>(bits);
+            payload += stream_bytes(c, bits);
+        }
+
+        const uint64_t block_at = off;
+        std::memcpy(out.data() + offsets_at + b * sizeof(uint64_t), &block_at, sizeof(block_at));
+        out.resize(off + sizeof(PackedBlockHeader) + payload + BLOCK_PAD, 0);
+        std::memcpy(out.data() + off, &bh, sizeof(bh));
+        off += sizeof(PackedBlockHeader);
+        for (int k = 0; k < S_COUNT; ++k) {
+            pack(out.data() + off, vals[k], c, bh.bits[k]);
+            off += stream_bytes(c, bh.bits[k]);
+        }
+        off += BLOCK_PAD;
+    }
+    return true;
+}
+
+void decode_packed_tape(const uint8_t* file, size_t size, std::vector<Bar1m>& out) {
+    die_if(size < sizeof(TapeHeader) + sizeof(PackedDirectory), "Packed tape too small");
+    TapeHeader hdr{};
+    PackedDirectory dir{};
+    std::memcpy(&hdr, file, sizeof(hdr));
+    std::memcpy(&dir, file + sizeof(TapeHeader), sizeof(dir));
+
+    const uint64_t n = hdr.record_count;
+    const size_t offsets_at = sizeof(TapeHeader) + sizeof(PackedDirectory);
+    die_if(dir.block_size == 0 || dir.block_size > PACKED_BLOCK_BARS ||
+           dir.price_decimals > 9 || dir.ts_unit == 0 ||
+           dir.block_count > (size - offsets_at) / sizeof(uint64_t) ||
+           n > static_cast<uint64_t>(dir.block_count) * dir.block_size,
+           "Bad packed directory");
+
+    const double scale = POW10[dir.price_decimals];
+    out.resize(static_cast<size_t>(n));
+
+    uint64_t u[S_COUNT][PACKED_BLOCK_BARS];
+    int64_t close[PACKED_BLOCK_BARS];
+    size_t at = 0;
+    for (uint32_t b = 0; b < dir.block_count; ++b) {
+        uint64_t block_at;
+        std::memcpy(&block_at, file + offsets_at + b * sizeof(uint64_t), sizeof(block_at));
+        die_if(block_at > size || size - block_at < sizeof(PackedBlockHeader), "Bad packed block offset");
+
+        PackedBlockHeader bh;
+        std::memcpy(&bh, file + block_at, sizeof(bh));
+        const size_t c = bh.count;
+        die_if(c == 0 || c > dir.block_size || c > n - at, "Bad packed block count");
+
+        size_t payload = 0;
+        for (int k = 0; k < S_COUNT; ++k) {
+            die_if(bh.bits[k] > MAX_BITS, "Bad packed bit width");
+            payload += stream_bytes(c, bh.bits[k]);
+        }
+        die_if(size - block_at - sizeof(PackedBlockHeader) < payload + BLOCK_PAD, "Packed block exceeds file size");
+
+        const uint8_t* p = file + block_at + sizeof(PackedBlockHeader);
+        for (int k = 0; k < S_COUNT; ++k) {
+            unpack(p, u[k], c, bh.bits[k]);
+            p += stream_bytes(c, bh.bits[k]);
+        }
+
+        // The close chain is the only serial dependency; everything else is
+        // element-wise once it is known.
+        int64_t prev = bh.ref_close;
+        for (size_t i = 0; i < c; ++i) {
+            prev = wrap_add(prev, unzigzag(u[S_CLOSE][i]));
+            close[i] = prev;
+        }
+
+        Bar1m* r = out.data() + at;
+        uint64_t ts = bh.ts0;
+        for (size_t i = 0; i < c; ++i) {
+            if (i > 0)
+                ts += (static_cast<uint64_t>(bh.ts_min) + u[S_TS][i]) * dir.ts_unit;
+            const int64_t base = (i == 0) ? bh.ref_close : close[i - 1];
+            r[i].ts_ns = ts;
+            r[i].open = static_cast<double>(wrap_add(base, unzigzag(u[S_OPEN][i]))) / scale;
+            r[i].high = static_cast<double>(wrap_add(base, unzigzag(u[S_HIGH][i]))) / scale;
+            r[i].low = static_cast<double>(wrap_add(base, unzigzag(u[S_LOW][i]))) / scale;
+            r[i].close = static_cast<double>(close[i]) / scale;
+            r[i].volume = bh.vol_raw ? std::bit_cast<float>(static_cast<uint32_t>(u[S_VOL][i]))
+                                     : static_cast<float>(wrap_add(bh.vol_min, static_cast<int64_t>(u[S_VOL][i])));
+        }
+        at += c;
+    }
+    die_if(at != n, "Packed tape record count mismatch");
+}
+
+bool encode_packed_ticks(const Tick* ticks, size_t n, std::vector<uint8_t>& out) {
+    if (n == 0)
+        return false;
+
+    const int decimals = pick_decimals(ticks, n);
+    if (decimals < 0)
+        return false;
+    const double scale = POW10[decimals];
+
+    uint64_t ts_unit = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (ticks[i].ts_ns < ticks[i - 1].ts_ns)
+            return false;
+        ts_unit = std::gcd(ts_unit, ticks[i].ts_ns - ticks[i - 1].ts_ns);
+    }
+    if (ts_unit == 0)
+        ts_unit = 1;
+
+    const uint32_t block_count = static_cast<uint32_t>((n + PACKED_TICK_BLOCK - 1) / PACKED_TICK_BLOCK);
+    const size_t offsets_at = sizeof(TapeHeader) + sizeof(PackedDirectory);
+    size_t off = offsets_at + block_count * sizeof(uint64_t);
+
+    out.assign(off, 0);
+
+    TapeHeader hdr{};
+    std::memcpy(hdr.magic, "TAPEv001", 8);
+    hdr.version = 5;
+    hdr.record_type = RECORD_TICK_PACKED;
+    hdr.record_size = sizeof(Tick);
+    hdr.start_ts_ns = ticks[0].ts_ns;
+    hdr.end_ts_ns = ticks[n - 1].ts_ns;
+    hdr.record_count = n;
+    std::memcpy(out.data(), &hdr, sizeof(hdr));
+
+    PackedDirectory dir{};
+    dir.block_size = PACKED_TICK_BLOCK;
+    dir.block_count = block_count;
+    dir.price_decimals = static_cast<uint32_t>(decimals);
+    dir.ts_unit = ts_unit;
+    std::memcpy(out.data() + sizeof(TapeHeader), &dir, sizeof(dir));
+
+    auto P = [scale](double x) { return std::llround(x * scale); };
+
+    uint64_t v[T_COUNT][PACKED_TICK_BLOCK];
+
+    for (uint32_t b = 0; b < block_count; ++b) {
+        const size_t s = static_cast<size_t>(b) * PACKED_TICK_BLOCK;
+        const size_t c = std::min<size_t>(PACKED_TICK_BLOCK, n - s);
+        const Tick* t = ticks + s;
+
+        PackedTickBlockHeader bh{};
+        bh.ts0 = t[0].ts_ns;
+        bh.bid0 = P(t[0].bid);
+        bh.count = static_cast<uint32_t>(c);
+
+        int64_t ts_min = 0;
+        for (size_t i = 1; i < c; ++i) {
+            const int64_t d = static_cast<int64_t>((t[i].ts_ns - t[i - 1].ts_ns) / ts_unit);
+            ts_min = (i == 1) ? d : std::min(ts_min, d);
+        }
+        bh.ts_min = ts_min;
+        v[T_TS][0] = 0;
+        for (size_t i = 1; i < c; ++i)
+            v[T_TS][i] = static_cast<uint64_t>((t[i].ts_ns - t[i - 1].ts_ns) / ts_unit) - static_cast<uint64_t>(ts_min);
+
+        int64_t prev = bh.bid0;
+        int64_t spread_min = 0;
+        for (size_t i = 0; i < c; ++i) {
+            const int64_t bid = P(t[i].bid);
+            const int64_t spread = P(t[i].ask) - bid;
+            v[T_BID][i] = zigzag(bid - prev);
+            v[T_SPREAD][i] = static_cast<uint64_t>(spread); // made relative below
+            spread_min = (i == 0) ? spread : std::min(spread_min, spread);
+            prev = bid;
+        }
+        bh.spread_min = spread_min;
+        for (size_t i = 0; i < c; ++i)
+            v[T_SPREAD][i] = static_cast<uint64_t>(static_cast<int64_t>(v[T_SPREAD][i]) - spread_min);
+
+        bool integral = true;
+        int64_t size_min = 0;
+        for (size_t i = 0; i < c && integral; ++i) {
+            integral = integral_size(t[i].size);
+            if (integral)
+                size_min = (i == 0) ? static_cast<int64_t>(t[i].size) : std::min(size_min, static_cast<int64_t>(t[i].size));
+        }
+        bh.size_raw = integral ? 0 : 1;
+        bh.size_min = integral ? size_min : 0;
+        for (size_t i = 0; i < c; ++i)
+            v[T_SIZE][i] = integral ? static_cast<uint64_t>(static_cast<int64_t>(t[i].size) - size_min)
+                                    : std::bit_cast<uint32_t>(t[i].size);
+
+        size_t payload = 0;
+        for (int k = 0; k < T_COUNT; ++k) {
+            uint64_t mx = 0;
+            for (size_t i = 0; i < c; ++i)
+                mx |= v[k][i];
+            const unsigned bits = bit_width(mx);
+            if (bits > MAX_BITS)
+                return false;
+            bh.bits[k] = static_cast<uint8_t>(bits);
+            payload += stream_bytes(c, bits);
+        }
+
+        const uint64_t block_at = off;
+        std::memcpy(out.data() + offsets_at + b * sizeof(uint64_t), &block_at, sizeof(block_at));
+        out.resize(off + sizeof(PackedTickBlockHeader) + payload + BLOCK_PAD, 0);
+        std::memcpy(out.data() + off, &bh, sizeof(bh));
+        off += sizeof(PackedTickBlockHeader);
+        for (int k = 0; k < T_COUNT; ++k) {
+            pack(out.data() + off, v[k], c, bh.bits[k]);
+            off += stream_bytes(c, bh.bits[k]);
+        }
+        off += BLOCK_PAD;
+    }
+    return true;
+}
+
+PackedTickView open_packed_ticks(const uint8_t* file, size_t size) {
+    die_if(size < sizeof(TapeHeader) + sizeof(PackedDirectory), "Packed tick tape too small");
+    TapeHeader hdr{};
+    std::memcpy(&hdr, file, sizeof(hdr));
+    die_if(hdr.record_type != RECORD_TICK_PACKED, "Not a packed tick tape");
+
+    PackedTickView v;
+    v.file = file;
+    v.size = size;
+    v.count = hdr.record_count;
+    std::memcpy(&v.dir, file + sizeof(TapeHeader), sizeof(v.dir));
+
+    const size_t offsets_at = sizeof(TapeHeader) + sizeof(PackedDirectory);
+    die_if(v.dir.block_size == 0 || v.dir.block_size > PACKED_TICK_BLOCK ||
+           v.dir.price_decimals > 9 || v.dir.ts_unit == 0 ||
+           v.dir.block_count > (size - offsets_at) / sizeof(uint64_t) ||
+           v.count > static_cast<uint64_t>(v.dir.block_count) * v.dir.block_size,
+           "Bad packed tick directory");
+    return v;
+}
+
+uint64_t packed_tick_block_offset(const PackedTickView& v, uint32_t b) {
+    uint64_t block_at;
+    std::memcpy(&block_at, v.file + sizeof(TapeHeader) + sizeof(PackedDirectory) + b * sizeof(uint64_t),
+                sizeof(block_at));
+    die_if(block_at > v.size || v.size - block_at < sizeof(PackedTickBlockHeader), "Bad packed tick block offset");
+    return block_at;
+}
+
+uint64_t packed_tick_block_ts(const PackedTickView& v, uint32_t b) {
+    uint64_t ts0;
+    std::memcpy(&ts0, v.file + packed_tick_block_offset(v, b) + offsetof(PackedTickBlockHeader, ts0), sizeof(ts0));
+    return ts0;
+}
+
+size_t decode_tick_block(const PackedTickView& v, uint32_t b, Tick* out) {
+    const uint64_t block_at = packed_tick_block_offset(v, b);
+    PackedTickBlockHeader bh;
+    std::memcpy(&bh, v.file + block_at, sizeof(bh));
+    const size_t c = bh.count;
+    die_if(c == 0 || c > v.dir.block_size, "Bad packed tick block count");
+
+    size_t payload = 0;
+    for (int k = 0; k < T_COUNT; ++k) {
+        die_if(bh.bits[k] > MAX_BITS, "Bad packed bit width");
+        payload += stream_bytes(c, bh.bits[k]);
+    }
+    die_if(v.size - block_at - sizeof(PackedTickBlockHeader) < payload + BLOCK_PAD,
+           "Packed tick block exceeds file size");
+
+    uint64_t u[T_COUNT][PACKED_TICK_BLOCK];
+    const uint8_t* p = v.file + block_at + sizeof(PackedTickBlockHeader);
+    for (int k = 0; k < T_COUNT; ++k) {
+        unpack(p, u[k], c, bh.bits[k]);
+        p += stream_bytes(c, bh.bits[k]);
+    }
+
+    // Turn the serial chains (timestamps, bids) into absolute values in place,
+    // then convert everything in one element-wise pass.
+    const double scale = POW10[v.dir.price_decimals];
+    uint64_t ts = bh.ts0;
+    int64_t bid = bh.bid0;
+    for (size_t i = 0; i < c; ++i) {
+        if (i > 0)
+            ts += (static_cast<uint64_t>(bh.ts_min) + u[T_TS][i]) * v.dir.ts_unit;
+        bid = wrap_add(bid, unzigzag(u[T_BID][i]));
+        u[T_TS][i] = ts;
+        u[T_BID][i] = static_cast<uint64_t>(bid);
+    }
+    for (size_t i = 0; i < c; ++i) {
+        const int64_t b_i = static_cast<int64_t>(u[T_BID][i]);
+        out[i].ts_ns = u[T_TS][i];
+        out[i].bid = static_cast<double>(b_i) / scale;
+        out[i].ask = static_cast<double>(wrap_add(b_i, wrap_add(bh.spread_min, static_cast<int64_t>(u[T_SPREAD][i])))) / scale;
+        out[i].size = bh.size_raw ? std::bit_cast<float>(static_cast<uint32_t>(u[T_SIZE][i]))
+                                  : static_cast<float>(wrap_add(bh.size_min, static_cast<int64_t>(u[T_SIZE][i])));
+    }
+    return c;
+}
+
+}  // namespace datahandler
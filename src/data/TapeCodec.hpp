@@ -0,0 +1,67 @@
+#pragma once
+
+#include "TapeTypes.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace datahandler
+{
+
+    // Bars per packed block. Blocks decode independently into stack buffers.
+    constexpr uint32_t PACKED_BLOCK_BARS = 128;
+
+    // Version 3 (RECORD_BAR_1M_PACKED) tape encoding.
+    //
+    // Prices are stored as integers in units of 10^-price_decimals, where the
+    // encoder picks the smallest decimals (0..9) that reproduces every price of
+    // the day bit-for-bit; for 5-digit FX quotes that is a tenth of a pip.
+    // Within a block, open/high/low/close are zigzag deltas from the previous
+    // bar's close, timestamps are frame-of-reference deltas in ts_unit steps
+    // and integral volumes are offsets from the block minimum. Each stream is
+    // bit-packed at the narrowest width that fits the block.
+    //
+    // Encodes a complete tape file (header, directory, offsets, blocks) into out.
+    // Returns false, leaving out unspecified, when the day can't be represented
+    // exactly (non-decimal prices, decreasing timestamps, over-wide deltas).
+    bool encode_packed_tape(const Bar1m *recs, size_t n, std::vector<uint8_t> &out);
+
+    // Decodes a whole packed tape (file bytes, header included) into out.
+    // Throws std::runtime_error on a malformed file.
+    void decode_packed_tape(const uint8_t *file, size_t size, std::vector<Bar1m> &out);
+
+    // Ticks per packed tick block, the unit a TickReader decodes at a time.
+    constexpr uint32_t PACKED_TICK_BLOCK = 1024;
+
+    // Version 5 (RECORD_TICK_PACKED) tick tape encoding, built like the bar
+    // encoding: prices are integers in units of 10^-price_decimals, bids are
+    // zigzag deltas from the previous tick, asks are stored as the spread over
+    // the bid (frame of reference per block), timestamps as frame-of-reference
+    // deltas in ts_unit steps and sizes like bar volumes. Every block starts
+    // from absolute values, so blocks decode (and seek) independently.
+    //
+    // Encodes a complete tape file into out. Returns false, leaving out
+    // unspecified, when the day can't be represented exactly.
+    bool encode_packed_ticks(const Tick *ticks, size_t n, std::vector<uint8_t> &out);
+
+    // Directory of a packed tick tape, checked by open_packed_ticks().
+    struct PackedTickView
+    {
+        const uint8_t *file = nullptr;
+        size_t size = 0;
+        PackedDirectory dir{};
+        uint64_t count = 0; // ticks in the tape
+    };
+
+    // Throws std::runtime_error on a malformed header or directory.
+    PackedTickView open_packed_ticks(const uint8_t *file, size_t size);
+
+    // File offset of block b's PackedTickBlockHeader, and the ts of its first tick.
+    uint64_t packed_tick_block_offset(const PackedTickView &v, uint32_t b);
+    uint64_t packed_tick_block_ts(const PackedTickView &v, uint32_t b);
+
+    // Decodes block b into out, which has room for v.dir.block_size ticks.
+    // Returns the block's tick count. Throws std::runtime_error on a malformed block.
+    size_t decode_tick_block(const PackedTickView &v, uint32_t b, Tick *out);
+
+} // namespace datahandler
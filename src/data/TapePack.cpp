@@ -0,0 +1,131 @@
+#include "TapePack.hpp"
+#include "TapeTypes.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace datahandler {
+
+namespace {
+    constexpr char PACK_MAGIC[8] = {'T', 'P', 'K', 'v', '0', '0', '1', '\0'};
+
+    void die_if(bool cond, const std::string& msg) {
+        if (cond) throw std::runtime_error(msg);
+    }
+
+    bool valid_header(const PackHeader& hdr) {
+        return std::memcmp(hdr.magic, PACK_MAGIC, 8) == 0 &&
+               hdr.version == 1 &&
+               hdr.entry_size == sizeof(PackDayEntry);
+    }
+}
+
+bool TapePack::read_header(const std::string& path, PackHeader& hdr) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    const bool ok = std::fread(&hdr, sizeof(hdr), 1, f) == 1;
+    std::fclose(f);
+    return ok && valid_header(hdr);
+}
+
+bool TapePack::open(const std::string& path, const MapPolicy& policy) {
+    close();
+    std::FILE* probe = std::fopen(path.c_str(), "rb");
+    if (!probe)
+        return false;
+    std::fclose(probe);
+
+    map_.open_readonly(path, policy);
+    path_ = path;
+
+    const size_t size = map_.size();
+    const auto* base = static_cast<const uint8_t*>(map_.data());
+    die_if(size < sizeof(PackHeader), "Container too small: " + path);
+
+    PackHeader hdr{};
+    std::memcpy(&hdr, base, sizeof(hdr));
+    die_if(!valid_header(hdr), "Bad container header: " + path);
+    die_if(hdr.day_count > (size - sizeof(PackHeader)) / sizeof(PackDayEntry), "Bad container directory: " + path);
+
+    days_.resize(static_cast<size_t>(hdr.day_count));
+    if (!days_.empty())
+        std::memcpy(days_.data(), base + sizeof(PackHeader), days_.size() * sizeof(PackDayEntry));
+
+    for (size_t i = 0; i < days_.size(); ++i) {
+        const PackDayEntry& d = days_[i];
+        die_if(d.offset % PACK_ALIGN != 0 || d.offset > size || d.bytes > size - d.offset ||
+               d.bytes < sizeof(TapeHeader) || (i > 0 && d.ymd <= days_[i - 1].ymd),
+               "Bad container day entry: " + path);
+    }
+    return true;
+}
+
+void TapePack::close() {
+    map_.close();
+    days_.clear();
+    path_.clear();
+}
+
+const PackDayEntry* TapePack::find(int ymd) const {
+    auto it = std::lower_bound(days_.begin(), days_.end(), ymd,
+                               [](const PackDayEntry& d, int y) { return d.ymd < y; });
+    return (it != days_.end() && it->ymd == ymd) ? &*it : nullptr;
+}
+
+void TapePackWriter::add_day(int ymd, const uint8_t* tape, size_t bytes) {
+    for (const auto& d : days_)
+        die_if(d.ymd == ymd, "Duplicate day in container: " + std::to_string(ymd));
+
+    PackDayEntry d{};
+    d.ymd = ymd;
+    d.offset = data_.size();
+    d.bytes = bytes;
+    data_.insert(data_.end(), tape, tape + bytes);
+    days_.push_back(d);
+}
+
+void TapePackWriter::write(const std::string& path) {
+    die_if(days_.empty(), "No days to pack: " + path);
+
+    std::vector<PackDayEntry> dir = days_;
+    std::sort(dir.begin(), dir.end(), [](const PackDayEntry& a, const PackDayEntry& b) { return a.ymd < b.ymd; });
+
+    // Days are laid out in ymd order after the directory.
+    const uint64_t data_at = align_up(sizeof(PackHeader) + dir.size() * sizeof(PackDayEntry), PACK_ALIGN);
+    std::vector<uint8_t> out(static_cast<size_t>(data_at), 0);
+    for (auto& d : dir) {
+        const uint64_t src = d.offset;
+        d.offset = align_up(out.size(), PACK_ALIGN);
+        out.resize(static_cast<size_t>(d.offset), 0);
+        out.insert(out.end(), data_.begin() + static_cast<ptrdiff_t>(src),
+                   data_.begin() + static_cast<ptrdiff_t>(src + d.bytes));
+    }
+
+    PackHeader hdr{};
+    std::memcpy(hdr.magic, PACK_MAGIC, 8);
+    hdr.version = 1;
+    hdr.entry_size = sizeof(PackDayEntry);
+    hdr.day_count = dir.size();
+    std::memcpy(out.data(), &hdr, sizeof(hdr));
+    std::memcpy(out.data() + sizeof(hdr), dir.data(), dir.size() * sizeof(PackDayEntry));
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        die_if(!f, "Cannot write container: " + tmp);
+        f.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+        die_if(!f, "Failed writing container: " + tmp);
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    die_if(static_cast<bool>(ec), "Failed renaming container: " + path + " (" + ec.message() + ")");
+}
+
+}  // namespace datahandler
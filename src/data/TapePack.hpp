@@ -0,0 +1,92 @@
+#pragma once
+
+#include "MMapFile.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace datahandler
+{
+
+#pragma pack(push, 1)
+    struct PackHeader
+    {
+        char magic[8];        // "TPKv001\0"
+        uint32_t version;     // 1
+        uint32_t entry_size;  // sizeof(PackDayEntry)
+        uint64_t day_count;
+        uint8_t reserved[16];
+    };
+
+    // One daily tape inside a container. Sorted by ymd.
+    struct PackDayEntry
+    {
+        int32_t ymd;          // YYYYMMDD
+        uint32_t reserved;
+        uint64_t offset;      // from the start of the container, multiple of PACK_ALIGN
+        uint64_t bytes;       // size of the embedded tape file
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(PackHeader) == 40, "PackHeader must be 40 bytes");
+    static_assert(sizeof(PackDayEntry) == 24, "PackDayEntry must be 24 bytes");
+
+    // Days start on this boundary so columnar tapes keep their column alignment.
+    constexpr uint64_t PACK_ALIGN = 64;
+
+    // Read side of a multi-day container (SYMBOL_YYYY.tapepack, see make_pack_path):
+    // a header, the day directory, then each daily tape file byte-for-byte.
+    // The whole container is mapped once and days are handed out as slices.
+    class TapePack
+    {
+    public:
+        TapePack() = default;
+
+        // Maps the container. Returns false if the file doesn't exist; throws
+        // std::runtime_error if it isn't a valid container.
+        bool open(const std::string &path, const MapPolicy &policy = {});
+        void close();
+
+        bool is_open() const { return map_.is_open(); }
+        const std::string &path() const { return path_; }
+
+        const std::vector<PackDayEntry> &days() const { return days_; }
+
+        // Directory entry for ymd, or nullptr.
+        const PackDayEntry *find(int ymd) const;
+
+        // Start of the embedded tape file (valid while the container is open).
+        const uint8_t *day_data(const PackDayEntry &d) const
+        {
+            return static_cast<const uint8_t *>(map_.data()) + d.offset;
+        }
+
+        // Reads just the header of a container on disk; false if missing or invalid.
+        static bool read_header(const std::string &path, PackHeader &hdr);
+
+    private:
+        MMapFile map_;
+        std::vector<PackDayEntry> days_;
+        std::string path_;
+    };
+
+    // Collects daily tape files and writes them as one container.
+    class TapePackWriter
+    {
+    public:
+        // Appends a copy of one daily tape file. Days may be added in any order;
+        // adding the same ymd twice throws.
+        void add_day(int ymd, const uint8_t *tape, size_t bytes);
+
+        size_t day_count() const { return days_.size(); }
+
+        // Writes via a temp file + rename. Throws on I/O failure or if empty.
+        void write(const std::string &path);
+
+    private:
+        std::vector<PackDayEntry> days_; // offsets relative to data_
+        std::vector<uint8_t> data_;
+    };
+
+} // namespace datahandler
@@ -0,0 +1,130 @@
+#include "TapePrefetcher.hpp"
+#include "TapePack.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+namespace datahandler {
+
+namespace {
+    constexpr size_t PAGE = 4096;
+
+    // Reads one byte per page so the range is resident before the engine gets it.
+    void prefault(const void* data, uint64_t offset, uint64_t bytes) {
+        const auto* p = static_cast<const volatile uint8_t*>(data) + offset;
+        uint8_t sink = 0;
+        for (uint64_t i = 0; i < bytes; i += PAGE)
+            sink ^= p[i];
+        if (bytes > 0)
+            sink ^= p[bytes - 1];
+        (void)sink;
+    }
+}
+
+TapePrefetcher::TapePrefetcher(size_t depth)
+    : depth_(depth == 0 ? 1 : depth)
+{
+}
+
+TapePrefetcher::~TapePrefetcher() {
+    stop();
+}
+
+void TapePrefetcher::start(std::vector<PrefetchJob> jobs, const MapPolicy& policy) {
+    stop();
+    jobs_ = std::move(jobs);
+    policy_ = policy;
+    ready_.clear();
+    handed_out_ = 0;
+    stop_ = false;
+    done_ = false;
+    error_ = nullptr;
+    worker_ = std::thread(&TapePrefetcher::run, this);
+}
+
+void TapePrefetcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable())
+        worker_.join();
+    ready_.clear();
+    jobs_.clear();
+}
+
+bool TapePrefetcher::next(PrefetchResult& out) {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (handed_out_ >= jobs_.size())
+        return false;
+
+    if (ready_.empty() && !error_) {
+        const auto t0 = std::chrono::steady_clock::now();
+        cv_.wait(lock, [this] { return !ready_.empty() || error_ || done_; });
+        stall_ns_ += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+        ++stalls_;
+    }
+    if (ready_.empty()) {
+        if (error_)
+            std::rethrow_exception(error_);
+        return false;
+    }
+
+    out = std::move(ready_.front());
+    ready_.pop_front();
+    ++handed_out_;
+    lock.unlock();
+    cv_.notify_all();
+    return true;
+}
+
+void TapePrefetcher::run() {
+    TapePack pack; // container behind consecutive in_pack jobs
+
+    for (size_t i = 0; i < jobs_.size(); ++i) {
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return stop_ || ready_.size() < depth_; });
+            if (stop_)
+                return;
+        }
+
+        const PrefetchJob& job = jobs_[i];
+        PrefetchResult r;
+        r.day = job.day;
+        try {
+            if (job.in_pack) {
+                if (pack.path() != job.path && !pack.open(job.path, policy_))
+                    throw std::runtime_error("Cannot open tape container: " + job.path);
+                const PackDayEntry* d = pack.find(job.ymd);
+                if (!d)
+                    throw std::runtime_error("Day missing from tape container: " + job.path);
+                prefault(pack.day_data(*d), 0, d->bytes);
+            } else {
+                r.map.open_readonly(job.path, policy_);
+                prefault(r.map.data(), 0, r.map.size());
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mu_);
+            error_ = std::current_exception();
+            done_ = true;
+            cv_.notify_all();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            ready_.push_back(std::move(r));
+        }
+        cv_.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(mu_);
+    done_ = true;
+    cv_.notify_all();
+}
+
+}  // namespace datahandler
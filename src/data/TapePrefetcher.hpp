@@ -0,0 +1,82 @@
+#pragma once
+
+#include "MMapFile.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace datahandler
+{
+
+    // One day to load. Standalone tapes are mapped whole and handed over;
+    // days inside a container only have their bytes faulted into the page
+    // cache (the reader slices its own mapping of the container).
+    struct PrefetchJob
+    {
+        size_t day = 0;        // caller's day index, returned with the result
+        std::string path;      // tape, or container when in_pack
+        bool in_pack = false;
+        int ymd = 0;           // day to look up in the container
+    };
+
+    struct PrefetchResult
+    {
+        size_t day = 0;
+        MMapFile map;          // open for standalone tapes, closed for in_pack jobs
+    };
+
+    // Background loader that keeps up to `depth` upcoming tapes opened, mapped
+    // and pre-faulted while the caller consumes the current one. Time the
+    // caller spends blocked in next() is accumulated as stall time.
+    class TapePrefetcher
+    {
+    public:
+        explicit TapePrefetcher(size_t depth);
+        ~TapePrefetcher();
+
+        TapePrefetcher(const TapePrefetcher &) = delete;
+        TapePrefetcher &operator=(const TapePrefetcher &) = delete;
+
+        // Cancels any previous run and starts loading jobs in order.
+        void start(std::vector<PrefetchJob> jobs, const MapPolicy &policy);
+
+        // Cancels the current run and joins the worker. Ready results are dropped.
+        void stop();
+
+        // Blocks until the next job is loaded. Returns false once every job has
+        // been handed out. Rethrows a load error (e.g. a missing file) here.
+        bool next(PrefetchResult &out);
+
+        size_t depth() const { return depth_; }
+
+        // Totals across runs.
+        double stall_seconds() const { return stall_ns_ * 1e-9; }
+        uint64_t stalls() const { return stalls_; }
+
+    private:
+        void run();
+
+        const size_t depth_;
+        MapPolicy policy_;
+
+        std::thread worker_;
+        std::mutex mu_;
+        std::condition_variable cv_;
+        std::vector<PrefetchJob> jobs_;
+        std::deque<PrefetchResult> ready_;
+        size_t handed_out_ = 0;
+        bool stop_ = false;
+        bool done_ = false;              // worker has queued its last result
+        std::exception_ptr error_;
+
+        uint64_t stall_ns_ = 0;
+        uint64_t stalls_ = 0;
+    };
+
+} // namespace datahandler
@@ -0,0 +1,485 @@
+#include "TapeQuery.hpp"
+#include "DateUtils.hpp"
+#include "TapeReader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+namespace datahandler {
+
+namespace {
+    namespace fs = std::filesystem;
+
+    constexpr char ZONEMAP_MAGIC[8] = {'Z', 'M', 'P', 'v', '0', '0', '1', '\0'};
+    constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+    void die_if(bool cond, const std::string& msg) {
+        if (cond) throw std::runtime_error(msg);
+    }
+
+    inline size_t fi(QueryField f) { return static_cast<size_t>(f); }
+
+    inline void bar_values(const Bar1m& b, double (&v)[QUERY_FIELDS]) {
+        v[fi(QueryField::Open)] = b.open;
+        v[fi(QueryField::High)] = b.high;
+        v[fi(QueryField::Low)] = b.low;
+        v[fi(QueryField::Close)] = b.close;
+        v[fi(QueryField::Volume)] = b.volume;
+        v[fi(QueryField::Range)] = b.high - b.low;
+    }
+
+    // One value against a term, `prev` being the field on the bar before.
+    inline bool test(const QueryTerm& t, double x, double prev) {
+        switch (t.op) {
+        case QueryOp::Gt: return x > t.value;
+        case QueryOp::Ge: return x >= t.value;
+        case QueryOp::Lt: return x < t.value;
+        case QueryOp::Le: return x <= t.value;
+        case QueryOp::CrossAbove: return prev < t.value && x >= t.value;
+        case QueryOp::CrossBelow: return prev > t.value && x <= t.value;
+        }
+        return false;
+    }
+
+    // False when no bar of the block can satisfy the term.
+    bool may_match(const ZoneBlock& z, const QueryTerm& t) {
+        const size_t f = fi(t.field);
+        const double lo = z.min[f], hi = z.max[f], p = z.prev[f];
+        switch (t.op) {
+        case QueryOp::Gt: return hi > t.value;
+        case QueryOp::Ge: return hi >= t.value;
+        case QueryOp::Lt: return lo < t.value;
+        case QueryOp::Le: return lo <= t.value;
+        // A cross needs a value on each side; inside the block the earlier one
+        // is itself a block value, for the first bar it is `prev`.
+        case QueryOp::CrossAbove: return hi >= t.value && (lo < t.value || p < t.value);
+        case QueryOp::CrossBelow: return lo <= t.value && (hi > t.value || p > t.value);
+        }
+        return true;
+    }
+
+    // mask[i] &= (x[i] op v), with prev[i] the value before x[i] for crosses.
+    // Plain loops over contiguous doubles: the compiler vectorizes each one.
+    void apply(const QueryTerm& t, const double* x, const double* prev, size_t n, uint8_t* mask) {
+        const double v = t.value;
+        switch (t.op) {
+        case QueryOp::Gt:
+            for (size_t i = 0; i < n; ++i) mask[i] &= x[i] > v;
+            break;
+        case QueryOp::Ge:
+            for (size_t i = 0; i < n; ++i) mask[i] &= x[i] >= v;
+            break;
+        case QueryOp::Lt:
+            for (size_t i = 0; i < n; ++i) mask[i] &= x[i] < v;
+            break;
+        case QueryOp::Le:
+            for (size_t i = 0; i < n; ++i) mask[i] &= x[i] <= v;
+            break;
+        case QueryOp::CrossAbove:
+            for (size_t i = 0; i < n; ++i) mask[i] &= (prev[i] < v) & (x[i] >= v);
+            break;
+        case QueryOp::CrossBelow:
+            for (size_t i = 0; i < n; ++i) mask[i] &= (prev[i] > v) & (x[i] <= v);
+            break;
+        }
+    }
+
+    bool is_cross(QueryOp op) {
+        return op == QueryOp::CrossAbove || op == QueryOp::CrossBelow;
+    }
+
+    // One day's bars, as mapped columns (version 2 tapes) or rows.
+    struct DayData {
+        BarColumns cols;
+        const Bar1m* rows = nullptr;
+        size_t size = 0;
+
+        uint64_t ts(size_t i) const { return rows ? rows[i].ts_ns : cols.ts[i]; }
+
+        // Field values of bars [first, first + n): a pointer into the mapping
+        // when the column is there as doubles, else copied into buf.
+        const double* values(QueryField f, size_t first, size_t n, double* buf) const {
+            if (!rows) {
+                switch (f) {
+                case QueryField::Open: return cols.open + first;
+                case QueryField::High: return cols.high + first;
+                case QueryField::Low: return cols.low + first;
+                case QueryField::Close: return cols.close + first;
+                case QueryField::Volume:
+                    for (size_t i = 0; i < n; ++i) buf[i] = cols.volume[first + i];
+                    return buf;
+                case QueryField::Range:
+                    for (size_t i = 0; i < n; ++i) buf[i] = cols.high[first + i] - cols.low[first + i];
+                    return buf;
+                }
+            }
+            const Bar1m* r = rows + first;
+            switch (f) {
+            case QueryField::Open: for (size_t i = 0; i < n; ++i) buf[i] = r[i].open; break;
+            case QueryField::High: for (size_t i = 0; i < n; ++i) buf[i] = r[i].high; break;
+            case QueryField::Low: for (size_t i = 0; i < n; ++i) buf[i] = r[i].low; break;
+            case QueryField::Close: for (size_t i = 0; i < n; ++i) buf[i] = r[i].close; break;
+            case QueryField::Volume: for (size_t i = 0; i < n; ++i) buf[i] = r[i].volume; break;
+            case QueryField::Range: for (size_t i = 0; i < n; ++i) buf[i] = r[i].high - r[i].low; break;
+            }
+            return buf;
+        }
+    };
+
+    // A day with at least one block the zone map couldn't rule out.
+    struct DayJob {
+        const ZoneDay* day;
+        std::vector<const ZoneBlock*> blocks;
+        uint16_t record_type;
+        std::vector<QueryMatch> matches;
+    };
+}
+
+void ZoneMap::build(const std::string& base_dir,
+                    const std::string& symbol,
+                    const std::string& timeframe,
+                    std::shared_ptr<const TapeCatalog> catalog) {
+    ZoneMapHeader hdr{};
+    std::memcpy(hdr.magic, ZONEMAP_MAGIC, 8);
+    hdr.version = 1;
+    hdr.block_bars = ZONE_BLOCK_BARS;
+    hdr.catalog_fingerprint = catalog->fingerprint();
+
+    const auto& entries = catalog->entries();
+    std::vector<ZoneDay> days;
+    std::vector<ZoneBlock> blocks;
+    days.reserve(entries.size());
+
+    if (!entries.empty()) {
+        TapeReader reader(base_dir, symbol, timeframe, entries.front().ymd, entries.back().ymd);
+        reader.set_catalog(catalog);
+
+        double prev[QUERY_FIELDS];
+        std::fill(std::begin(prev), std::end(prev), NaN);
+        size_t k = 0;
+        BarBatch batch;
+        while (reader.nextBatch(batch)) {
+            // One batch is the rest of one day, and every day is read whole.
+            die_if(k >= entries.size() || reader.current_day() != entries[k].ymd ||
+                   batch.size != entries[k].record_count,
+                   "Catalog record counts don't match the tapes; rebuild the catalog");
+
+            ZoneDay d{};
+            d.ymd = entries[k].ymd;
+            d.bars = static_cast<uint32_t>(batch.size);
+            d.block_first = blocks.size();
+            for (size_t first = 0; first < batch.size; first += ZONE_BLOCK_BARS) {
+                const size_t n = std::min<size_t>(ZONE_BLOCK_BARS, batch.size - first);
+                ZoneBlock z{};
+                std::copy(std::begin(prev), std::end(prev), z.prev);
+                z.first_ts_ns = batch[first].ts_ns;
+                z.last_ts_ns = batch[first + n - 1].ts_ns;
+                z.first_bar = static_cast<uint32_t>(first);
+                z.bars = static_cast<uint32_t>(n);
+                for (size_t i = 0; i < n; ++i) {
+                    double v[QUERY_FIELDS];
+                    bar_values(batch[first + i], v);
+                    for (size_t f = 0; f < QUERY_FIELDS; ++f) {
+                        z.min[f] = (i == 0) ? v[f] : std::min(z.min[f], v[f]);
+                        z.max[f] = (i == 0) ? v[f] : std::max(z.max[f], v[f]);
+                        z.sum[f] += v[f];
+                        prev[f] = v[f];
+                    }
+                }
+                blocks.push_back(z);
+            }
+            d.block_count = blocks.size() - d.block_first;
+
+            const Bar1m& first = batch[0];
+            const Bar1m& last = batch[batch.size - 1];
+            d.bar[fi(QueryField::Open)] = first.open;
+            d.bar[fi(QueryField::High)] = first.high;
+            d.bar[fi(QueryField::Low)] = first.low;
+            d.bar[fi(QueryField::Close)] = last.close;
+            d.bar[fi(QueryField::Volume)] = 0.0;
+            for (uint64_t b = d.block_first; b < blocks.size(); ++b) {
+                d.bar[fi(QueryField::High)] = std::max(d.bar[fi(QueryField::High)], blocks[b].max[fi(QueryField::High)]);
+                d.bar[fi(QueryField::Low)] = std::min(d.bar[fi(QueryField::Low)], blocks[b].min[fi(QueryField::Low)]);
+                d.bar[fi(QueryField::Volume)] += blocks[b].sum[fi(QueryField::Volume)];
+            }
+            d.bar[fi(QueryField::Range)] = d.bar[fi(QueryField::High)] - d.bar[fi(QueryField::Low)];
+            days.push_back(d);
+            ++k;
+        }
+        die_if(k != entries.size(), "Catalog lists days the tapes don't have; rebuild the catalog");
+    }
+
+    hdr.day_count = days.size();
+    hdr.block_count = blocks.size();
+    hdr_ = hdr;
+    days_ = std::move(days);
+    blocks_ = std::move(blocks);
+}
+
+bool ZoneMap::load(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+
+    ZoneMapHeader hdr{};
+    bool ok = std::fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+              std::memcmp(hdr.magic, ZONEMAP_MAGIC, 8) == 0 &&
+              hdr.version == 1 && hdr.block_bars == ZONE_BLOCK_BARS;
+
+    std::vector<ZoneDay> days;
+    std::vector<ZoneBlock> blocks;
+    if (ok) {
+        days.resize(static_cast<size_t>(hdr.day_count));
+        blocks.resize(static_cast<size_t>(hdr.block_count));
+        ok = (days.empty() || std::fread(days.data(), sizeof(ZoneDay), days.size(), f) == days.size()) &&
+             (blocks.empty() || std::fread(blocks.data(), sizeof(ZoneBlock), blocks.size(), f) == blocks.size());
+    }
+    std::fclose(f);
+
+    for (size_t i = 0; ok && i < days.size(); ++i)
+        ok = days[i].block_first <= blocks.size() && days[i].block_count <= blocks.size() - days[i].block_first;
+    if (!ok)
+        return false;
+
+    hdr_ = hdr;
+    days_ = std::move(days);
+    blocks_ = std::move(blocks);
+    return true;
+}
+
+void ZoneMap::save(const std::string& path) const {
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error("Cannot write zone map: " + tmp);
+        f.write(reinterpret_cast<const char*>(&hdr_), sizeof(hdr_));
+        f.write(reinterpret_cast<const char*>(days_.data()),
+                static_cast<std::streamsize>(days_.size() * sizeof(ZoneDay)));
+        f.write(reinterpret_cast<const char*>(blocks_.data()),
+                static_cast<std::streamsize>(blocks_.size() * sizeof(ZoneBlock)));
+        if (!f)
+            throw std::runtime_error("Failed writing zone map: " + tmp);
+    }
+
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec)
+        throw std::runtime_error("Failed renaming zone map: " + path + " (" + ec.message() + ")");
+}
+
+std::shared_ptr<const ZoneMap> ZoneMap::load_or_build(const std::string& base_dir,
+                                                      const std::string& symbol,
+                                                      const std::string& timeframe,
+                                                      std::shared_ptr<const TapeCatalog> catalog) {
+    if (!catalog)
+        catalog = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
+
+    auto zones = std::make_shared<ZoneMap>();
+    const std::string path = make_zonemap_path(base_dir, symbol, timeframe);
+    if (zones->load(path) && zones->catalog_fingerprint() == catalog->fingerprint())
+        return zones;
+
+    zones->build(base_dir, symbol, timeframe, catalog);
+    if (!zones->days().empty()) {
+        try {
+            zones->save(path);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "Warning: %s\n", e.what());
+        }
+    }
+    return zones;
+}
+
+TapeQuery::TapeQuery(std::string base_dir, std::string symbol, std::string timeframe)
+    : base_dir_(std::move(base_dir))
+    , symbol_(std::move(symbol))
+    , timeframe_(std::move(timeframe))
+{
+}
+
+void TapeQuery::prepare() {
+    if (!catalog_)
+        catalog_ = TapeCatalog::load_or_build(base_dir_, symbol_, timeframe_);
+    if (!zones_)
+        zones_ = ZoneMap::load_or_build(base_dir_, symbol_, timeframe_, catalog_);
+    die_if(zones_->catalog_fingerprint() != catalog_->fingerprint(),
+           "Zone map was built from a different catalog than " + symbol_ + " " + timeframe_);
+}
+
+std::vector<QueryMatch> TapeQuery::run(const TapeQuerySpec& spec, QueryStats* stats) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (const auto& t : spec.terms)
+        die_if(fi(t.field) >= QUERY_FIELDS || static_cast<int>(t.op) > static_cast<int>(QueryOp::CrossBelow),
+               "Bad query term");
+    prepare();
+
+    const auto& days = zones_->days();
+    const auto& blocks = zones_->blocks();
+    auto lo = std::lower_bound(days.begin(), days.end(), spec.start_ymd,
+                               [](const ZoneDay& d, int ymd) { return d.ymd < ymd; });
+    auto hi = std::upper_bound(lo, days.end(), spec.end_ymd,
+                               [](int ymd, const ZoneDay& d) { return ymd < d.ymd; });
+
+    QueryStats st;
+    st.days = static_cast<size_t>(hi - lo);
+    std::vector<QueryMatch> out;
+
+    if (spec.scope == QueryScope::Days) {
+        for (auto it = lo; it != hi; ++it) {
+            st.blocks += it->block_count;
+            bool ok = it->block_count > 0;
+            for (const auto& t : spec.terms) {
+                const double prev = (it == days.begin()) ? NaN : (it - 1)->bar[fi(t.field)];
+                ok = ok && test(t, it->bar[fi(t.field)], prev);
+            }
+            if (!ok)
+                continue;
+            QueryMatch m{};
+            m.ymd = it->ymd;
+            m.first_bar = 0;
+            m.bars = it->bars;
+            m.first_ts_ns = blocks[it->block_first].first_ts_ns;
+            m.last_ts_ns = blocks[it->block_first + it->block_count - 1].last_ts_ns;
+            out.push_back(m);
+        }
+        st.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (stats)
+            *stats = st;
+        return out;
+    }
+
+    // Candidate blocks from the zone map.
+    const auto span = catalog_->range(spec.start_ymd, spec.end_ymd);
+    std::vector<DayJob> jobs;
+    for (auto it = lo; it != hi; ++it) {
+        st.blocks += it->block_count;
+        DayJob job{};
+        job.day = &*it;
+        for (uint64_t b = it->block_first; b < it->block_first + it->block_count; ++b) {
+            bool ok = true;
+            for (const auto& t : spec.terms)
+                ok = ok && may_match(blocks[b], t);
+            if (ok)
+                job.blocks.push_back(&blocks[b]);
+        }
+        if (job.blocks.empty())
+            continue;
+        auto e = std::lower_bound(span.begin(), span.end(), it->ymd,
+                                  [](const CatalogEntry& c, int ymd) { return c.ymd < ymd; });
+        die_if(e == span.end() || e->ymd != it->ymd, "Zone map day missing from catalog");
+        job.record_type = e->record_type;
+        st.blocks_read += job.blocks.size();
+        jobs.push_back(std::move(job));
+    }
+    st.days_read = jobs.size();
+
+    auto scan = [&](DayJob& job) {
+        TapeReader reader(base_dir_, symbol_, timeframe_, job.day->ymd, job.day->ymd);
+        reader.set_catalog(catalog_);
+        reader.set_read_ahead(false);
+
+        DayData data;
+        if (job.record_type == RECORD_BAR_1M_COLUMNAR) {
+            die_if(!reader.nextColumns(data.cols), "Tape missing for " + std::to_string(job.day->ymd));
+            data.size = data.cols.size;
+        } else {
+            BarBatch batch;
+            die_if(!reader.nextBatch(batch), "Tape missing for " + std::to_string(job.day->ymd));
+            data.rows = batch.data;
+            data.size = batch.size;
+        }
+        die_if(data.size != job.day->bars, "Tape doesn't match the zone map: " + std::to_string(job.day->ymd));
+
+        uint8_t mask[ZONE_BLOCK_BARS];
+        double buf[ZONE_BLOCK_BARS];
+        double prev[ZONE_BLOCK_BARS];
+        for (const ZoneBlock* z : job.blocks) {
+            const size_t first = z->first_bar;
+            const size_t n = z->bars;
+            die_if(first + n > data.size, "Tape doesn't match the zone map: " + std::to_string(job.day->ymd));
+
+            std::fill(mask, mask + n, uint8_t{1});
+            for (const auto& t : spec.terms) {
+                const double* x = data.values(t.field, first, n, buf);
+                if (is_cross(t.op)) {
+                    prev[0] = z->prev[fi(t.field)];
+                    std::copy(x, x + n - 1, prev + 1);
+                }
+                apply(t, x, prev, n, mask);
+            }
+
+            for (size_t i = 0; i < n; ++i) {
+                if (!mask[i])
+                    continue;
+                const uint32_t bar = static_cast<uint32_t>(first + i);
+                auto& ms = job.matches;
+                if (!ms.empty() && ms.back().first_bar + ms.back().bars == bar) {
+                    ++ms.back().bars;
+                    ms.back().last_ts_ns = data.ts(bar);
+                } else {
+                    ms.push_back(QueryMatch{job.day->ymd, bar, 1, data.ts(bar), data.ts(bar)});
+                }
+            }
+        }
+    };
+
+    unsigned threads = threads_ ? threads_ : std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+    if (threads > jobs.size())
+        threads = static_cast<unsigned>(jobs.size());
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mu;
+    auto worker = [&]() {
+        for (;;) {
+            const size_t k = next.fetch_add(1);
+            if (k >= jobs.size())
+                return;
+            try {
+                scan(jobs[k]);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mu);
+                if (!error)
+                    error = std::current_exception();
+                next.store(jobs.size());
+            }
+        }
+    };
+    if (threads <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t)
+            pool.emplace_back(worker);
+        for (auto& th : pool)
+            th.join();
+    }
+    if (error)
+        std::rethrow_exception(error);
+
+    for (auto& job : jobs) {
+        for (const auto& b : job.blocks)
+            st.bars_read += b->bars;
+        out.insert(out.end(), job.matches.begin(), job.matches.end());
+    }
+    st.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (stats)
+        *stats = st;
+    return out;
+}
+
+}  // namespace datahandler
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "TapeCatalog.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace datahandler
+{
+
+    // Bars per zone-map block. Blocks never span days; a day's last block may be shorter.
+    constexpr uint32_t ZONE_BLOCK_BARS = 256;
+
+    // Bar values a query can test. Range is high - low.
+    enum class QueryField : uint8_t
+    {
+        Open,
+        High,
+        Low,
+        Close,
+        Volume,
+        Range,
+    };
+    constexpr size_t QUERY_FIELDS = 6;
+
+    enum class QueryOp : uint8_t
+    {
+        Gt,
+        Ge,
+        Lt,
+        Le,
+        CrossAbove, // previous value < x and value >= x
+        CrossBelow, // previous value > x and value <= x
+    };
+
+    struct QueryTerm
+    {
+        QueryField field;
+        QueryOp op;
+        double value;
+    };
+
+    enum class QueryScope : uint8_t
+    {
+        Bars, // terms test each bar
+        Days, // terms test each day as one bar (first open, extremes, last close,
+              // volume sum); answered from the zone map alone
+    };
+
+    // Every term must hold (AND).
+    struct TapeQuerySpec
+    {
+        std::vector<QueryTerm> terms;
+        QueryScope scope = QueryScope::Bars;
+        int start_ymd = 0;
+        int end_ymd = 99991231;
+    };
+
+    // A run of consecutive matching bars of one day (bars [first_bar,
+    // first_bar + bars) of the tape), or one matching day in Days scope.
+    struct QueryMatch
+    {
+        int32_t ymd;
+        uint32_t first_bar;
+        uint32_t bars;
+        uint64_t first_ts_ns;
+        uint64_t last_ts_ns;
+    };
+
+    struct QueryStats
+    {
+        size_t days = 0;           // days in range
+        size_t days_read = 0;      // days whose tape was opened
+        uint64_t blocks = 0;       // zone-map blocks in range
+        uint64_t blocks_read = 0;  // blocks evaluated bar by bar
+        uint64_t bars_read = 0;
+        double seconds = 0.0;
+    };
+
+#pragma pack(push, 1)
+    struct ZoneMapHeader
+    {
+        char magic[8];                // "ZMPv001\0"
+        uint32_t version;             // 1
+        uint32_t block_bars;          // ZONE_BLOCK_BARS
+        uint64_t day_count;
+        uint64_t block_count;
+        uint64_t catalog_fingerprint; // TapeCatalog::fingerprint() the map was built from
+        uint8_t reserved[16];
+    };
+
+    // Summary of up to ZONE_BLOCK_BARS bars, per QueryField.
+    struct ZoneBlock
+    {
+        double min[QUERY_FIELDS];
+        double max[QUERY_FIELDS];
+        double sum[QUERY_FIELDS];
+        double prev[QUERY_FIELDS]; // values of the bar before the block (NaN for the first bar on file)
+        uint64_t first_ts_ns;
+        uint64_t last_ts_ns;
+        uint32_t first_bar;        // within the day
+        uint32_t bars;
+    };
+
+    struct ZoneDay
+    {
+        int32_t ymd;
+        uint32_t bars;
+        uint64_t block_first;      // index into the block table
+        uint64_t block_count;
+        double bar[QUERY_FIELDS];  // the day as one bar
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(ZoneMapHeader) == 56, "ZoneMapHeader must be 56 bytes");
+    static_assert(sizeof(ZoneBlock) == 4 * 8 * QUERY_FIELDS + 24, "ZoneBlock must be packed");
+    static_assert(sizeof(ZoneDay) == 24 + 8 * QUERY_FIELDS, "ZoneDay must be packed");
+
+    // Min/max/sum of every field per block of bars, for every day of a
+    // symbol/timeframe catalog. Lives at BASE_DIR/bars/SYMBOL/TIMEFRAME/
+    // SYMBOL_TIMEFRAME.zonemap (see make_zonemap_path) and records the catalog
+    // fingerprint it was built from, so a stale file is detected and rebuilt.
+    class ZoneMap
+    {
+    public:
+        // Reads every bar of the catalogued days once.
+        void build(const std::string &base_dir,
+                   const std::string &symbol,
+                   const std::string &timeframe,
+                   std::shared_ptr<const TapeCatalog> catalog);
+
+        // Returns false if the file is missing or not a valid zone map.
+        bool load(const std::string &path);
+
+        // Writes via a temp file + rename. Throws on I/O failure.
+        void save(const std::string &path) const;
+
+        // Loads the map, rebuilding it (and trying to save it) when it is
+        // missing or was built from a different catalog.
+        static std::shared_ptr<const ZoneMap> load_or_build(const std::string &base_dir,
+                                                            const std::string &symbol,
+                                                            const std::string &timeframe,
+                                                            std::shared_ptr<const TapeCatalog> catalog);
+
+        uint64_t catalog_fingerprint() const { return hdr_.catalog_fingerprint; }
+        const std::vector<ZoneDay> &days() const { return days_; }
+        const std::vector<ZoneBlock> &blocks() const { return blocks_; }
+
+    private:
+        ZoneMapHeader hdr_{};
+        std::vector<ZoneDay> days_;
+        std::vector<ZoneBlock> blocks_;
+    };
+
+    // Evaluates TapeQuerySpec over a symbol/timeframe. The zone map rules out
+    // blocks (and whole days) that can't hold a match, so tapes are opened only
+    // for days with a candidate block. Candidate days are spread over worker
+    // threads; each candidate block is tested one term at a time with
+    // branch-free loops over contiguous values (mapped columns of version 2
+    // tapes, otherwise a per-block copy) that the compiler vectorizes.
+    class TapeQuery
+    {
+    public:
+        TapeQuery(std::string base_dir, std::string symbol, std::string timeframe);
+
+        // Worker threads for bar scans (0, the default: one per core).
+        void set_threads(unsigned n) { threads_ = n; }
+
+        // Catalog and zone map, loaded (or built) on first run unless supplied.
+        void set_catalog(std::shared_ptr<const TapeCatalog> catalog) { catalog_ = std::move(catalog); }
+        void set_zone_map(std::shared_ptr<const ZoneMap> zones) { zones_ = std::move(zones); }
+
+        // Matches in time order. Throws std::runtime_error on a malformed spec
+        // or when the tapes disagree with the zone map.
+        std::vector<QueryMatch> run(const TapeQuerySpec &spec, QueryStats *stats = nullptr);
+
+    private:
+        void prepare();
+
+        std::string base_dir_;
+        std::string symbol_;
+        std::string timeframe_;
+        unsigned threads_ = 0;
+        std::shared_ptr<const TapeCatalog> catalog_;
+        std::shared_ptr<const ZoneMap> zones_;
+    };
+
+} // namespace datahandler
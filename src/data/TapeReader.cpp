@@ -1,7 +1,13 @@
 #include "TapeReader.hpp"
 #include "DateUtils.hpp"
+#include "TapeCodec.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
 namespace datahandler {
 
@@ -21,7 +27,6 @@ TapeReader::TapeReader(std::string base_dir,
     , timeframe_(std::move(timeframe))
     , start_ymd_(start_ymd)
     , end_ymd_(end_ymd)
-    , current_day_(start_ymd)
     , bar_index_(0)
     , bar_count_(0)
     , recs_(nullptr)
@@ -35,40 +40,510 @@ bool TapeReader::nextBar(Bar1m& out) {
             return false;
     }
 
+    ensure_rows();
+    if (!rows_checked(bar_index_, bar_index_ + 1))
+        check_rows(bar_index_, bar_index_ + 1);
     out = recs_[bar_index_];
     ++bar_index_;
+    ++bars_read_;
     return true;
 }
 
+bool TapeReader::nextBatch(BarBatch& out) {
+    while (bar_index_ >= bar_count_) {
+        if (!open_next_tape())
+            return false;
+    }
+
+    ensure_rows();
+    if (!rows_checked(bar_index_, bar_count_))
+        check_rows(bar_index_, bar_count_);
+    out.data = recs_ + bar_index_;
+    out.size = static_cast<size_t>(bar_count_ - bar_index_);
+    out.first_index = bars_read_;
+
+    bars_read_ += out.size;
+    bar_index_ = bar_count_;
+    return true;
+}
+
+bool TapeReader::nextColumns(BarColumns& out) {
+    while (bar_index_ >= bar_count_) {
+        if (!open_next_tape())
+            return false;
+    }
+
+    ensure_columns();
+    const size_t i = static_cast<size_t>(bar_index_);
+    out.ts = cols_.ts + i;
+    out.open = cols_.open + i;
+    out.high = cols_.high + i;
+    out.low = cols_.low + i;
+    out.close = cols_.close + i;
+    out.volume = cols_.volume + i;
+    out.size = static_cast<size_t>(bar_count_ - bar_index_);
+    out.first_index = bars_read_;
+
+    bars_read_ += out.size;
+    bar_index_ = bar_count_;
+    return true;
+}
+
+void TapeReader::set_prefetch_depth(size_t depth) {
+    prefetch_depth_ = depth;
+    prefetch_.reset();
+    prefetch_running_ = false;
+}
+
 bool TapeReader::open_next_tape() {
-    while (current_day_ <= end_ymd_) {
-        std::string path = make_tape_path(base_dir_, symbol_, timeframe_, current_day_);
-        current_day_ = next_day(current_day_);
+    if (prefetch_depth_ > 0)
+        return open_prefetched();
 
-        if (!file_exists(path))
-            continue;
+    if (next_mmap_.is_open()) {
+        mmap_ = std::move(next_mmap_);
+        cur_day_ = staged_day_;
+        bind_current(static_cast<const uint8_t*>(mmap_.data()), mmap_.size());
+    } else {
+        if (!days_resolved_)
+            resolve_days();
+        if (day_pos_ >= days_.size())
+            return false;
+        cur_day_ = day_pos_++;
+        load_day(cur_day_);
+    }
 
-        mmap_.close();
-        mmap_.open_readonly(path);
+    stage_next();
+    return true;
+}
 
-        die_if(mmap_.size() < sizeof(TapeHeader), "File too small");
-        const auto* hdr = reinterpret_cast<const TapeHeader*>(mmap_.data());
+bool TapeReader::open_prefetched() {
+    if (!days_resolved_)
+        resolve_days();
+    if (day_pos_ >= days_.size())
+        return false;
+    if (!prefetch_running_)
+        start_prefetch();
 
-        die_if(std::memcmp(hdr->magic, "TAPEv001", 8) != 0, "Bad magic");
-        die_if(hdr->version != 1, "Bad version");
-        die_if(hdr->record_type != 2, "Expected BAR_1M");
-        die_if(hdr->record_size != sizeof(Bar1m), "Bad record size");
+    PrefetchResult r;
+    die_if(!prefetch_->next(r) || r.day != day_pos_, "Prefetcher out of sync");
+    cur_day_ = day_pos_++;
+    if (r.map.is_open()) {
+        mmap_ = std::move(r.map);
+        bind_current(static_cast<const uint8_t*>(mmap_.data()), mmap_.size());
+    } else {
+        load_day(cur_day_); // container slice, now resident
+    }
+    return true;
+}
 
-        const size_t max_records = (mmap_.size() - sizeof(TapeHeader)) / sizeof(Bar1m);
-        die_if(hdr->record_count > max_records, "record_count exceeds file size");
+void TapeReader::start_prefetch() {
+    if (!prefetch_)
+        prefetch_ = std::make_unique<TapePrefetcher>(prefetch_depth_);
 
-        const uint8_t* base = static_cast<const uint8_t*>(mmap_.data());
-        recs_ = reinterpret_cast<const Bar1m*>(base + sizeof(TapeHeader));
-        bar_count_ = hdr->record_count;
-        bar_index_ = 0;
+    std::vector<PrefetchJob> jobs;
+    jobs.reserve(days_.size() - day_pos_);
+    for (size_t k = day_pos_; k < days_.size(); ++k) {
+        PrefetchJob job;
+        job.day = k;
+        job.ymd = days_[k].ymd;
+        job.in_pack = days_[k].pack_offset != 0;
+        job.path = job.in_pack ? make_pack_path(base_dir_, symbol_, timeframe_, job.ymd / 10000)
+                               : make_tape_path(base_dir_, symbol_, timeframe_, job.ymd);
+        jobs.push_back(std::move(job));
+    }
+    prefetch_->start(std::move(jobs), policy_);
+    prefetch_running_ = true;
+}
+
+void TapeReader::stage_next() {
+    // Container days are slices of a mapping that is already open.
+    if (!read_ahead_ || prefetch_depth_ > 0 || day_pos_ >= days_.size() || days_[day_pos_].pack_offset != 0)
+        return;
+    MapPolicy ahead = policy_;
+    ahead.will_need = true;
+    next_mmap_.open_readonly(make_tape_path(base_dir_, symbol_, timeframe_, days_[day_pos_].ymd), ahead);
+    staged_day_ = day_pos_++;
+}
+
+void TapeReader::load_day(size_t k) {
+    const CatalogEntry& e = days_[k];
+    if (e.pack_offset == 0) {
+        mmap_.open_readonly(make_tape_path(base_dir_, symbol_, timeframe_, e.ymd), policy_);
+        bind_current(static_cast<const uint8_t*>(mmap_.data()), mmap_.size());
+        return;
+    }
+
+    const PackDayEntry* d = open_pack(e.ymd / 10000) ? pack_.find(e.ymd) : nullptr;
+    die_if(!d, "Day missing from tape container");
+    mmap_.close();
+    bind_current(pack_.day_data(*d), static_cast<size_t>(d->bytes));
+}
+
+bool TapeReader::open_pack(int year) {
+    if (pack_year_ != year) {
+        pack_year_ = year;
+        pack_.open(make_pack_path(base_dir_, symbol_, timeframe_, year), policy_);
+    }
+    return pack_.is_open();
+}
+
+void TapeReader::resolve_days() {
+    days_resolved_ = true;
+    days_.clear();
+    day_pos_ = 0;
+
+    if (use_catalog_) {
+        if (!catalog_)
+            catalog_ = TapeCatalog::load_or_build(base_dir_, symbol_, timeframe_);
+        const auto span = catalog_->range(start_ymd_, end_ymd_);
+        days_.assign(span.begin(), span.end());
+        return;
+    }
+
+    for (int day = start_ymd_; day <= end_ymd_; day = next_day(day)) {
+        CatalogEntry e{};
+        e.ymd = day;
+        if (file_exists(make_tape_path(base_dir_, symbol_, timeframe_, day))) {
+            days_.push_back(e);
+        } else if (open_pack(day / 10000)) {
+            if (const PackDayEntry* d = pack_.find(day)) {
+                e.pack_offset = d->offset;
+                days_.push_back(e);
+            }
+        }
+    }
+}
+
+const CatalogEntry& TapeReader::day_info(size_t k) {
+    CatalogEntry& e = days_[k];
+    if (e.record_count != 0 || e.file_bytes != 0)
+        return e;
+
+    // Probing mode: read the header once. file_bytes marks the entry as resolved.
+    TapeHeader hdr{};
+    if (e.pack_offset != 0) {
+        const PackDayEntry* d = open_pack(e.ymd / 10000) ? pack_.find(e.ymd) : nullptr;
+        die_if(!d, "Day missing from tape container");
+        std::memcpy(&hdr, pack_.day_data(*d), sizeof(hdr));
+    } else {
+        const std::string path = make_tape_path(base_dir_, symbol_, timeframe_, e.ymd);
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        die_if(!f, "Cannot open tape");
+        const bool ok = std::fread(&hdr, sizeof(hdr), 1, f) == 1;
+        std::fclose(f);
+        die_if(!ok, "Bad tape header");
+    }
+    die_if(!is_supported_tape(hdr), "Bad tape header");
+
+    e.version = static_cast<uint16_t>(hdr.version);
+    e.record_type = static_cast<uint16_t>(hdr.record_type);
+    e.record_count = hdr.record_count;
+    e.first_ts_ns = hdr.start_ts_ns;
+    e.last_ts_ns = hdr.end_ts_ns;
+    e.file_bytes = 1;
+    return e;
+}
+
+bool TapeReader::seek(uint64_t ts_ns) {
+    if (!days_resolved_)
+        resolve_days();
+
+    size_t lo = 0;
+    uint64_t index = 0;
+    const bool by_calendar = calendar_seek(ts_ns, lo, index);
+    if (!by_calendar) {
+        // First day whose last bar is at/after ts_ns.
+        size_t hi = days_.size();
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            const CatalogEntry& e = day_info(mid);
+            if (e.record_count == 0 || e.last_ts_ns < ts_ns)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+    }
+
+    bars_read_ = 0;
+    if (lo == days_.size()) {
+        next_mmap_.close();
+        if (prefetch_running_) {
+            prefetch_->stop();
+            prefetch_running_ = false;
+        }
+        day_pos_ = days_.size();
+        bar_index_ = bar_count_ = 0;
+        return false;
+    }
+
+    open_day_at(lo, 0);
+    bar_index_ = by_calendar ? index : find_in_day(days_[lo].ymd, ts_ns);
+    return true;
+}
+
+// Day (entry of days_) and bar within it for seek(ts_ns), from the calendar.
+// k == days_.size() when nothing in range is at or after ts_ns. Returns false
+// when there is no usable calendar.
+bool TapeReader::calendar_seek(uint64_t ts_ns, size_t& k, uint64_t& index) const {
+    if (!calendar_ || !use_catalog_ || !catalog_ || calendar_->catalog_fingerprint() != catalog_->fingerprint())
+        return false;
+
+    index = 0;
+    const uint64_t i = calendar_->lower_bound(ts_ns);
+    if (i >= calendar_->bar_count()) {
+        k = days_.size();
         return true;
     }
-    return false;
+    const CalendarDay& d = calendar_->days()[calendar_->day_of_bar(i)];
+    auto it = std::lower_bound(days_.begin(), days_.end(), d.ymd,
+                               [](const CatalogEntry& e, int ymd) { return e.ymd < ymd; });
+    k = static_cast<size_t>(it - days_.begin());
+    if (it != days_.end() && it->ymd == d.ymd)
+        index = i - d.first_bar;
+    return true;
+}
+
+bool TapeReader::seek_with_warmup(uint64_t ts_ns, uint64_t warmup_bars, uint64_t& warmup_got) {
+    warmup_got = 0;
+    if (!seek(ts_ns))
+        return false;
+
+    size_t k = cur_day_;
+    uint64_t index = bar_index_;
+    uint64_t need = warmup_bars;
+
+    uint64_t take = std::min(index, need);
+    index -= take;
+    need -= take;
+    warmup_got += take;
+
+    while (need > 0 && k > 0) {
+        --k;
+        const uint64_t count = day_info(k).record_count;
+        take = std::min(count, need);
+        index = count - take;
+        need -= take;
+        warmup_got += take;
+    }
+
+    if (need > 0 && catalog_) {
+        // Step before start_ymd using the full catalog, collecting the days
+        // newest first and prepending them to days_ in one insert.
+        const auto& all = catalog_->entries();
+        auto it = std::lower_bound(all.begin(), all.end(), days_.front().ymd,
+                                   [](const CatalogEntry& e, int ymd) { return e.ymd < ymd; });
+        std::vector<CatalogEntry> earlier;
+        while (need > 0 && it != all.begin()) {
+            --it;
+            earlier.push_back(*it);
+            const uint64_t count = it->record_count;
+            take = std::min(count, need);
+            index = count - take;
+            need -= take;
+            warmup_got += take;
+        }
+        days_.insert(days_.begin(), earlier.rbegin(), earlier.rend());
+    }
+
+    open_day_at(k, index);
+    return true;
+}
+
+void TapeReader::open_day_at(size_t k, uint64_t index) {
+    next_mmap_.close();
+    if (prefetch_running_) {
+        prefetch_->stop(); // restarted from the new position by the next open
+        prefetch_running_ = false;
+    }
+    cur_day_ = k;
+    load_day(k);
+    die_if(index > bar_count_, "seek index out of range");
+    bar_index_ = index;
+    day_pos_ = k + 1;
+    stage_next();
+}
+
+uint64_t TapeReader::find_in_day(int ymd, uint64_t ts_ns) {
+    uint64_t lo = 0;
+    uint64_t hi = bar_count_;
+
+    // Narrow to one stride with the sidecar: last entry at/before ts_ns.
+    const std::string idx_path = make_index_path(base_dir_, symbol_, timeframe_, ymd);
+    if (std::FILE* f = std::fopen(idx_path.c_str(), "rb")) {
+        IndexHeader ih{};
+        if (std::fread(&ih, sizeof(ih), 1, f) == 1 &&
+            std::memcmp(ih.magic, "IDXv001\0", 8) == 0 && ih.stride > 0) {
+            IndexEntry e{};
+            uint64_t best = 0;
+            bool found = false;
+            for (uint64_t k = 0; k < ih.entry_count; ++k) {
+                if (std::fread(&e, sizeof(e), 1, f) != 1 || e.ts_ns > ts_ns)
+                    break;
+                best = e.offset;
+                found = true;
+            }
+            if (!found) {
+                hi = 0; // first bar of the day is already past ts_ns
+            } else if (best >= sizeof(TapeHeader)) {
+                lo = std::min<uint64_t>((best - sizeof(TapeHeader)) / sizeof(Bar1m), bar_count_);
+                hi = std::min<uint64_t>(lo + ih.stride, bar_count_);
+            }
+        }
+        std::fclose(f);
+    }
+
+    if (lo < hi && !cols_.ts && !rows_checked(lo, hi))
+        check_rows(lo, hi);
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        const uint64_t t = cols_.ts ? cols_.ts[mid] : recs_[mid].ts_ns;
+        if (t < ts_ns)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+void TapeReader::bind_current(const uint8_t* base, size_t size) {
+    die_if(size < sizeof(TapeHeader), "File too small");
+    const auto* hdr = reinterpret_cast<const TapeHeader*>(base);
+
+    die_if(std::memcmp(hdr->magic, "TAPEv001", 8) != 0, "Bad magic");
+    const bool checksummed = crc_mode_ != ChecksumMode::Off && crc_.bind(base, size);
+    die_if(!is_supported_tape(*hdr), "Unsupported tape version/record type");
+
+    recs_ = nullptr;
+    cols_ = BarColumns{};
+    bar_count_ = hdr->record_count;
+    bar_index_ = 0;
+
+    // Unverified tapes pass every rows_checked() test.
+    crc_first_ = 0;
+    crc_last_ = checksummed ? 0 : UINT64_MAX;
+    if (checksummed) {
+        if (crc_mode_ == ChecksumMode::Eager || hdr->record_type != RECORD_BAR_1M) {
+            const size_t bad = crc_.check_all();
+            if (bad != TapeChecksums::ALL_OK)
+                checksum_failed(bad);
+            crc_last_ = UINT64_MAX;
+        } else {
+            crc_done_.assign(crc_.block_count(), 0);
+        }
+    }
+
+    if (hdr->record_type == RECORD_BAR_1M) {
+        const size_t max_records = (size - sizeof(TapeHeader)) / sizeof(Bar1m);
+        die_if(hdr->record_count > max_records, "record_count exceeds file size");
+        die_if(checksummed && sizeof(TapeHeader) + hdr->record_count * sizeof(Bar1m) > crc_.payload_end(),
+               "record_count exceeds checksummed payload");
+        recs_ = reinterpret_cast<const Bar1m*>(base + sizeof(TapeHeader));
+        return;
+    }
+
+    if (hdr->record_type == RECORD_BAR_1M_PACKED) {
+        decode_packed_tape(base, size, rows_);
+        recs_ = rows_.data();
+        return;
+    }
+
+    // RECORD_BAR_1M_COLUMNAR
+    die_if(size < sizeof(TapeHeader) + sizeof(ColumnDirectory), "File too small");
+    ColumnDirectory dir{};
+    std::memcpy(&dir, base + sizeof(TapeHeader), sizeof(dir));
+
+    const uint64_t n = hdr->record_count;
+    auto column_ok = [&](uint64_t off, size_t elem) {
+        return off % COLUMN_ALIGN == 0 && off <= size && n <= (size - off) / elem;
+    };
+    die_if(!column_ok(dir.ts, sizeof(uint64_t)) || !column_ok(dir.open, sizeof(double)) ||
+           !column_ok(dir.high, sizeof(double)) || !column_ok(dir.low, sizeof(double)) ||
+           !column_ok(dir.close, sizeof(double)) || !column_ok(dir.volume, sizeof(float)),
+           "Bad column directory");
+
+    cols_.ts = reinterpret_cast<const uint64_t*>(base + dir.ts);
+    cols_.open = reinterpret_cast<const double*>(base + dir.open);
+    cols_.high = reinterpret_cast<const double*>(base + dir.high);
+    cols_.low = reinterpret_cast<const double*>(base + dir.low);
+    cols_.close = reinterpret_cast<const double*>(base + dir.close);
+    cols_.volume = reinterpret_cast<const float*>(base + dir.volume);
+    cols_.size = static_cast<size_t>(n);
+}
+
+// Verifies the blocks under row-tape bars [first, last) that haven't been yet,
+// then widens the known-good window to every bar inside those blocks.
+void TapeReader::check_rows(uint64_t first, uint64_t last) {
+    const size_t b0 = crc_.block_of(sizeof(TapeHeader) + first * sizeof(Bar1m));
+    const size_t b1 = crc_.block_of(sizeof(TapeHeader) + last * sizeof(Bar1m) - 1);
+    for (size_t b = b0; b <= b1; ++b) {
+        if (crc_done_[b])
+            continue;
+        if (!crc_.check_block(b))
+            checksum_failed(b);
+        crc_done_[b] = 1;
+    }
+
+    const uint64_t bs = crc_.block_size();
+    crc_first_ = (b0 * bs + sizeof(Bar1m) - 1) / sizeof(Bar1m);
+    crc_last_ = std::min<uint64_t>(bar_count_, (b1 + 1) * bs / sizeof(Bar1m));
+}
+
+void TapeReader::checksum_failed(size_t block) const {
+    std::string what = "Checksum mismatch in " + symbol_ + " " + timeframe_ + " " +
+                       std::to_string(cur_day_ < days_.size() ? days_[cur_day_].ymd : 0);
+    if (block < crc_.block_count())
+        what += " (block " + std::to_string(block) + " of " + std::to_string(crc_.block_count()) + ")";
+    else
+        what += " (file checksum)";
+    throw std::runtime_error(what);
+}
+
+void TapeReader::ensure_rows() {
+    if (recs_)
+        return;
+    const size_t n = static_cast<size_t>(bar_count_);
+    rows_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        Bar1m& r = rows_[i];
+        r.ts_ns = cols_.ts[i];
+        r.open = cols_.open[i];
+        r.high = cols_.high[i];
+        r.low = cols_.low[i];
+        r.close = cols_.close[i];
+        r.volume = cols_.volume[i];
+    }
+    recs_ = rows_.data();
+}
+
+void TapeReader::ensure_columns() {
+    if (cols_.ts)
+        return;
+    if (bar_count_ > 0 && !rows_checked(0, bar_count_))
+        check_rows(0, bar_count_);
+    const size_t n = static_cast<size_t>(bar_count_);
+    col_ts_.resize(n);
+    col_px_.resize(4 * n);
+    col_vol_.resize(n);
+    double* o = col_px_.data();
+    double* h = o + n;
+    double* l = h + n;
+    double* c = l + n;
+    for (size_t i = 0; i < n; ++i) {
+        const Bar1m& r = recs_[i];
+        col_ts_[i] = r.ts_ns;
+        o[i] = r.open;
+        h[i] = r.high;
+        l[i] = r.low;
+        c[i] = r.close;
+        col_vol_[i] = r.volume;
+    }
+    cols_.ts = col_ts_.data();
+    cols_.open = o;
+    cols_.high = h;
+    cols_.low = l;
+    cols_.close = c;
+    cols_.volume = col_vol_.data();
+    cols_.size = n;
 }
 
 }  // namespace datahandler
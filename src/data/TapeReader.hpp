@@ -2,7 +2,14 @@
 
 #include "TapeTypes.hpp"
 #include "MMapFile.hpp"
+#include "CalendarIndex.hpp"
+#include "TapeCatalog.hpp"
+#include "TapePack.hpp"
+#include "TapeChecksum.hpp"
+#include "TapePrefetcher.hpp"
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace datahandler
 {
@@ -14,8 +21,48 @@ namespace datahandler
         float open, high, low, close, volume;
     };
 
+    // Read-only view over consecutive records of one mapped tape.
+    // Valid until the next nextBar()/nextBatch() call on the reader.
+    struct BarBatch
+    {
+        const Bar1m *data = nullptr;
+        size_t size = 0;
+        uint64_t first_index = 0; // run-wide index of data[0]
+
+        const Bar1m *begin() const { return data; }
+        const Bar1m *end() const { return data + size; }
+        const Bar1m &operator[](size_t i) const { return data[i]; }
+    };
+
+    // Read-only column (struct-of-arrays) view over consecutive bars of one tape.
+    // Zero-copy on version 2 (columnar) tapes, where every column is 64-byte
+    // aligned; transposed into reader-owned buffers for row tapes.
+    // Valid until the next read call on the reader.
+    struct BarColumns
+    {
+        const uint64_t *ts = nullptr;
+        const double *open = nullptr;
+        const double *high = nullptr;
+        const double *low = nullptr;
+        const double *close = nullptr;
+        const float *volume = nullptr;
+        size_t size = 0;
+        uint64_t first_index = 0; // run-wide index of element 0
+    };
+
+    // How a reader verifies tapes that carry CRC32C checksums (see TapeChecksum.hpp).
+    enum class ChecksumMode
+    {
+        Off,   // trust the data
+        Lazy,  // row tapes: each block the first time a bar in it is read;
+               // columnar/packed tapes: the whole day when it is opened
+        Eager, // the whole day, file CRC included, when it is opened
+    };
+
     // Streams 1m bars from tape files across a date range.
     // Use nextBar() in a loop from your backtest engine.
+    // Days stored in a year container (SYMBOL_YYYY.tapepack) are read from a
+    // single mapping of the container instead of one mapping per day.
     class TapeReader
     {
     public:
@@ -28,6 +75,71 @@ namespace datahandler
         // Returns true if a bar was filled, false when no more bars.
         bool nextBar(Bar1m &out);
 
+        // Hands out the rest of the current day's records in one view. Zero-copy
+        // on row tapes; columnar tapes are transposed and packed tapes decoded
+        // once per day into a reused buffer.
+        // Returns false when no more bars. Can be mixed with nextBar().
+        bool nextBatch(BarBatch &out);
+
+        // Column view over the rest of the current day. Returns false when no more bars.
+        bool nextColumns(BarColumns &out);
+
+        // Number of bars handed out so far (run-wide index of the next bar).
+        uint64_t bars_read() const { return bars_read_; }
+
+        // YYYYMMDD of the tape the last bar/batch came from (0 before the first read).
+        int current_day() const { return bar_count_ > 0 && cur_day_ < days_.size() ? days_[cur_day_].ymd : 0; }
+
+        // Positions the reader on the first bar with ts_ns >= ts_ns. With a
+        // calendar (set_calendar) the day and bar come from two lookups;
+        // otherwise the day is found from the catalog (or tape headers), then
+        // the .idx sidecar narrows the search to one stride, and without a
+        // sidecar the mapped records are binary-searched. Resets bars_read() to
+        // 0. Returns false if no bar in range is at or after ts_ns.
+        bool seek(uint64_t ts_ns);
+
+        // seek(ts_ns), then backs up by up to warmup_bars bars so features are warm
+        // at the first requested bar. Warmup may cross into earlier days, including
+        // days before start_ymd when the catalog lists them. warmup_got receives
+        // the number of bars that precede the first bar at/after ts_ns.
+        bool seek_with_warmup(uint64_t ts_ns, uint64_t warmup_bars, uint64_t &warmup_got);
+
+        // Mapping hints used for every tape opened from now on.
+        void set_map_policy(const MapPolicy &policy) { policy_ = policy; }
+        const MapPolicy &map_policy() const { return policy_; }
+
+        // When enabled, the next day's tape is mapped with a will-need hint
+        // as soon as the current one is opened, so its pages are read in the
+        // background while the current day is consumed.
+        void set_read_ahead(bool on) { read_ahead_ = on; }
+        bool read_ahead() const { return read_ahead_; }
+
+        // With depth > 0 a background thread keeps up to `depth` upcoming days
+        // mapped and pre-faulted (this replaces read-ahead). 0 turns it off.
+        // Time the reader spends waiting on it is reported as stall time.
+        void set_prefetch_depth(size_t depth);
+        size_t prefetch_depth() const { return prefetch_depth_; }
+        double prefetch_stall_seconds() const { return prefetch_ ? prefetch_->stall_seconds() : 0.0; }
+        uint64_t prefetch_stalls() const { return prefetch_ ? prefetch_->stalls() : 0; }
+
+        // Checksum verification for tapes opened from now on (default Lazy).
+        // A mismatch throws std::runtime_error naming the day and block.
+        // Tapes written without checksums are read unverified in every mode.
+        void set_checksum_mode(ChecksumMode mode) { crc_mode_ = mode; }
+        ChecksumMode checksum_mode() const { return crc_mode_; }
+
+        // Days to read come from the symbol/timeframe catalog, loaded (or built)
+        // on first read unless one is supplied here. With the catalog disabled the
+        // reader falls back to probing every calendar date in the range.
+        void set_catalog(std::shared_ptr<const TapeCatalog> catalog) { catalog_ = std::move(catalog); }
+        void set_use_catalog(bool on) { use_catalog_ = on; }
+        const std::shared_ptr<const TapeCatalog> &catalog() const { return catalog_; }
+
+        // Calendar index of this symbol/timeframe, used by seek(). Ignored when
+        // it was built from a different catalog than the one the reader uses.
+        void set_calendar(std::shared_ptr<const CalendarIndex> calendar) { calendar_ = std::move(calendar); }
+        const std::shared_ptr<const CalendarIndex> &calendar() const { return calendar_; }
+
         // Accessors for metadata.
         const std::string &symbol() const { return symbol_; }
         const std::string &timeframe() const { return timeframe_; }
@@ -36,6 +148,25 @@ namespace datahandler
 
     private:
         bool open_next_tape();
+        bool open_prefetched();
+        void start_prefetch();
+        void stage_next();
+        void load_day(size_t k);
+        bool open_pack(int year);
+        void resolve_days();
+        const CatalogEntry &day_info(size_t k);
+        void open_day_at(size_t k, uint64_t index);
+        uint64_t find_in_day(int ymd, uint64_t ts_ns);
+        bool calendar_seek(uint64_t ts_ns, size_t &k, uint64_t &index) const;
+        void bind_current(const uint8_t *base, size_t size);
+        void check_rows(uint64_t first, uint64_t last);
+        [[noreturn]] void checksum_failed(size_t block) const;
+
+        // Bars [first, last) of the current row tape are checksum-verified (or need no check).
+        bool rows_checked(uint64_t first, uint64_t last) const { return first >= crc_first_ && last <= crc_last_; }
+
+        void ensure_rows();
+        void ensure_columns();
 
         std::string base_dir_;
         std::string symbol_;
@@ -43,11 +174,42 @@ namespace datahandler
         int start_ymd_;
         int end_ymd_;
 
-        int current_day_;
+        std::shared_ptr<const TapeCatalog> catalog_;
+        std::shared_ptr<const CalendarIndex> calendar_;
+        bool use_catalog_ = true;
+        bool days_resolved_ = false;
+        std::vector<CatalogEntry> days_; // every tape in range; probing fills only ymd until day_info()
+        size_t day_pos_ = 0;             // next entry of days_ to map
+        size_t cur_day_ = 0;             // entry of days_ behind mmap_
+        size_t staged_day_ = 0;          // entry of days_ behind next_mmap_
+
         uint64_t bar_index_;
         uint64_t bar_count_;
-        const Bar1m *recs_;
+        uint64_t bars_read_ = 0;
+        const Bar1m *recs_;  // current day as rows (mapped, or rows_ for columnar/packed tapes)
+        BarColumns cols_;    // current day as columns from index 0 (mapped, or col_* buffers)
         MMapFile mmap_;
+
+        std::vector<Bar1m> rows_;
+        std::vector<uint64_t> col_ts_;
+        std::vector<double> col_px_; // open|high|low|close, bar_count_ each
+        std::vector<float> col_vol_;
+
+        MapPolicy policy_;
+        bool read_ahead_ = true;
+        MMapFile next_mmap_; // staged by read-ahead, swapped in by open_next_tape()
+        TapePack pack_;      // year container behind the current day, when it is packed
+        int pack_year_ = 0;
+
+        ChecksumMode crc_mode_ = ChecksumMode::Lazy;
+        TapeChecksums crc_;             // current day's checksums, when it has them
+        std::vector<uint8_t> crc_done_; // per block: verified
+        uint64_t crc_first_ = 0;        // bars [crc_first_, crc_last_) lie in verified blocks
+        uint64_t crc_last_ = 0;
+
+        size_t prefetch_depth_ = 0;
+        bool prefetch_running_ = false; // prefetch_ is loading days_ from day_pos_ on
+        std::unique_ptr<TapePrefetcher> prefetch_;
     };
 
 } // namespace datahandler
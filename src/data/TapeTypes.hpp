@@ -1,20 +1,37 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 
 namespace datahandler {
 
+// TapeHeader::record_type values.
+enum RecordType : uint32_t {
+    RECORD_BAR_1M = 2,          // version 1: packed Bar1m rows
+    RECORD_BAR_1M_COLUMNAR = 3, // version 2: ColumnDirectory + one 64-byte aligned array per field
+    RECORD_BAR_1M_PACKED = 4,   // version 3: PackedDirectory + bit-packed blocks (see TapeCodec.hpp)
+    RECORD_TICK = 5,            // version 4: packed Tick rows
+    RECORD_TICK_PACKED = 6,     // version 5: PackedDirectory + bit-packed tick blocks (see TapeCodec.hpp)
+};
+
+constexpr uint32_t COLUMN_ALIGN = 64;
+
 #pragma pack(push, 1)
 struct TapeHeader {
     char magic[8];       // "TAPEv001"
     uint32_t version;
-    uint32_t record_type;   // 2 = BAR_1M
-    uint32_t record_size;  // sizeof(Bar1m)
+    uint32_t record_type;   // RecordType
+    uint32_t record_size;  // sizeof(Bar1m) (bytes per bar across all columns for v2)
     uint32_t reserved0;
     uint64_t start_ts_ns;
     uint64_t end_ts_ns;
     uint64_t record_count;
-    uint8_t reserved[24];
+    // Checksums (see TapeChecksum.hpp); all zero in tapes written without them.
+    uint32_t crc_block_size;   // payload bytes per block CRC, 0 = no checksums
+    uint32_t crc_block_count;
+    uint64_t crc_table_offset; // uint32_t[crc_block_count] block CRCs, after the payload
+    uint32_t header_crc;       // CRC32C of the header bytes before this field
+    uint32_t file_crc;         // CRC32C of the payload [sizeof(TapeHeader), crc_table_offset)
 };
 
 struct Bar1m {
@@ -25,9 +42,110 @@ struct Bar1m {
     double close;
     float volume;
 };
+
+// One quote. Tick tapes live under the "tick" timeframe directory.
+struct Tick {
+    uint64_t ts_ns;
+    double bid;
+    double ask;
+    float size;          // traded/quoted size when the feed has one, else 0
+};
+
+// Version 2 tapes: directly after the header. Byte offsets from the start of the
+// file; each column starts on a COLUMN_ALIGN boundary and holds record_count values.
+struct ColumnDirectory {
+    uint64_t ts;      // uint64_t[]
+    uint64_t open;    // double[]
+    uint64_t high;    // double[]
+    uint64_t low;     // double[]
+    uint64_t close;   // double[]
+    uint64_t volume;  // float[]
+};
+
+// Version 3 and 5 tapes: directly after the header, followed by block_count
+// uint64_t block offsets (from the start of the file).
+struct PackedDirectory {
+    uint32_t block_size;      // bars per block (last block may be shorter)
+    uint32_t block_count;
+    uint32_t price_decimals;  // price = int / 10^price_decimals
+    uint32_t reserved0;
+    uint64_t ts_unit;         // every ts delta in the day is a multiple of this (ns)
+};
+
+// Starts every packed block. The bit-packed streams follow in order
+// ts, open, high, low, close, volume; each starts on a byte boundary.
+struct PackedBlockHeader {
+    uint64_t ts0;             // ts of the block's first bar
+    int64_t ref_close;        // scaled close before the first bar (first open for block 0)
+    int64_t ts_min;           // frame of reference for (delta / ts_unit), bars 1..count-1
+    int64_t vol_min;          // frame of reference for integral volumes
+    uint32_t count;
+    uint8_t bits[6];          // width of each stream
+    uint8_t vol_raw;          // 1 = volume stored as raw float bits
+    uint8_t reserved;
+};
+
+// Starts every packed tick block. Streams follow in order ts, bid, spread,
+// size; each starts on a byte boundary. Blocks decode independently.
+struct PackedTickBlockHeader {
+    uint64_t ts0;             // ts of the block's first tick
+    int64_t bid0;             // scaled bid of the first tick; later bids are zigzag deltas
+    int64_t ts_min;           // frame of reference for (delta / ts_unit), ticks 1..count-1
+    int64_t spread_min;       // frame of reference for scaled ask - bid
+    int64_t size_min;         // frame of reference for integral sizes
+    uint32_t count;
+    uint8_t bits[4];          // width of each stream
+    uint8_t size_raw;         // 1 = size stored as raw float bits
+    uint8_t reserved[3];
+};
+
+// Sidecar SYMBOL_YYYYMMDD.idx: one entry every `stride` records.
+struct IndexHeader {
+    char magic[8];       // "IDXv001\0"
+    uint32_t version;
+    uint32_t stride;     // records between entries
+    uint64_t entry_count;
+    uint64_t reserved;
+};
+
+struct IndexEntry {
+    uint64_t ts_ns;
+    uint64_t offset;     // byte offset of the record in the v1 row layout:
+                         // sizeof(TapeHeader) + i * sizeof(Bar1m), also used for v2 tapes
+};
 #pragma pack(pop)
 
 static_assert(sizeof(TapeHeader) == 72, "TapeHeader must be 72 bytes");
 static_assert(sizeof(Bar1m) == 44, "Bar1m must be 44 bytes");
+static_assert(sizeof(IndexHeader) == 32, "IndexHeader must be 32 bytes");
+static_assert(sizeof(IndexEntry) == 16, "IndexEntry must be 16 bytes");
+static_assert(sizeof(ColumnDirectory) == 48, "ColumnDirectory must be 48 bytes");
+static_assert(sizeof(PackedDirectory) == 24, "PackedDirectory must be 24 bytes");
+static_assert(sizeof(PackedBlockHeader) == 44, "PackedBlockHeader must be 44 bytes");
+static_assert(sizeof(Tick) == 28, "Tick must be 28 bytes");
+static_assert(sizeof(PackedTickBlockHeader) == 52, "PackedTickBlockHeader must be 52 bytes");
+
+inline constexpr uint64_t align_up(uint64_t x, uint64_t a) { return (x + a - 1) / a * a; }
+
+// True for every bar tape layout this build can read.
+inline bool is_supported_tape(const TapeHeader& h) {
+    if (std::memcmp(h.magic, "TAPEv001", 8) != 0)
+        return false;
+    if (h.version == 1)
+        return h.record_type == RECORD_BAR_1M && h.record_size == sizeof(Bar1m);
+    if (h.version == 2)
+        return h.record_type == RECORD_BAR_1M_COLUMNAR && h.record_size == sizeof(Bar1m);
+    if (h.version == 3)
+        return h.record_type == RECORD_BAR_1M_PACKED && h.record_size == sizeof(Bar1m);
+    return false;
+}
+
+// True for every tick tape layout this build can read (see TickReader).
+inline bool is_tick_tape(const TapeHeader& h) {
+    if (std::memcmp(h.magic, "TAPEv001", 8) != 0 || h.record_size != sizeof(Tick))
+        return false;
+    return (h.version == 4 && h.record_type == RECORD_TICK) ||
+           (h.version == 5 && h.record_type == RECORD_TICK_PACKED);
+}
 
 }  // namespace datahandler
@@ -0,0 +1,221 @@
+#include "TapeWriter.hpp"
+#include "TapeCodec.hpp"
+#include "TapeChecksum.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+namespace datahandler {
+
+namespace {
+    TapeHeader make_header(const Bar1m* recs, size_t n, uint32_t version, uint32_t record_type) {
+        TapeHeader hdr{};
+        std::memcpy(hdr.magic, "TAPEv001", 8);
+        hdr.version = version;
+        hdr.record_type = record_type;
+        hdr.record_size = sizeof(Bar1m);
+        hdr.start_ts_ns = recs[0].ts_ns;
+        hdr.end_ts_ns = recs[n - 1].ts_ns;
+        hdr.record_count = n;
+        return hdr;
+    }
+
+    // Copies one field of every record into a contiguous column.
+    template <typename T>
+    void scatter(uint8_t* dst, const Bar1m* recs, size_t n, size_t field_offset) {
+        const auto* src = reinterpret_cast<const uint8_t*>(recs) + field_offset;
+        for (size_t i = 0; i < n; ++i)
+            std::memcpy(dst + i * sizeof(T), src + i * sizeof(Bar1m), sizeof(T));
+    }
+}
+
+void TapeWriter::write_day(const std::string& tape_path, const Bar1m* recs, size_t n) {
+    if (n == 0)
+        throw std::runtime_error("write_day: no records for " + tape_path);
+
+    size_t bytes = 0;
+    switch (layout_) {
+    case TapeLayout::Columns: bytes = encode_columns(recs, n); break;
+    case TapeLayout::Packed:  bytes = encode_packed(recs, n); break;
+    case TapeLayout::Rows:    break;
+    }
+    if (bytes == 0)
+        bytes = encode_rows(recs, n);
+    write_tape(tape_path, bytes);
+
+    if (stride_ > 0)
+        write_index(tape_path, reinterpret_cast<const uint8_t*>(&recs[0].ts_ns), sizeof(Bar1m), n);
+}
+
+void TapeWriter::copy_day(const std::string& tape_path, const uint8_t* tape, size_t bytes) {
+    TapeHeader hdr{};
+    if (bytes < sizeof(hdr) || std::memcmp(tape, "TAPEv001", 8) != 0)
+        throw std::runtime_error("copy_day: not a tape: " + tape_path);
+    std::memcpy(&hdr, tape, sizeof(hdr));
+    write_file(tape_path, tape, bytes);
+    if (stride_ == 0 || hdr.record_count == 0)
+        return;
+
+    const size_t n = static_cast<size_t>(hdr.record_count);
+    switch (hdr.record_type) {
+    case RECORD_BAR_1M:
+        if (sizeof(TapeHeader) + n * sizeof(Bar1m) > bytes)
+            throw std::runtime_error("copy_day: truncated tape: " + tape_path);
+        write_index(tape_path, tape + sizeof(TapeHeader) + offsetof(Bar1m, ts_ns), sizeof(Bar1m), n);
+        break;
+    case RECORD_BAR_1M_COLUMNAR: {
+        ColumnDirectory dir{};
+        if (bytes < sizeof(TapeHeader) + sizeof(dir))
+            throw std::runtime_error("copy_day: truncated tape: " + tape_path);
+        std::memcpy(&dir, tape + sizeof(TapeHeader), sizeof(dir));
+        if (dir.ts > bytes || n > (bytes - dir.ts) / sizeof(uint64_t))
+            throw std::runtime_error("copy_day: truncated tape: " + tape_path);
+        write_index(tape_path, tape + dir.ts, sizeof(uint64_t), n);
+        break;
+    }
+    case RECORD_BAR_1M_PACKED:
+        decode_packed_tape(tape, bytes, rows_);
+        if (!rows_.empty())
+            write_index(tape_path, reinterpret_cast<const uint8_t*>(&rows_[0].ts_ns), sizeof(Bar1m), rows_.size());
+        break;
+    default:
+        break; // tick tapes have no sidecar
+    }
+}
+
+void TapeWriter::write_tick_day(const std::string& tape_path, const Tick* ticks, size_t n) {
+    if (n == 0)
+        throw std::runtime_error("write_tick_day: no ticks for " + tape_path);
+
+    size_t bytes = 0;
+    if (layout_ == TapeLayout::Packed && encode_packed_ticks(ticks, n, buf_))
+        bytes = buf_.size();
+    if (bytes == 0)
+        bytes = encode_tick_rows(ticks, n);
+    write_tape(tape_path, bytes);
+}
+
+// Writes the first `bytes` of buf_, adding checksums when enabled.
+void TapeWriter::write_tape(const std::string& tape_path, size_t bytes) {
+    if (crc_block_ > 0) {
+        buf_.resize(bytes);
+        add_tape_checksums(buf_, crc_block_);
+        bytes = buf_.size();
+    }
+    write_file(tape_path, buf_.data(), bytes);
+}
+
+size_t TapeWriter::encode_rows(const Bar1m* recs, size_t n) {
+    const TapeHeader hdr = make_header(recs, n, 1, RECORD_BAR_1M);
+    const size_t bytes = sizeof(TapeHeader) + n * sizeof(Bar1m);
+    buf_.resize(bytes);
+    std::memcpy(buf_.data(), &hdr, sizeof(hdr));
+    std::memcpy(buf_.data() + sizeof(hdr), recs, n * sizeof(Bar1m));
+    return bytes;
+}
+
+size_t TapeWriter::encode_tick_rows(const Tick* ticks, size_t n) {
+    TapeHeader hdr{};
+    std::memcpy(hdr.magic, "TAPEv001", 8);
+    hdr.version = 4;
+    hdr.record_type = RECORD_TICK;
+    hdr.record_size = sizeof(Tick);
+    hdr.start_ts_ns = ticks[0].ts_ns;
+    hdr.end_ts_ns = ticks[n - 1].ts_ns;
+    hdr.record_count = n;
+
+    const size_t bytes = sizeof(TapeHeader) + n * sizeof(Tick);
+    buf_.resize(bytes);
+    std::memcpy(buf_.data(), &hdr, sizeof(hdr));
+    std::memcpy(buf_.data() + sizeof(hdr), ticks, n * sizeof(Tick));
+    return bytes;
+}
+
+size_t TapeWriter::encode_columns(const Bar1m* recs, size_t n) {
+    const TapeHeader hdr = make_header(recs, n, 2, RECORD_BAR_1M_COLUMNAR);
+
+    ColumnDirectory dir{};
+    uint64_t off = align_up(sizeof(TapeHeader) + sizeof(ColumnDirectory), COLUMN_ALIGN);
+    dir.ts = off;     off = align_up(off + n * sizeof(uint64_t), COLUMN_ALIGN);
+    dir.open = off;   off = align_up(off + n * sizeof(double), COLUMN_ALIGN);
+    dir.high = off;   off = align_up(off + n * sizeof(double), COLUMN_ALIGN);
+    dir.low = off;    off = align_up(off + n * sizeof(double), COLUMN_ALIGN);
+    dir.close = off;  off = align_up(off + n * sizeof(double), COLUMN_ALIGN);
+    dir.volume = off; off = off + n * sizeof(float);
+
+    const size_t bytes = static_cast<size_t>(off);
+    buf_.assign(bytes, 0);
+    std::memcpy(buf_.data(), &hdr, sizeof(hdr));
+    std::memcpy(buf_.data() + sizeof(hdr), &dir, sizeof(dir));
+
+    uint8_t* b = buf_.data();
+    scatter<uint64_t>(b + dir.ts, recs, n, offsetof(Bar1m, ts_ns));
+    scatter<double>(b + dir.open, recs, n, offsetof(Bar1m, open));
+    scatter<double>(b + dir.high, recs, n, offsetof(Bar1m, high));
+    scatter<double>(b + dir.low, recs, n, offsetof(Bar1m, low));
+    scatter<double>(b + dir.close, recs, n, offsetof(Bar1m, close));
+    scatter<float>(b + dir.volume, recs, n, offsetof(Bar1m, volume));
+    return bytes;
+}
+
+// Returns 0 when the day isn't exactly representable; the caller falls back to rows.
+size_t TapeWriter::encode_packed(const Bar1m* recs, size_t n) {
+    return encode_packed_tape(recs, n, buf_) ? buf_.size() : 0;
+}
+
+// ts points at the first record's timestamp; the next is ts_step bytes on.
+void TapeWriter::write_index(const std::string& tape_path, const uint8_t* ts, size_t ts_step, size_t n) {
+    const size_t entries = (n + stride_ - 1) / stride_;
+    const size_t idx_bytes = sizeof(IndexHeader) + entries * sizeof(IndexEntry);
+    buf_.resize(idx_bytes);
+
+    IndexHeader ih{};
+    std::memcpy(ih.magic, "IDXv001\0", 8);
+    ih.version = 1;
+    ih.stride = stride_;
+    ih.entry_count = entries;
+    std::memcpy(buf_.data(), &ih, sizeof(ih));
+
+    auto* out = reinterpret_cast<IndexEntry*>(buf_.data() + sizeof(IndexHeader));
+    for (size_t k = 0; k < entries; ++k) {
+        const size_t i = k * stride_;
+        IndexEntry e{0, sizeof(TapeHeader) + i * sizeof(Bar1m)};
+        std::memcpy(&e.ts_ns, ts + i * ts_step, sizeof(e.ts_ns));
+        std::memcpy(out + k, &e, sizeof(e));
+    }
+
+    std::string idx_path = tape_path;
+    if (idx_path.size() > 5 && idx_path.compare(idx_path.size() - 5, 5, ".tape") == 0)
+        idx_path.replace(idx_path.size() - 5, 5, ".idx");
+    else
+        idx_path += ".idx";
+    write_file(idx_path, buf_.data(), idx_bytes);
+}
+
+void TapeWriter::write_file(const std::string& path, const uint8_t* data, size_t bytes) {
+    // Through a temp file + rename: a reader mapping the old tape never sees
+    // it half written, and replacing it touches the directory's write time,
+    // which is what TapeCatalog::is_current checks.
+    const std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+        throw std::runtime_error("Cannot open for writing: " + tmp);
+    const bool ok = std::fwrite(data, 1, bytes, f) == bytes;
+    const bool closed = std::fclose(f) == 0;
+    std::error_code ec;
+    if (!ok || !closed) {
+        std::filesystem::remove(tmp, ec);
+        throw std::runtime_error("Write failed: " + tmp);
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        throw std::runtime_error("Failed renaming " + tmp + " (" + ec.message() + ")");
+    }
+}
+
+}  // namespace datahandler
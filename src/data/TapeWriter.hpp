@@ -0,0 +1,67 @@
+#pragma once
+
+#include "TapeTypes.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace datahandler
+{
+
+    enum class TapeLayout
+    {
+        Rows,    // version 1, RECORD_BAR_1M (what tools/makeTape.py writes)
+        Columns, // version 2, RECORD_BAR_1M_COLUMNAR
+        Packed,  // version 3, RECORD_BAR_1M_PACKED; days that can't be packed exactly are written as Rows
+    };
+
+    // Writes daily TAPEv001 files and their IDXv001 sidecars. Row tapes are
+    // byte-for-byte what tools/makeTape.py produces. The output buffer is reused
+    // across days, so a writer kept for a whole build doesn't allocate per day.
+    class TapeWriter
+    {
+    public:
+        explicit TapeWriter(uint32_t index_stride = 720, TapeLayout layout = TapeLayout::Rows)
+            : stride_(index_stride), layout_(layout) {}
+
+        // Writes tape_path (and the .idx next to it when stride > 0).
+        // n must be > 0. Throws on I/O failure.
+        void write_day(const std::string &tape_path, const Bar1m *recs, size_t n);
+
+        // Writes an already encoded tape (a day taken out of a TapePack) as is
+        // and regenerates its .idx from the timestamps stored in it when
+        // stride > 0 and it holds bars. Throws on I/O failure or a malformed tape.
+        void copy_day(const std::string &tape_path, const uint8_t *tape, size_t bytes);
+
+        // Writes a tick tape: version 5 packed ticks with the Packed layout (rows
+        // when a day can't be packed exactly), version 4 Tick rows otherwise. No
+        // sidecar; TickReader seeks on the records themselves. n must be > 0.
+        void write_tick_day(const std::string &tape_path, const Tick *ticks, size_t n);
+
+        // Store CRC32C checksums over blocks of this many payload bytes in every
+        // tape written from now on (see TapeChecksum.hpp). 0, the default, writes
+        // tapes without checksums, like tools/makeTape.py.
+        void set_checksum_block(uint32_t bytes) { crc_block_ = bytes; }
+        uint32_t checksum_block() const { return crc_block_; }
+
+        uint32_t index_stride() const { return stride_; }
+        TapeLayout layout() const { return layout_; }
+
+    private:
+        size_t encode_rows(const Bar1m *recs, size_t n);
+        size_t encode_columns(const Bar1m *recs, size_t n);
+        size_t encode_packed(const Bar1m *recs, size_t n);
+        size_t encode_tick_rows(const Tick *ticks, size_t n);
+        void write_tape(const std::string &tape_path, size_t bytes);
+        void write_index(const std::string &tape_path, const uint8_t *ts, size_t ts_step, size_t n);
+        void write_file(const std::string &path, const uint8_t *data, size_t bytes);
+
+        uint32_t stride_;
+        TapeLayout layout_;
+        uint32_t crc_block_ = 0;
+        std::vector<uint8_t> buf_;
+        std::vector<Bar1m> rows_; // copy_day: decoded packed tape
+    };
+
+} // namespace datahandler
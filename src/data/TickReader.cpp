@@ -0,0 +1,275 @@
+#include "TickReader.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace datahandler {
+
+namespace {
+    void die_if(bool cond, const char* msg) {
+        if (cond) throw std::runtime_error(msg);
+    }
+}
+
+TickReader::TickReader(std::string base_dir,
+                       std::string symbol,
+                       int start_ymd,
+                       int end_ymd)
+    : base_dir_(std::move(base_dir))
+    , symbol_(std::move(symbol))
+    , start_ymd_(start_ymd)
+    , end_ymd_(end_ymd)
+{
+    die_if(end_ymd_ < start_ymd_, "end date must be >= start date");
+}
+
+bool TickReader::nextTick(Tick& out) {
+    if (!fill())
+        return false;
+    out = chunk_.data[pos_++];
+    ++ticks_read_;
+    return true;
+}
+
+bool TickReader::nextBatch(TickBatch& out) {
+    if (!fill())
+        return false;
+    out.data = chunk_.data + pos_;
+    out.size = chunk_.size - pos_;
+    out.first_index = ticks_read_;
+    ticks_read_ += out.size;
+    pos_ = chunk_.size;
+    return true;
+}
+
+bool TickReader::quote_at(uint64_t ts_ns, Tick& out) {
+    while (fill()) {
+        const Tick* first = chunk_.data + pos_;
+        const Tick* last = chunk_.data + chunk_.size;
+        if (first->ts_ns > ts_ns)
+            break;
+
+        // Ticks of the chunk at or before ts_ns; the last one is the quote.
+        const Tick* it = last[-1].ts_ns <= ts_ns
+                             ? last
+                             : std::upper_bound(first, last, ts_ns,
+                                                [](uint64_t t, const Tick& k) { return t < k.ts_ns; });
+        last_ = it[-1];
+        have_last_ = true;
+        ticks_read_ += static_cast<uint64_t>(it - first);
+        pos_ += static_cast<size_t>(it - first);
+        if (it != last)
+            break;
+    }
+    if (have_last_)
+        out = last_;
+    return have_last_;
+}
+
+bool TickReader::seek(uint64_t ts_ns) {
+    if (!days_resolved_)
+        resolve_days();
+
+    // First day whose last tick is at/after ts_ns.
+    const auto it = std::lower_bound(days_.begin(), days_.end(), ts_ns,
+                                     [](const CatalogEntry& e, uint64_t t) { return e.last_ts_ns < t; });
+
+    ticks_read_ = 0;
+    have_last_ = false;
+    chunk_ = TickBatch{};
+    pos_ = 0;
+    if (it == days_.end()) {
+        day_pos_ = days_.size();
+        open_ = false;
+        chunks_ = next_chunk_ = 0;
+        return false;
+    }
+
+    const size_t k = static_cast<size_t>(it - days_.begin());
+    open_day(k);
+    day_pos_ = k + 1;
+
+    if (is_packed_) {
+        // Last block starting at/before ts_ns; the target is in it or opens the next.
+        uint32_t lo = 0, hi = packed_.dir.block_count;
+        while (hi - lo > 1) {
+            const uint32_t mid = lo + (hi - lo) / 2;
+            if (packed_tick_block_ts(packed_, mid) <= ts_ns)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        next_chunk_ = lo;
+    } else {
+        uint64_t lo = 0, hi = count_;
+        while (lo < hi) {
+            const uint64_t mid = lo + (hi - lo) / 2;
+            if (rows_[mid].ts_ns < ts_ns)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        next_chunk_ = lo / PACKED_TICK_BLOCK;
+    }
+
+    // Skip the ticks before ts_ns inside the chunk without counting them.
+    while (next_chunk()) {
+        const Tick* first = chunk_.data;
+        const Tick* last = chunk_.data + chunk_.size;
+        pos_ = static_cast<size_t>(std::lower_bound(first, last, ts_ns,
+                                                    [](const Tick& k, uint64_t t) { return k.ts_ns < t; }) - first);
+        if (pos_ < chunk_.size)
+            return true;
+    }
+    return fill();
+}
+
+// Makes chunk_ hold at least one unread tick; false at the end of the range.
+bool TickReader::fill() {
+    while (pos_ >= chunk_.size) {
+        if (next_chunk())
+            continue;
+        if (!days_resolved_)
+            resolve_days();
+        if (day_pos_ >= days_.size())
+            return false;
+        open_day(day_pos_++);
+    }
+    return true;
+}
+
+// Loads the next chunk of the open day. False when the day is exhausted.
+bool TickReader::next_chunk() {
+    if (!open_ || next_chunk_ >= chunks_)
+        return false;
+    load_chunk(next_chunk_++);
+    return true;
+}
+
+void TickReader::resolve_days() {
+    days_resolved_ = true;
+    if (!catalog_)
+        catalog_ = TapeCatalog::load_or_build(base_dir_, symbol_, TICK_TIMEFRAME);
+    const auto span = catalog_->range(start_ymd_, end_ymd_);
+    days_.assign(span.begin(), span.end());
+    day_pos_ = 0;
+}
+
+void TickReader::open_day(size_t k) {
+    cur_day_ = k;
+    open_ = false;
+    const CatalogEntry& e = days_[k];
+    if (e.pack_offset == 0) {
+        map_.open_readonly(make_tape_path(base_dir_, symbol_, TICK_TIMEFRAME, e.ymd), policy_);
+        bind_current(static_cast<const uint8_t*>(map_.data()), map_.size());
+        return;
+    }
+
+    const int year = e.ymd / 10000;
+    if (pack_year_ != year) {
+        pack_year_ = year;
+        pack_.open(make_pack_path(base_dir_, symbol_, TICK_TIMEFRAME, year), policy_);
+    }
+    const PackDayEntry* d = pack_.is_open() ? pack_.find(e.ymd) : nullptr;
+    die_if(!d, "Day missing from tape container");
+    map_.close();
+    bind_current(pack_.day_data(*d), static_cast<size_t>(d->bytes));
+}
+
+void TickReader::bind_current(const uint8_t* base, size_t size) {
+    die_if(size < sizeof(TapeHeader), "File too small");
+    const auto* hdr = reinterpret_cast<const TapeHeader*>(base);
+
+    die_if(std::memcmp(hdr->magic, "TAPEv001", 8) != 0, "Bad magic");
+    checksummed_ = crc_mode_ != ChecksumMode::Off && crc_.bind(base, size);
+    die_if(!is_tick_tape(*hdr), "Not a tick tape");
+
+    base_ = base;
+    count_ = hdr->record_count;
+    chunk_ = TickBatch{};
+    pos_ = 0;
+    next_chunk_ = 0;
+    rows_ = nullptr;
+    is_packed_ = hdr->record_type == RECORD_TICK_PACKED;
+
+    if (checksummed_) {
+        if (crc_mode_ == ChecksumMode::Eager) {
+            const size_t bad = crc_.check_all();
+            if (bad != TapeChecksums::ALL_OK)
+                checksum_failed(bad);
+            checksummed_ = false;
+        } else {
+            crc_done_.assign(crc_.block_count(), 0);
+        }
+    }
+
+    if (is_packed_) {
+        packed_ = open_packed_ticks(base, size);
+        // The block offsets are read before any block is checked.
+        if (checksummed_ && packed_.dir.block_count > 0)
+            check_bytes(sizeof(TapeHeader),
+                        sizeof(TapeHeader) + sizeof(PackedDirectory) + packed_.dir.block_count * sizeof(uint64_t));
+        chunks_ = packed_.dir.block_count;
+        if (buf_.size() < packed_.dir.block_size)
+            buf_.resize(PACKED_TICK_BLOCK);
+    } else {
+        const size_t max_records = (size - sizeof(TapeHeader)) / sizeof(Tick);
+        die_if(count_ > max_records, "record_count exceeds file size");
+        die_if(checksummed_ && sizeof(TapeHeader) + count_ * sizeof(Tick) > crc_.payload_end(),
+               "record_count exceeds checksummed payload");
+        rows_ = reinterpret_cast<const Tick*>(base + sizeof(TapeHeader));
+        chunks_ = (count_ + PACKED_TICK_BLOCK - 1) / PACKED_TICK_BLOCK;
+    }
+    open_ = true;
+}
+
+void TickReader::load_chunk(uint64_t chunk) {
+    if (!is_packed_) {
+        const uint64_t first = chunk * PACKED_TICK_BLOCK;
+        const uint64_t last = std::min<uint64_t>(count_, first + PACKED_TICK_BLOCK);
+        if (checksummed_)
+            check_bytes(sizeof(TapeHeader) + first * sizeof(Tick), sizeof(TapeHeader) + last * sizeof(Tick));
+        chunk_.data = rows_ + first;
+        chunk_.size = static_cast<size_t>(last - first);
+    } else {
+        const uint32_t b = static_cast<uint32_t>(chunk);
+        if (checksummed_) {
+            const uint64_t end = b + 1 < packed_.dir.block_count ? packed_tick_block_offset(packed_, b + 1)
+                                                                 : crc_.payload_end();
+            check_bytes(packed_tick_block_offset(packed_, b), end);
+        }
+        chunk_.data = buf_.data();
+        chunk_.size = decode_tick_block(packed_, b, buf_.data());
+    }
+    pos_ = 0;
+}
+
+// Verifies the checksum blocks under tape bytes [begin, end) not checked yet.
+void TickReader::check_bytes(uint64_t begin, uint64_t end) {
+    if (begin >= end || begin >= crc_.payload_end())
+        return;
+    end = std::min(end, crc_.payload_end());
+    const size_t b0 = crc_.block_of(begin);
+    const size_t b1 = crc_.block_of(end - 1);
+    for (size_t b = b0; b <= b1; ++b) {
+        if (crc_done_[b])
+            continue;
+        if (!crc_.check_block(b))
+            checksum_failed(b);
+        crc_done_[b] = 1;
+    }
+}
+
+void TickReader::checksum_failed(size_t block) const {
+    std::string what = "Checksum mismatch in " + symbol_ + " " + TICK_TIMEFRAME + " " +
+                       std::to_string(cur_day_ < days_.size() ? days_[cur_day_].ymd : 0);
+    if (block < crc_.block_count())
+        what += " (block " + std::to_string(block) + " of " + std::to_string(crc_.block_count()) + ")";
+    else
+        what += " (file checksum)";
+    throw std::runtime_error(what);
+}
+
+}  // namespace datahandler
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "TapeTypes.hpp"
+#include "DateUtils.hpp"
+#include "MMapFile.hpp"
+#include "TapeCatalog.hpp"
+#include "TapeChecksum.hpp"
+#include "TapeCodec.hpp"
+#include "TapePack.hpp"
+#include "TapeReader.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace datahandler
+{
+
+    // Timeframe directory of tick tapes: BASE_DIR/bars/SYMBOL/tick/YYYY/...
+    inline constexpr const char *TICK_TIMEFRAME = "tick";
+
+    // Read-only view over consecutive ticks of one tape.
+    // Valid until the next read call on the reader.
+    struct TickBatch
+    {
+        const Tick *data = nullptr;
+        size_t size = 0;
+        uint64_t first_index = 0; // run-wide index of data[0]
+
+        const Tick *begin() const { return data; }
+        const Tick *end() const { return data + size; }
+        const Tick &operator[](size_t i) const { return data[i]; }
+    };
+
+    // Streams ticks (version 4 rows or version 5 packed, see TapeCodec.hpp)
+    // across a date range, in chunks of at most PACKED_TICK_BLOCK ticks. Row
+    // chunks point into the mapping; packed chunks are decoded one block at a
+    // time into a buffer allocated once, so a day of tens of millions of ticks
+    // costs no more memory than a quiet one. Days come from the "tick" catalog;
+    // days in a year container are read from its single mapping.
+    class TickReader
+    {
+    public:
+        TickReader(std::string base_dir,
+                   std::string symbol,
+                   int start_ymd,
+                   int end_ymd);
+
+        // Returns true if a tick was filled, false when no more ticks.
+        bool nextTick(Tick &out);
+
+        // Hands out the rest of the current chunk. Returns false when no more
+        // ticks. Can be mixed with nextTick().
+        bool nextBatch(TickBatch &out);
+
+        // Latest tick at or before ts_ns, consuming every tick up to it; the
+        // way to feed BrokerSim::set_quote() from a bar loop. ts_ns must not
+        // decrease between calls (seek() to go back). Returns false while no
+        // tick at or before ts_ns has been seen.
+        bool quote_at(uint64_t ts_ns, Tick &out);
+
+        // Positions the reader on the first tick with ts_ns >= ts_ns: the day
+        // from the catalog, then the block from block timestamps (packed) or a
+        // binary search (rows). Resets ticks_read() and the quote_at() state.
+        // Returns false if no tick in range is at or after ts_ns.
+        bool seek(uint64_t ts_ns);
+
+        // Number of ticks handed out (or passed by quote_at()) so far.
+        uint64_t ticks_read() const { return ticks_read_; }
+
+        // YYYYMMDD of the tape the last tick came from (0 before the first read).
+        int current_day() const { return open_ && cur_day_ < days_.size() ? days_[cur_day_].ymd : 0; }
+
+        // Same meaning as on TapeReader; apply to tapes opened from now on.
+        void set_map_policy(const MapPolicy &policy) { policy_ = policy; }
+        void set_checksum_mode(ChecksumMode mode) { crc_mode_ = mode; }
+        void set_catalog(std::shared_ptr<const TapeCatalog> catalog) { catalog_ = std::move(catalog); }
+        const std::shared_ptr<const TapeCatalog> &catalog() const { return catalog_; }
+
+        const std::string &symbol() const { return symbol_; }
+        int start_date() const { return start_ymd_; }
+        int end_date() const { return end_ymd_; }
+
+    private:
+        bool fill();
+        bool next_chunk();
+        void resolve_days();
+        void open_day(size_t k);
+        void bind_current(const uint8_t *base, size_t size);
+        void load_chunk(uint64_t chunk);
+        void check_bytes(uint64_t begin, uint64_t end);
+        [[noreturn]] void checksum_failed(size_t block) const;
+
+        std::string base_dir_;
+        std::string symbol_;
+        int start_ymd_;
+        int end_ymd_;
+
+        std::shared_ptr<const TapeCatalog> catalog_;
+        bool days_resolved_ = false;
+        std::vector<CatalogEntry> days_;
+        size_t day_pos_ = 0; // next entry of days_ to open
+        size_t cur_day_ = 0;
+        bool open_ = false;  // cur_day_ is bound
+
+        MapPolicy policy_;
+        MMapFile map_;
+        TapePack pack_;
+        int pack_year_ = 0;
+
+        // Current day.
+        const uint8_t *base_ = nullptr;
+        uint64_t count_ = 0;        // ticks in the day
+        const Tick *rows_ = nullptr; // version 4: mapped records
+        PackedTickView packed_;      // version 5
+        bool is_packed_ = false;
+        uint64_t chunks_ = 0;        // chunks in the day
+        uint64_t next_chunk_ = 0;
+
+        std::vector<Tick> buf_;      // one decoded packed block
+        TickBatch chunk_;            // current chunk
+        size_t pos_ = 0;             // next tick of chunk_
+        uint64_t ticks_read_ = 0;
+
+        Tick last_{};                // last tick passed by quote_at()
+        bool have_last_ = false;
+
+        ChecksumMode crc_mode_ = ChecksumMode::Lazy;
+        TapeChecksums crc_;
+        bool checksummed_ = false;
+        std::vector<uint8_t> crc_done_;
+    };
+
+} // namespace datahandler
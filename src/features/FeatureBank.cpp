@@ -0,0 +1,248 @@
+#include "FeatureBank.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FEATURE_BANK_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define BANK_AVX2
+#define BANK_AVX512
+#else
+#define BANK_AVX2 __attribute__((target("avx2")))
+#define BANK_AVX512 __attribute__((target("avx512f")))
+#endif
+#endif
+
+// Lane values must match the scalar streams bit for bit, so a * b + c must
+// stay a multiply and an add even where FMA is available.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace features
+{
+
+    namespace
+    {
+        constexpr size_t LANES = 16; // widest vector; arrays are padded to it
+
+        size_t padded(size_t n) { return (n + LANES - 1) / LANES * LANES; }
+
+        struct Kernels
+        {
+            void (*ema)(float *value, const float *alpha, size_t n, float x);
+            void (*wilder)(float *value, float *count, float *sum, const float *pf, const float *pm1, size_t n,
+                           float x);
+            const char *isa;
+        };
+
+        void ema_scalar(float *value, const float *alpha, size_t n, float x)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                const float v = value[i];
+                const float step = v + alpha[i] * (x - v);
+                value[i] = v != v ? x : step; // NaN: not seeded yet
+            }
+        }
+
+        void wilder_scalar(float *value, float *count, float *sum, const float *pf, const float *pm1, size_t n,
+                           float x)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                const float c = count[i] + 1.0f;
+                count[i] = c;
+                const float s = c <= pf[i] ? sum[i] + x : sum[i];
+                sum[i] = s;
+                const float step = (value[i] * pm1[i] + x) / pf[i];
+                value[i] = c == pf[i] ? s / pf[i] : step; // NaN steps until warm
+            }
+        }
+
+#if defined(FEATURE_BANK_X86)
+        BANK_AVX2 void ema_avx2(float *value, const float *alpha, size_t n, float x)
+        {
+            const __m256 xv = _mm256_set1_ps(x);
+            for (size_t i = 0; i < n; i += 8)
+            {
+                const __m256 v = _mm256_loadu_ps(value + i);
+                const __m256 step = _mm256_add_ps(v, _mm256_mul_ps(_mm256_loadu_ps(alpha + i), _mm256_sub_ps(xv, v)));
+                const __m256 unseeded = _mm256_cmp_ps(v, v, _CMP_UNORD_Q);
+                _mm256_storeu_ps(value + i, _mm256_blendv_ps(step, xv, unseeded));
+            }
+        }
+
+        BANK_AVX2 void wilder_avx2(float *value, float *count, float *sum, const float *pf, const float *pm1, size_t n,
+                                   float x)
+        {
+            const __m256 xv = _mm256_set1_ps(x);
+            const __m256 one = _mm256_set1_ps(1.0f);
+            for (size_t i = 0; i < n; i += 8)
+            {
+                const __m256 p = _mm256_loadu_ps(pf + i);
+                const __m256 c = _mm256_add_ps(_mm256_loadu_ps(count + i), one);
+                _mm256_storeu_ps(count + i, c);
+                __m256 s = _mm256_loadu_ps(sum + i);
+                s = _mm256_blendv_ps(s, _mm256_add_ps(s, xv), _mm256_cmp_ps(c, p, _CMP_LE_OQ));
+                _mm256_storeu_ps(sum + i, s);
+                const __m256 v = _mm256_loadu_ps(value + i);
+                const __m256 step = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(v, _mm256_loadu_ps(pm1 + i)), xv), p);
+                const __m256 init = _mm256_div_ps(s, p);
+                _mm256_storeu_ps(value + i, _mm256_blendv_ps(step, init, _mm256_cmp_ps(c, p, _CMP_EQ_OQ)));
+            }
+        }
+
+        BANK_AVX512 void ema_avx512(float *value, const float *alpha, size_t n, float x)
+        {
+            const __m512 xv = _mm512_set1_ps(x);
+            for (size_t i = 0; i < n; i += 16)
+            {
+                const __m512 v = _mm512_loadu_ps(value + i);
+                const __m512 step = _mm512_add_ps(v, _mm512_mul_ps(_mm512_loadu_ps(alpha + i), _mm512_sub_ps(xv, v)));
+                const __mmask16 unseeded = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+                _mm512_storeu_ps(value + i, _mm512_mask_blend_ps(unseeded, step, xv));
+            }
+        }
+
+        BANK_AVX512 void wilder_avx512(float *value, float *count, float *sum, const float *pf, const float *pm1,
+                                       size_t n, float x)
+        {
+            const __m512 xv = _mm512_set1_ps(x);
+            const __m512 one = _mm512_set1_ps(1.0f);
+            for (size_t i = 0; i < n; i += 16)
+            {
+                const __m512 p = _mm512_loadu_ps(pf + i);
+                const __m512 c = _mm512_add_ps(_mm512_loadu_ps(count + i), one);
+                _mm512_storeu_ps(count + i, c);
+                __m512 s = _mm512_loadu_ps(sum + i);
+                s = _mm512_mask_add_ps(s, _mm512_cmp_ps_mask(c, p, _CMP_LE_OQ), s, xv);
+                _mm512_storeu_ps(sum + i, s);
+                const __m512 v = _mm512_loadu_ps(value + i);
+                const __m512 step = _mm512_div_ps(_mm512_add_ps(_mm512_mul_ps(v, _mm512_loadu_ps(pm1 + i)), xv), p);
+                const __m512 init = _mm512_div_ps(s, p);
+                _mm512_storeu_ps(value + i, _mm512_mask_blend_ps(_mm512_cmp_ps_mask(c, p, _CMP_EQ_OQ), step, init));
+            }
+        }
+
+#if defined(_MSC_VER) && !defined(__clang__)
+        // The OS saves these register states on context switches.
+        bool os_saves(uint64_t mask)
+        {
+            int info[4];
+            __cpuid(info, 1);
+            if (!(info[2] & (1 << 27))) // OSXSAVE
+                return false;
+            return (_xgetbv(0) & mask) == mask;
+        }
+#endif
+
+        bool has_avx512()
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 16)) && os_saves(0xE6);
+#else
+            return __builtin_cpu_supports("avx512f");
+#endif
+        }
+
+        bool has_avx2()
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) && os_saves(0x6);
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+
+        Kernels pick_kernels()
+        {
+#if defined(FEATURE_BANK_X86)
+            if (has_avx512())
+                return {ema_avx512, wilder_avx512, "avx512"};
+            if (has_avx2())
+                return {ema_avx2, wilder_avx2, "avx2"};
+#endif
+            return {ema_scalar, wilder_scalar, "scalar"};
+        }
+
+        const Kernels &kernels()
+        {
+            static const Kernels k = pick_kernels();
+            return k;
+        }
+    }
+
+    const char *feature_bank_isa()
+    {
+        return kernels().isa;
+    }
+
+    size_t EmaBank::add(int period)
+    {
+        for (size_t i = 0; i < periods_.size(); ++i)
+            if (periods_[i] == period)
+                return i;
+
+        const size_t lane = periods_.size();
+        periods_.push_back(period);
+        const size_t n = padded(periods_.size());
+        alpha_.resize(n, 0.0f);
+        value_.resize(n, NAN);
+        alpha_[lane] = 2.0f / (period + 1.0f);
+        return lane;
+    }
+
+    void EmaBank::update(float x)
+    {
+        kernels().ema(value_.data(), alpha_.data(), value_.size(), x);
+    }
+
+    void EmaBank::reset()
+    {
+        std::fill(value_.begin(), value_.end(), NAN);
+    }
+
+    size_t WilderBank::add(int period)
+    {
+        for (size_t i = 0; i < periods_.size(); ++i)
+            if (periods_[i] == period)
+                return i;
+
+        const size_t lane = periods_.size();
+        periods_.push_back(period);
+        const size_t n = padded(periods_.size());
+        // Padding lanes run as period 1 so they never divide by zero.
+        period_f_.resize(n, 1.0f);
+        pm1_.resize(n, 0.0f);
+        value_.resize(n, NAN);
+        count_.resize(n, 0.0f);
+        sum_.resize(n, 0.0f);
+        period_f_[lane] = static_cast<float>(period);
+        pm1_[lane] = static_cast<float>(period - 1);
+        return lane;
+    }
+
+    void WilderBank::update(float x)
+    {
+        kernels().wilder(value_.data(), count_.data(), sum_.data(), period_f_.data(), pm1_.data(), value_.size(), x);
+    }
+
+    void WilderBank::reset()
+    {
+        std::fill(value_.begin(), value_.end(), NAN);
+        std::fill(count_.begin(), count_.end(), 0.0f);
+        std::fill(sum_.begin(), sum_.end(), 0.0f);
+    }
+
+} // namespace features
@@ -0,0 +1,70 @@
+#pragma once
+#include <cmath> // NAN
+#include <cstddef>
+#include <vector>
+
+namespace features
+{
+
+    // Many periods of one indicator over one input, stored structure-of-arrays
+    // (one array per field, a lane per period) and updated 16 lanes per
+    // AVX-512 instruction, 8 per AVX2 one, or one at a time where neither is
+    // available (picked once at run time). All lanes see the same input, so
+    // 20-50 periods cost about what one does.
+    //
+    // Lane values match EMAStream / ATRStream exactly: the same float
+    // operations in the same order, with warmup selected per lane by compare
+    // masks instead of per-period branches. A lane added after updates have
+    // started warms up from the next one, like a fresh stream.
+
+    class EmaBank
+    {
+    public:
+        // Lane of period, added if new.
+        size_t add(int period);
+
+        // A lane seeds on the first x it sees, as EMAStream does.
+        void update(float x);
+
+        float value(size_t lane) const { return value_[lane]; } // NaN before the first update
+        const float *values() const { return value_.data(); }
+        int period(size_t lane) const { return periods_[lane]; }
+        size_t size() const { return periods_.size(); }
+
+        void reset();
+
+    private:
+        std::vector<int> periods_;
+        std::vector<float> alpha_; // padded to a multiple of 16 lanes
+        std::vector<float> value_; // NaN until seeded
+    };
+
+    // Wilder smoothing (the ATR average): mean of the first period inputs,
+    // then y = (y * (period - 1) + x) / period.
+    class WilderBank
+    {
+    public:
+        size_t add(int period);
+
+        void update(float x);
+
+        float value(size_t lane) const { return value_[lane]; } // NaN until that lane has period inputs
+        const float *values() const { return value_.data(); }
+        int period(size_t lane) const { return periods_[lane]; }
+        size_t size() const { return periods_.size(); }
+
+        void reset();
+
+    private:
+        std::vector<int> periods_;
+        std::vector<float> period_f_; // period as float, padded to a multiple of 16 lanes
+        std::vector<float> pm1_;      // period - 1 as float
+        std::vector<float> value_;
+        std::vector<float> count_; // inputs seen; a float stops at 2^24, so periods must be below it
+        std::vector<float> sum_;   // sum of the first period inputs
+    };
+
+    // Instruction set the banks run on: "avx512", "avx2" or "scalar".
+    const char *feature_bank_isa();
+
+} // namespace features
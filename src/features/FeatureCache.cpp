@@ -0,0 +1,249 @@
+#include "FeatureCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace features
+{
+
+    namespace
+    {
+        namespace fs = std::filesystem;
+
+        constexpr char CACHE_MAGIC[8] = {'F', 'C', 'O', 'L', 'v', '0', '0', '1'};
+        constexpr uint64_t DATA_ALIGN = 64;
+
+        // Temp files older than this belong to a writer that died.
+        constexpr auto STALE_TEMP_AGE = std::chrono::hours(1);
+
+        std::string key_text(const FeatureCacheKey &key)
+        {
+            return key.symbol + '\n' + key.timeframe + '\n' + std::to_string(key.start_ymd) + '\n' +
+                   std::to_string(key.end_ymd) + '\n' + std::to_string(key.warmup_bars) + '\n' + key.spec;
+        }
+
+        std::string hex64(uint64_t v)
+        {
+            char buf[17];
+            std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+            return buf;
+        }
+
+        // FNV-1a, as TapeCatalog fingerprints its entries.
+        uint64_t fnv1a(const std::string &s)
+        {
+            uint64_t h = 1469598103934665603ull;
+            for (unsigned char c : s)
+            {
+                h ^= c;
+                h *= 1099511628211ull;
+            }
+            return h;
+        }
+
+        unsigned long process_id()
+        {
+#ifdef _WIN32
+            return static_cast<unsigned long>(GetCurrentProcessId());
+#else
+            return static_cast<unsigned long>(::getpid());
+#endif
+        }
+
+        bool is_column(const fs::path &p) { return p.extension() == ".fcol"; }
+
+        bool is_temp(const fs::path &p) { return p.filename().string().find(".fcol.tmp") != std::string::npos; }
+    }
+
+    FeatureCache::FeatureCache(std::string dir, uint64_t max_bytes) : dir_(std::move(dir)), max_bytes_(max_bytes) {}
+
+    std::string FeatureCache::path(const FeatureCacheKey &key) const
+    {
+        return dir_ + "/" + key.symbol + "/" + key.timeframe + "/" + hex64(key.catalog_fingerprint) + "/" +
+               hex64(fnv1a(key_text(key))) + ".fcol";
+    }
+
+    bool FeatureCache::load(const FeatureCacheKey &key, CachedColumn &out)
+    {
+        const std::string p = path(key);
+        std::error_code ec;
+        if (!fs::is_regular_file(p, ec))
+            return false;
+
+        datahandler::MMapFile file;
+        try
+        {
+            file.open_readonly(p);
+        }
+        catch (const std::runtime_error &)
+        {
+            return false;
+        }
+
+        FeatureCacheHeader hdr{};
+        if (file.size() < sizeof(hdr))
+            return false;
+        std::memcpy(&hdr, file.data(), sizeof(hdr));
+        const std::string text = key_text(key);
+        const char *base = static_cast<const char *>(file.data());
+        const bool ok = std::memcmp(hdr.magic, CACHE_MAGIC, 8) == 0 && hdr.version == FEATURE_CACHE_VERSION &&
+                        hdr.catalog_fingerprint == key.catalog_fingerprint && hdr.key_size == text.size() &&
+                        sizeof(hdr) + hdr.key_size <= hdr.data_offset && hdr.data_offset % DATA_ALIGN == 0 &&
+                        hdr.data_offset <= file.size() &&
+                        hdr.count <= file.size() / sizeof(float) &&
+                        file.size() - hdr.data_offset == hdr.count * sizeof(float) &&
+                        std::memcmp(base + sizeof(hdr), text.data(), text.size()) == 0; // not a hash collision
+        if (!ok)
+            return false;
+
+        // Mark it used for eviction.
+        fs::last_write_time(p, fs::file_time_type::clock::now(), ec);
+
+        out.data_ = reinterpret_cast<const float *>(base + hdr.data_offset);
+        out.size_ = static_cast<size_t>(hdr.count);
+        out.file_ = std::move(file);
+        return true;
+    }
+
+    bool FeatureCache::store(const FeatureCacheKey &key, const float *values, size_t n)
+    {
+        if (!values || n == 0)
+            return false;
+
+        const std::string p = path(key);
+        std::error_code ec;
+        fs::create_directories(fs::path(p).parent_path(), ec);
+        if (ec)
+            return false;
+
+        const std::string text = key_text(key);
+        FeatureCacheHeader hdr{};
+        std::memcpy(hdr.magic, CACHE_MAGIC, 8);
+        hdr.version = FEATURE_CACHE_VERSION;
+        hdr.key_size = static_cast<uint32_t>(text.size());
+        hdr.catalog_fingerprint = key.catalog_fingerprint;
+        hdr.data_offset = (sizeof(hdr) + text.size() + DATA_ALIGN - 1) / DATA_ALIGN * DATA_ALIGN;
+        hdr.count = n;
+
+        // Per process, so concurrent writers of one key don't share a temp file.
+        const std::string tmp = p + ".tmp" + std::to_string(process_id());
+        {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            if (f)
+            {
+                const std::vector<char> pad(hdr.data_offset - sizeof(hdr) - text.size(), 0);
+                f.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+                f.write(text.data(), static_cast<std::streamsize>(text.size()));
+                f.write(pad.data(), static_cast<std::streamsize>(pad.size()));
+                f.write(reinterpret_cast<const char *>(values), static_cast<std::streamsize>(n * sizeof(float)));
+            }
+            if (!f)
+            {
+                f.close();
+                fs::remove(tmp, ec);
+                return false;
+            }
+        }
+
+        // Fails on Windows while another process maps the old file, which is
+        // then still a valid copy.
+        fs::rename(tmp, p, ec);
+        if (ec)
+        {
+            fs::remove(tmp, ec);
+            return false;
+        }
+
+        evict(p);
+        return true;
+    }
+
+    uint64_t FeatureCache::evict(const std::string &keep)
+    {
+        struct Entry
+        {
+            fs::path path;
+            uint64_t bytes;
+            fs::file_time_type used;
+        };
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+        const auto now = fs::file_time_type::clock::now();
+
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(dir_, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec))
+        {
+            std::error_code st;
+            if (!it->is_regular_file(st))
+                continue;
+            const auto used = it->last_write_time(st);
+            if (st)
+                continue;
+            if (is_temp(it->path()))
+            {
+                if (now - used > STALE_TEMP_AGE)
+                    fs::remove(it->path(), st);
+                continue;
+            }
+            if (!is_column(it->path()))
+                continue;
+            const uint64_t bytes = it->file_size(st);
+            if (st)
+                continue;
+            entries.push_back({it->path(), bytes, used});
+            total += bytes;
+        }
+        if (max_bytes_ == 0 || total <= max_bytes_)
+            return 0;
+
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+        uint64_t freed = 0;
+        for (const Entry &e : entries)
+        {
+            if (total - freed <= max_bytes_)
+                break;
+            if (!keep.empty() && e.path == fs::path(keep))
+                continue;
+            std::error_code rm;
+            if (fs::remove(e.path, rm))
+            {
+                freed += e.bytes;
+                fs::remove(e.path.parent_path(), rm); // only if that was its last column
+            }
+        }
+        return freed;
+    }
+
+    uint64_t FeatureCache::disk_bytes() const
+    {
+        uint64_t total = 0;
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(dir_, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec))
+        {
+            std::error_code st;
+            if (!it->is_regular_file(st) || !is_column(it->path()))
+                continue;
+            const uint64_t bytes = it->file_size(st);
+            if (!st)
+                total += bytes;
+        }
+        return total;
+    }
+
+} // namespace features
@@ -0,0 +1,104 @@
+#pragma once
+#include "data/MMapFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace features
+{
+
+    // On-disk store of precomputed feature columns, shared by every run and
+    // process pointed at the same directory. A column is one file of floats
+    // laid out as
+    //   DIR/SYMBOL/TIMEFRAME/<catalog fingerprint>/<key hash>.fcol
+    // and later runs map it read-only instead of recomputing it. The
+    // fingerprint covers the size and write time of just the tapes the run
+    // reads, warmup days included, so rebuilding one of them makes its
+    // columns stop matching while adding a day elsewhere leaves other ranges
+    // cached. Columns that no longer match are never hit again and age out:
+    // total size is capped by evicting the least recently used files; a hit
+    // refreshes the file's write time, which is what "used" means across
+    // processes.
+
+    // Bump when precompute changes the values it writes.
+    constexpr uint32_t FEATURE_CACHE_VERSION = 2;
+
+#pragma pack(push, 1)
+    struct FeatureCacheHeader
+    {
+        char magic[8];                // "FCOLv001"
+        uint32_t version;             // FEATURE_CACHE_VERSION
+        uint32_t key_size;            // key text right after the header
+        uint64_t catalog_fingerprint;
+        uint64_t data_offset;         // of the floats, 64-byte aligned
+        uint64_t count;               // floats
+        uint8_t reserved[24];
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FeatureCacheHeader) == 64, "FeatureCacheHeader must be 64 bytes");
+
+    // What a column was computed from; runs share a column only when all of it matches.
+    struct FeatureCacheKey
+    {
+        std::string symbol;
+        std::string timeframe;
+        int start_ymd = 0;
+        int end_ymd = 0;
+        uint64_t warmup_bars = 0;         // bars requested before start_ymd
+        uint64_t catalog_fingerprint = 0; // TapeCatalog::fingerprint(first day read, end_ymd)
+        std::string spec;                 // canonical FeatureGraph spec
+    };
+
+    // A column mapped from the cache, valid while this object lives.
+    class CachedColumn
+    {
+    public:
+        const float *data() const { return data_; }
+        size_t size() const { return size_; }
+        bool is_open() const { return file_.is_open(); }
+
+    private:
+        friend class FeatureCache;
+        datahandler::MMapFile file_;
+        const float *data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    class FeatureCache
+    {
+    public:
+        static constexpr uint64_t DEFAULT_MAX_BYTES = 4ull << 30;
+
+        // max_bytes 0: no limit.
+        explicit FeatureCache(std::string dir, uint64_t max_bytes = DEFAULT_MAX_BYTES);
+
+        // Maps key's column and marks it used. False when it isn't cached, was
+        // computed from other tapes, or the file is unreadable.
+        bool load(const FeatureCacheKey &key, CachedColumn &out);
+
+        // Writes a column through a temp file + rename, so a reader in another
+        // process sees either the old file or the whole new one, then evicts
+        // down to the size limit. The cache is best effort: I/O failures
+        // return false.
+        bool store(const FeatureCacheKey &key, const float *values, size_t n);
+
+        // Deletes least recently used columns, never keep, until the cache fits
+        // max_bytes, and the fingerprint directories that leaves empty. Returns
+        // the bytes freed.
+        uint64_t evict(const std::string &keep = {});
+
+        // Bytes of columns on disk.
+        uint64_t disk_bytes() const;
+
+        std::string path(const FeatureCacheKey &key) const;
+        const std::string &dir() const { return dir_; }
+        uint64_t max_bytes() const { return max_bytes_; }
+
+    private:
+        std::string dir_;
+        uint64_t max_bytes_;
+    };
+
+} // namespace features
@@ -0,0 +1,485 @@
+#include "FeatureGraph.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace features
+{
+
+    namespace
+    {
+        struct OpName
+        {
+            const char *name;
+            FeatureOp op;
+        };
+
+        constexpr OpName INPUTS[] = {
+            {"open", FeatureOp::Open},
+            {"high", FeatureOp::High},
+            {"low", FeatureOp::Low},
+            {"close", FeatureOp::Close},
+            {"volume", FeatureOp::Volume},
+            {"tr", FeatureOp::TrueRange},
+            {"typical", FeatureOp::Typical},
+            {"median", FeatureOp::Median},
+        };
+
+        constexpr OpName FUNCTIONS[] = {
+            {"ema", FeatureOp::Ema},
+            {"wilder", FeatureOp::Wilder},
+            {"zscore", FeatureOp::ZScore},
+            {"sma", FeatureOp::Sma},
+            {"std", FeatureOp::Std},
+            {"rsi", FeatureOp::Rsi},
+            {"highest", FeatureOp::Highest},
+            {"lowest", FeatureOp::Lowest},
+        };
+
+        // Functions with a fixed input: atr(n) = wilder(tr,n) and so on.
+        struct Shorthand
+        {
+            const char *name;
+            FeatureOp op;
+            FeatureOp input;
+        };
+
+        constexpr Shorthand SHORTHANDS[] = {
+            {"atr", FeatureOp::Wilder, FeatureOp::TrueRange},
+            {"hh", FeatureOp::Highest, FeatureOp::High},
+            {"ll", FeatureOp::Lowest, FeatureOp::Low},
+        };
+
+        // Input of f(n), a function given only a period.
+        FeatureOp default_input(FeatureOp op)
+        {
+            switch (op)
+            {
+            case FeatureOp::Wilder:
+                return FeatureOp::TrueRange;
+            case FeatureOp::Highest:
+                return FeatureOp::High;
+            case FeatureOp::Lowest:
+                return FeatureOp::Low;
+            default:
+                return FeatureOp::Close;
+            }
+        }
+
+        const char *op_name(FeatureOp op)
+        {
+            for (const auto &n : INPUTS)
+                if (n.op == op)
+                    return n.name;
+            for (const auto &n : FUNCTIONS)
+                if (n.op == op)
+                    return n.name;
+            return "?";
+        }
+
+        bool is_input(FeatureOp op) { return op <= FeatureOp::Median; }
+
+        // Parse tree of a spec; children come before their parent.
+        struct Expr
+        {
+            FeatureOp op;
+            int child = -1;
+            int period = 0;
+        };
+
+        void skip_ws(const char *&p)
+        {
+            while (*p == ' ' || *p == '\t')
+                ++p;
+        }
+
+        bool parse_period(const char *&p, int &out)
+        {
+            skip_ws(p);
+            char *end = nullptr;
+            const long v = std::strtol(p, &end, 10);
+            if (end == p || v <= 0 || v > INT_MAX)
+                return false;
+            p = end;
+            out = static_cast<int>(v);
+            return true;
+        }
+
+        // Returns the index of the parsed expression in out, or -1.
+        int parse_expr(const char *&p, std::vector<Expr> &out)
+        {
+            skip_ws(p);
+            const char *start = p;
+            while (std::isalnum(static_cast<unsigned char>(*p)) || *p == '_')
+                ++p;
+            const std::string name(start, p);
+            skip_ws(p);
+
+            if (*p != '(')
+            {
+                for (const auto &n : INPUTS)
+                {
+                    if (name == n.name)
+                    {
+                        out.push_back({n.op});
+                        return static_cast<int>(out.size()) - 1;
+                    }
+                }
+                return -1;
+            }
+            ++p;
+
+            const OpName *fn = nullptr;
+            for (const auto &n : FUNCTIONS)
+                if (name == n.name)
+                    fn = &n;
+            const Shorthand *sh = nullptr;
+            for (const auto &n : SHORTHANDS)
+                if (name == n.name)
+                    sh = &n;
+            if (!fn && !sh)
+                return -1;
+
+            Expr e{sh ? sh->op : fn->op};
+            skip_ws(p);
+            if (sh || std::isdigit(static_cast<unsigned char>(*p)))
+            {
+                out.push_back({sh ? sh->input : default_input(e.op)});
+                e.child = static_cast<int>(out.size()) - 1;
+            }
+            else
+            {
+                e.child = parse_expr(p, out);
+                if (e.child < 0)
+                    return -1;
+                skip_ws(p);
+                if (*p++ != ',')
+                    return -1;
+            }
+            if (!parse_period(p, e.period))
+                return -1;
+            skip_ws(p);
+            if (*p++ != ')')
+                return -1;
+
+            out.push_back(e);
+            return static_cast<int>(out.size()) - 1;
+        }
+
+        // Parses a whole spec; returns the root index or -1.
+        int parse_spec(const std::string &spec, std::vector<Expr> &out)
+        {
+            const char *p = spec.c_str();
+            const int root = parse_expr(p, out);
+            skip_ws(p);
+            return (root >= 0 && *p == '\0') ? root : -1;
+        }
+
+        std::string make_key(FeatureOp op, const std::string &input_key, int period)
+        {
+            if (is_input(op))
+                return op_name(op);
+            return std::string(op_name(op)) + "(" + input_key + "," + std::to_string(period) + ")";
+        }
+
+        std::string expr_key(const std::vector<Expr> &tree, int i)
+        {
+            const Expr &e = tree[static_cast<size_t>(i)];
+            return make_key(e.op, e.child >= 0 ? expr_key(tree, e.child) : std::string(), e.period);
+        }
+    }
+
+    int FeatureGraph::add(const std::string &spec)
+    {
+        std::vector<Expr> tree;
+        if (parse_spec(spec, tree) < 0)
+            throw std::runtime_error("Bad feature spec: " + spec);
+
+        // Children precede parents in the tree, so one pass lowers it.
+        std::vector<int> ids(tree.size());
+        for (size_t i = 0; i < tree.size(); ++i)
+        {
+            const Expr &e = tree[i];
+            ids[i] = intern(e.op, e.child >= 0 ? ids[static_cast<size_t>(e.child)] : -1, e.period);
+        }
+        return ids.back();
+    }
+
+    int FeatureGraph::find(const std::string &spec) const
+    {
+        std::vector<Expr> tree;
+        const int root = parse_spec(spec, tree);
+        if (root < 0)
+            return -1;
+        auto it = by_key_.find(expr_key(tree, root));
+        return it == by_key_.end() ? -1 : it->second;
+    }
+
+    int FeatureGraph::input(FeatureOp op)
+    {
+        if (!is_input(op))
+            throw std::runtime_error("Not an input feature op");
+        return intern(op, -1, 0);
+    }
+
+    int FeatureGraph::ema(int input, int period) { return intern(FeatureOp::Ema, input, period); }
+    int FeatureGraph::wilder(int input, int period) { return intern(FeatureOp::Wilder, input, period); }
+    int FeatureGraph::zscore(int input, int period) { return intern(FeatureOp::ZScore, input, period); }
+
+    int FeatureGraph::node(FeatureOp op, int input, int period)
+    {
+        if (is_input(op))
+            throw std::runtime_error("Not a function feature op");
+        return intern(op, input, period);
+    }
+
+    int FeatureGraph::intern(FeatureOp op, int input, int period)
+    {
+        // WilderBank counts inputs in a float, which stops at 2^24: a period
+        // of 2^24 or more would never see its count pass it.
+        if (!is_input(op) && (input < 0 || static_cast<size_t>(input) >= nodes_.size() || period <= 0 ||
+                              period >= (1 << 24)))
+            throw std::runtime_error("Bad feature node");
+
+        std::string key = make_key(op, is_input(op) ? std::string() : nodes_[static_cast<size_t>(input)].key, period);
+        auto it = by_key_.find(key);
+        if (it != by_key_.end())
+            return it->second;
+
+        Node n;
+        n.op = op;
+        n.input = is_input(op) ? -1 : input;
+        n.period = is_input(op) ? 0 : period;
+        switch (op)
+        {
+        case FeatureOp::Ema:
+        {
+            auto it = std::find(ema_bank_input_.begin(), ema_bank_input_.end(), input);
+            n.lead = it == ema_bank_input_.end();
+            if (n.lead)
+            {
+                ema_banks_.emplace_back();
+                ema_bank_input_.push_back(input);
+                it = ema_bank_input_.end() - 1;
+            }
+            n.slot = static_cast<uint32_t>(it - ema_bank_input_.begin());
+            n.lane = static_cast<uint32_t>(ema_banks_[n.slot].add(period));
+            break;
+        }
+        case FeatureOp::Wilder:
+        {
+            auto it = std::find(wilder_bank_input_.begin(), wilder_bank_input_.end(), input);
+            n.lead = it == wilder_bank_input_.end();
+            if (n.lead)
+            {
+                wilder_banks_.emplace_back();
+                wilder_bank_input_.push_back(input);
+                it = wilder_bank_input_.end() - 1;
+            }
+            n.slot = static_cast<uint32_t>(it - wilder_bank_input_.begin());
+            n.lane = static_cast<uint32_t>(wilder_banks_[n.slot].add(period));
+            break;
+        }
+        case FeatureOp::Std:
+        case FeatureOp::ZScore:
+        {
+            n.lead = true;
+            for (const Node &o : nodes_)
+            {
+                if ((o.op == FeatureOp::Std || o.op == FeatureOp::ZScore) && o.input == input && o.period == period)
+                {
+                    n.slot = o.slot;
+                    n.lead = false;
+                    break;
+                }
+            }
+            if (n.lead)
+            {
+                n.slot = static_cast<uint32_t>(moments_.size());
+                moments_.emplace_back(period);
+            }
+            break;
+        }
+        case FeatureOp::Sma:
+            n.slot = static_cast<uint32_t>(smas_.size());
+            smas_.emplace_back(period);
+            break;
+        case FeatureOp::Rsi:
+            n.slot = static_cast<uint32_t>(rsis_.size());
+            rsis_.emplace_back(period);
+            break;
+        case FeatureOp::Highest:
+            n.slot = static_cast<uint32_t>(highest_.size());
+            highest_.emplace_back(period);
+            break;
+        case FeatureOp::Lowest:
+            n.slot = static_cast<uint32_t>(lowest_.size());
+            lowest_.emplace_back(period);
+            break;
+        default:
+            break;
+        }
+        n.key = key;
+
+        const int id = static_cast<int>(nodes_.size());
+        nodes_.push_back(std::move(n));
+        values_.push_back(NAN);
+        by_key_.emplace(std::move(key), id);
+        return id;
+    }
+
+    void FeatureGraph::update(float open, float high, float low, float close, float volume)
+    {
+        float *v = values_.data();
+        const size_t count = nodes_.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Node &n = nodes_[i];
+            switch (n.op)
+            {
+            case FeatureOp::Open:
+                v[i] = open;
+                break;
+            case FeatureOp::High:
+                v[i] = high;
+                break;
+            case FeatureOp::Low:
+                v[i] = low;
+                break;
+            case FeatureOp::Close:
+                v[i] = close;
+                break;
+            case FeatureOp::Volume:
+                v[i] = volume;
+                break;
+
+            case FeatureOp::TrueRange:
+            {
+                // Same steps as ATRStream::update, so atr(n) matches it exactly.
+                float tr = high - low;
+                if (!std::isnan(prev_close_))
+                {
+                    const float tr2 = std::fabs(high - prev_close_);
+                    const float tr3 = std::fabs(low - prev_close_);
+                    if (tr2 > tr)
+                        tr = tr2;
+                    if (tr3 > tr)
+                        tr = tr3;
+                }
+                prev_close_ = close;
+                v[i] = tr;
+                break;
+            }
+            case FeatureOp::Typical:
+                v[i] = (high + low + close) / 3.0f;
+                break;
+            case FeatureOp::Median:
+                v[i] = (high + low) * 0.5f;
+                break;
+
+            case FeatureOp::Ema:
+            {
+                EmaBank &b = ema_banks_[n.slot];
+                if (n.lead && !std::isnan(v[n.input]))
+                    b.update(v[n.input]);
+                v[i] = b.value(n.lane);
+                break;
+            }
+            case FeatureOp::Wilder:
+            {
+                WilderBank &b = wilder_banks_[n.slot];
+                if (n.lead && !std::isnan(v[n.input]))
+                    b.update(v[n.input]);
+                v[i] = b.value(n.lane);
+                break;
+            }
+            case FeatureOp::Std:
+            case FeatureOp::ZScore:
+            {
+                RollingVarStream &m = moments_[n.slot];
+                const float x = v[n.input];
+                if (n.lead && !std::isnan(x))
+                    m.update(x);
+                if (n.op == FeatureOp::Std)
+                    v[i] = m.stddev();
+                else
+                    v[i] = std::isnan(x) ? NAN : m.zscore(x);
+                break;
+            }
+            case FeatureOp::Sma:
+            {
+                SMAStream &s = smas_[n.slot];
+                if (!std::isnan(v[n.input]))
+                    s.update(v[n.input]);
+                v[i] = s.value;
+                break;
+            }
+            case FeatureOp::Rsi:
+            {
+                RSIStream &s = rsis_[n.slot];
+                if (!std::isnan(v[n.input]))
+                    s.update(v[n.input]);
+                v[i] = s.value;
+                break;
+            }
+            case FeatureOp::Highest:
+            {
+                HighestStream &s = highest_[n.slot];
+                if (!std::isnan(v[n.input]))
+                    s.update(v[n.input]);
+                v[i] = s.value;
+                break;
+            }
+            case FeatureOp::Lowest:
+            {
+                LowestStream &s = lowest_[n.slot];
+                if (!std::isnan(v[n.input]))
+                    s.update(v[n.input]);
+                v[i] = s.value;
+                break;
+            }
+            }
+        }
+    }
+
+    void FeatureGraph::reset()
+    {
+        std::fill(values_.begin(), values_.end(), NAN);
+        for (auto &b : ema_banks_)
+            b.reset();
+        for (auto &b : wilder_banks_)
+            b.reset();
+        for (auto &m : moments_)
+            m.init(m.period);
+        for (auto &s : smas_)
+            s.init(s.period);
+        for (auto &s : rsis_)
+            s.init(s.period);
+        for (auto &s : highest_)
+            s.init(s.period);
+        for (auto &s : lowest_)
+            s.init(s.period);
+        prev_close_ = NAN;
+    }
+
+    void FeatureGraph::clear()
+    {
+        nodes_.clear();
+        by_key_.clear();
+        values_.clear();
+        ema_banks_.clear();
+        ema_bank_input_.clear();
+        wilder_banks_.clear();
+        wilder_bank_input_.clear();
+        moments_.clear();
+        smas_.clear();
+        rsis_.clear();
+        highest_.clear();
+        lowest_.clear();
+        prev_close_ = NAN;
+    }
+
+} // namespace features
@@ -0,0 +1,128 @@
+#pragma once
+#include "FeatureBank.h"
+#include "FeatureStreams.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace features
+{
+
+    // Per-bar feature ops. Inputs first: every other op reads the values of
+    // nodes added before it.
+    enum class FeatureOp : uint8_t
+    {
+        Open,
+        High,
+        Low,
+        Close,
+        Volume,
+        TrueRange, // max(high - low, |high - prev close|, |low - prev close|); high - low on the first bar
+        Typical,   // (high + low + close) / 3
+        Median,    // (high + low) / 2
+        Ema,       // EMAStream over the input (an EmaBank lane)
+        Wilder,    // ATRStream smoothing (mean of the first n, then Wilder) over the input (a WilderBank lane)
+        ZScore,    // (x - mean) / stddev over the last n inputs; 0 when flat
+        Sma,       // mean of the last n inputs
+        Std,       // population stddev of the last n inputs
+        Rsi,       // Wilder RSI, 0-100
+        Highest,   // max of the last n inputs
+        Lowest,    // min of the last n inputs
+    };
+
+    // Features described by specs and compiled into one graph:
+    //
+    //   close, open, high, low, volume, tr, typical, median
+    //   ema, sma, std, zscore, rsi (<expr>,n)   f(n) is f(close,n)
+    //   wilder(<expr>,n)                        atr(n) is wilder(tr,n)
+    //   highest(<expr>,n)                       hh(n) is highest(high,n)
+    //   lowest(<expr>,n)                        ll(n) is lowest(low,n)
+    //
+    // e.g. "ema(close,50)", "atr(14)", "zscore(ema(close,20),100)". Nodes are
+    // hash-consed on their canonical spec, so a spec asked for twice, or an
+    // input several features share (tr under every atr), is one node updated
+    // once per bar. Nodes are only ever appended after their inputs, so the
+    // node order is a topological order and update() is one pass over flat
+    // arrays. A node whose input is NaN (not warm yet) skips the bar and stays
+    // NaN until it has seen enough values.
+    //
+    // EMA and Wilder nodes over the same input share a bank (FeatureBank.h):
+    // the first node of a bank updates every period in it with SIMD, the
+    // others just read their lane. std and zscore nodes of the same input and
+    // period share one RollingVarStream. The rest run their FeatureStreams
+    // kernel, O(1) per bar. Periods must be below 2^24.
+    class FeatureGraph
+    {
+    public:
+        FeatureGraph() = default;
+
+        // Node id of spec, adding it and any missing inputs. Throws
+        // std::runtime_error for a malformed spec.
+        int add(const std::string &spec);
+
+        // Node id of spec, or -1 when it isn't in the graph (or malformed).
+        int find(const std::string &spec) const;
+
+        // Builders for code that composes nodes directly.
+        int input(FeatureOp op);
+        int ema(int input, int period);
+        int wilder(int input, int period);
+        int zscore(int input, int period);
+        // Any op that reads an input (Ema, Wilder, ZScore, Sma, ...).
+        int node(FeatureOp op, int input, int period);
+
+        void update(float open, float high, float low, float close, float volume);
+
+        // Current value of a node, NaN until warm. values() stays valid until
+        // the next add.
+        float value(int id) const { return values_[static_cast<size_t>(id)]; }
+        const float *values() const { return values_.data(); }
+
+        // Structure of a node, for evaluators that walk the graph themselves
+        // (node_input is -1 for inputs).
+        FeatureOp node_op(int id) const { return nodes_[static_cast<size_t>(id)].op; }
+        int node_input(int id) const { return nodes_[static_cast<size_t>(id)].input; }
+        int node_period(int id) const { return nodes_[static_cast<size_t>(id)].period; }
+
+        // Canonical spec of a node, e.g. atr(14) -> "wilder(tr,14)".
+        const std::string &spec(int id) const { return nodes_[static_cast<size_t>(id)].key; }
+        size_t size() const { return nodes_.size(); }
+
+        // Back to the state before the first update; the nodes stay.
+        void reset();
+        // Drops every node.
+        void clear();
+
+    private:
+        struct Node
+        {
+            FeatureOp op;
+            int input = -1;  // node read by every op but the inputs
+            int period = 0;
+            uint32_t slot = 0; // index into the op's state array (bank for Ema/Wilder)
+            uint32_t lane = 0; // bank lane
+            bool lead = false; // first node of its bank or shared stream: updates it
+            std::string key;
+        };
+
+        int intern(FeatureOp op, int input, int period);
+
+        std::vector<Node> nodes_;
+        std::unordered_map<std::string, int> by_key_;
+
+        std::vector<float> values_; // one per node
+        std::vector<EmaBank> ema_banks_;
+        std::vector<int> ema_bank_input_; // input node of each bank
+        std::vector<WilderBank> wilder_banks_;
+        std::vector<int> wilder_bank_input_;
+        std::vector<RollingVarStream> moments_; // std and zscore nodes
+        std::vector<SMAStream> smas_;
+        std::vector<RSIStream> rsis_;
+        std::vector<HighestStream> highest_;
+        std::vector<LowestStream> lowest_;
+        float prev_close_ = NAN; // for the TrueRange node (at most one)
+    };
+
+} // namespace features
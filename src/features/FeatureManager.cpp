@@ -3,59 +3,34 @@
 namespace features
 {
 
-    EMAHandle FeatureManager::require_ema(int period)
+    FeatureHandle FeatureManager::require(const std::string &spec)
     {
-        for (auto &s : emas_)
-        {
-            if (s.period == period)
-                return {period, &s};
-        }
-        emas_.emplace_back(period);
-        return {period, &emas_.back()};
+        return {graph_.add(spec)};
     }
 
-    ATRHandle FeatureManager::require_atr(int period)
+    FeatureHandle FeatureManager::require_ema(int period)
     {
-        for (auto &s : atrs_)
-        {
-            if (s.period == period)
-                return {period, &s};
-        }
-        atrs_.emplace_back(period);
-        return {period, &atrs_.back()};
+        return {graph_.ema(graph_.input(FeatureOp::Close), period)};
     }
 
-    void FeatureManager::update(float open, float high, float low, float close, float volume)
+    FeatureHandle FeatureManager::require_atr(int period)
     {
-        (void)open;
-        (void)volume;
-
-        for (auto &e : emas_)
-            e.update(close);
-        for (auto &a : atrs_)
-            a.update(high, low, close);
+        return {graph_.wilder(graph_.input(FeatureOp::TrueRange), period)};
     }
 
-    const EMAStream *FeatureManager::find_ema(int period) const
+    void FeatureManager::update(float open, float high, float low, float close, float volume)
     {
-        for (auto &s : emas_)
-            if (s.period == period)
-                return &s;
-        return nullptr;
+        graph_.update(open, high, low, close, volume);
     }
 
-    const ATRStream *FeatureManager::find_atr(int period) const
+    FeatureHandle FeatureManager::find(const std::string &spec) const
     {
-        for (auto &s : atrs_)
-            if (s.period == period)
-                return &s;
-        return nullptr;
+        return {graph_.find(spec)};
     }
 
     void FeatureManager::reset()
     {
-        emas_.clear();
-        atrs_.clear();
+        graph_.clear();
     }
 
 } // namespace features
@@ -0,0 +1,447 @@
+#include "FeaturePrecompute.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace features
+{
+
+    namespace
+    {
+        // Below this a chunk isn't worth a thread.
+        constexpr size_t MIN_CHUNK = size_t{1} << 16;
+
+        size_t chunk_count(size_t n, unsigned threads)
+        {
+            if (threads == 0)
+                threads = std::thread::hardware_concurrency();
+            if (threads == 0)
+                threads = 1;
+            return std::max<size_t>(1, std::min<size_t>(threads, n / MIN_CHUNK));
+        }
+
+        // Runs fn(k, begin, end) for chunks k of [begin, end), one thread each.
+        template <typename Fn>
+        void for_chunks(size_t begin, size_t end, size_t chunks, Fn fn)
+        {
+            const size_t n = end - begin;
+            auto bounds = [&](size_t k) { return begin + n * k / chunks; };
+            if (chunks <= 1)
+            {
+                fn(size_t{0}, begin, end);
+                return;
+            }
+            std::vector<std::thread> pool;
+            for (size_t k = 0; k < chunks; ++k)
+                pool.emplace_back([&, k]() { fn(k, bounds(k), bounds(k + 1)); });
+            for (auto &th : pool)
+                th.join();
+        }
+
+        size_t first_valid(const float *x, size_t n)
+        {
+            size_t i = 0;
+            while (i < n && std::isnan(x[i]))
+                ++i;
+            return i;
+        }
+
+        // out[start] = seed, then out[t] = a * out[t - 1] + b * x[t] for t in
+        // (start, n); a NaN x leaves the value unchanged, as the streams do.
+        void linear_scan(const float *x, size_t n, size_t start, double seed, double a, double b, float *out,
+                         unsigned threads)
+        {
+            out[start] = static_cast<float>(seed);
+            if (start + 1 >= n)
+                return;
+            const size_t chunks = chunk_count(n - start - 1, threads);
+
+            // 1. Each chunk as an affine map y_end = A * y_in + L.
+            std::vector<double> A(chunks, 1.0), L(chunks, 0.0);
+            auto reduce = [&](size_t k, size_t lo, size_t hi)
+            {
+                double y = 0.0;
+                size_t steps = 0;
+                for (size_t t = lo; t < hi; ++t)
+                {
+                    if (std::isnan(x[t]))
+                        continue;
+                    y = a * y + b * x[t];
+                    ++steps;
+                }
+                A[k] = std::pow(a, static_cast<double>(steps)); // a running product would go denormal
+                L[k] = y;
+            };
+            if (chunks > 1)
+                for_chunks(start + 1, n, chunks, reduce);
+
+            // 2. Chain the carries.
+            std::vector<double> carry_in(chunks);
+            double y = seed;
+            for (size_t k = 0; k < chunks; ++k)
+            {
+                carry_in[k] = y;
+                y = A[k] * y + L[k];
+            }
+
+            // 3. Rescan each chunk from its true start.
+            auto rescan = [&](size_t k, size_t lo, size_t hi)
+            {
+                double v = carry_in[k];
+                for (size_t t = lo; t < hi; ++t)
+                {
+                    if (!std::isnan(x[t]))
+                        v = a * v + b * x[t];
+                    out[t] = static_cast<float>(v);
+                }
+            };
+            for_chunks(start + 1, n, chunks, rescan);
+        }
+
+        void fill_nan(float *out, size_t n)
+        {
+            std::fill(out, out + n, NAN);
+        }
+
+        // First index with a full window of period values. Inputs are NaN only
+        // while warming up, so that is period - 1 values after the first valid
+        // one; out is NaN before it.
+        size_t first_window(const float *x, size_t n, int period, float *out)
+        {
+            const size_t first = first_valid(x, n) + static_cast<size_t>(period) - 1;
+            fill_nan(out, std::min(first, n));
+            return first;
+        }
+
+        // out[t] = fn(t, mean, variance) over the window ending at t. Each chunk
+        // starts from a two-pass sum of its first window, then slides it with
+        // Welford's update (as RollingVarStream does), recomputing once per lap.
+        template <typename Fn>
+        void rolling_moments(const float *x, size_t n, int period, float *out, unsigned threads, Fn fn)
+        {
+            const size_t first = first_window(x, n, period, out);
+            if (first >= n)
+                return;
+            const size_t p = static_cast<size_t>(period);
+            auto chunk = [&](size_t, size_t lo, size_t hi)
+            {
+                double mean = 0.0, m2 = 0.0;
+                size_t since_resum = p;
+                for (size_t t = lo; t < hi; ++t)
+                {
+                    if (since_resum >= p)
+                    {
+                        double sum = 0.0;
+                        for (size_t k = t + 1 - p; k <= t; ++k)
+                            sum += x[k];
+                        mean = sum / period;
+                        m2 = 0.0;
+                        for (size_t k = t + 1 - p; k <= t; ++k)
+                            m2 += (x[k] - mean) * (x[k] - mean);
+                        since_resum = 0;
+                    }
+                    else
+                    {
+                        const double in = x[t], old = x[t - p];
+                        const double old_mean = mean;
+                        mean += (in - old) / period;
+                        m2 += (in - old) * (in - mean + old - old_mean);
+                    }
+                    ++since_resum;
+                    out[t] = fn(t, mean, m2 > 0.0 ? m2 / period : 0.0);
+                }
+            };
+            for_chunks(first, n, chunk_count(n - first, threads), chunk);
+        }
+
+        // Max (Highest) or min of the window ending at t, from a monotonic
+        // deque of indices; each chunk first replays the window before it.
+        template <bool Highest>
+        void rolling_extreme(const float *x, size_t n, int period, float *out, unsigned threads)
+        {
+            const size_t first = first_window(x, n, period, out);
+            if (first >= n)
+                return;
+            const size_t p = static_cast<size_t>(period);
+            auto chunk = [&](size_t, size_t lo, size_t hi)
+            {
+                // dq[front, back) holds at most p indices; twice that room
+                // means a compaction moves them at most once per p pushes.
+                std::vector<size_t> dq(2 * p);
+                size_t front = 0, back = 0;
+                for (size_t t = lo + 1 - p; t < hi; ++t)
+                {
+                    if (front < back && dq[front] + p <= t)
+                        ++front;
+                    while (front < back && (Highest ? x[dq[back - 1]] <= x[t] : x[dq[back - 1]] >= x[t]))
+                        --back;
+                    if (back == dq.size())
+                    {
+                        std::copy(dq.data() + front, dq.data() + back, dq.data());
+                        back -= front;
+                        front = 0;
+                    }
+                    dq[back++] = t;
+                    if (t >= lo)
+                        out[t] = x[dq[front]];
+                }
+            };
+            for_chunks(first, n, chunk_count(n - first, threads), chunk);
+        }
+    }
+
+    void true_range_column(const float *high, const float *low, const float *close, size_t n, float *out,
+                           unsigned threads)
+    {
+        if (n == 0)
+            return;
+        out[0] = high[0] - low[0];
+        // Same comparisons as ATRStream::update, without branches.
+        auto chunk = [&](size_t, size_t lo, size_t hi)
+        {
+            for (size_t i = lo; i < hi; ++i)
+            {
+                const float pc = close[i - 1];
+                float tr = high[i] - low[i];
+                tr = std::max(tr, std::fabs(high[i] - pc));
+                tr = std::max(tr, std::fabs(low[i] - pc));
+                out[i] = tr;
+            }
+        };
+        for_chunks(1, n, chunk_count(n, threads), chunk);
+    }
+
+    void ema_column(const float *x, size_t n, int period, float *out, unsigned threads)
+    {
+        const size_t f = first_valid(x, n);
+        fill_nan(out, f);
+        if (f >= n)
+            return;
+        const double alpha = 2.0f / (period + 1.0f); // the stream's float alpha
+        linear_scan(x, n, f, x[f], 1.0 - alpha, alpha, out, threads);
+    }
+
+    void wilder_column(const float *x, size_t n, int period, float *out, unsigned threads)
+    {
+        // Warm on the mean of the first period values.
+        size_t t = first_valid(x, n);
+        double sum = 0.0;
+        int seen = 0;
+        for (; t < n; ++t)
+        {
+            if (std::isnan(x[t]))
+                continue;
+            sum += x[t];
+            if (++seen >= period)
+                break;
+        }
+        fill_nan(out, std::min(t, n));
+        if (t >= n)
+            return;
+        linear_scan(x, n, t, sum / period, (period - 1.0) / period, 1.0 / period, out, threads);
+    }
+
+    void zscore_column(const float *x, size_t n, int period, float *out, unsigned threads)
+    {
+        rolling_moments(x, n, period, out, threads,
+                        [&](size_t t, double mean, double var)
+                        {
+                            // Flat window: 0, as RollingVarStream::zscore.
+                            return var > 1e-12 * (var + mean * mean) ? static_cast<float>((x[t] - mean) / std::sqrt(var))
+                                                                     : 0.0f;
+                        });
+    }
+
+    void sma_column(const float *x, size_t n, int period, float *out, unsigned threads)
+    {
+        rolling_moments(x, n, period, out, threads,
+                        [](size_t, double mean, double) { return static_cast<float>(mean); });
+    }
+
+    void std_column(const float *x, size_t n, int period, float *out, unsigned threads)
+    {
+        rolling_moments(x, n, period, out, threads,
+                        [](size_t, double, double var) { return static_cast<float>(std::sqrt(var)); });
+    }
+
+    void rsi_column(const float *x, size_t n, int period, float *out, unsigned threads)
+    {
+        // Gains and losses are two Wilder scans; the first change is the one
+        // after the first valid value.
+        const size_t f = first_valid(x, n);
+        std::vector<float> gain(n, NAN), loss(n, NAN);
+        for (size_t t = f + 1; t < n; ++t)
+        {
+            const float change = x[t] - x[t - 1];
+            gain[t] = change > 0.0f ? change : 0.0f;
+            loss[t] = change < 0.0f ? -change : 0.0f;
+        }
+        std::vector<float> avg_gain(n), avg_loss(n);
+        wilder_column(gain.data(), n, period, avg_gain.data(), threads);
+        wilder_column(loss.data(), n, period, avg_loss.data(), threads);
+        for (size_t t = 0; t < n; ++t)
+        {
+            const double g = avg_gain[t], l = avg_loss[t];
+            const double total = g + l;
+            out[t] = std::isnan(total) ? NAN : total > 0.0 ? static_cast<float>(100.0 * g / total) : 50.0f;
+        }
+    }
+
+    void highest_column(const float *x, size_t n, int period, float *out, unsigned threads)
+    {
+        rolling_extreme<true>(x, n, period, out, threads);
+    }
+
+    void lowest_column(const float *x, size_t n, int period, float *out, unsigned threads)
+    {
+        rolling_extreme<false>(x, n, period, out, threads);
+    }
+
+    void precompute_columns(const FeatureGraph &graph, const FeatureInputs &bars, float *const *out, unsigned threads)
+    {
+        const size_t count = graph.size();
+        const size_t n = bars.n;
+        std::vector<std::vector<float>> scratch(count);
+        std::vector<const float *> col(count, nullptr);
+
+        auto dest = [&](size_t id) -> float *
+        {
+            if (out && out[id])
+                return out[id];
+            scratch[id].resize(n);
+            return scratch[id].data();
+        };
+        auto need = [](const float *p, const char *name)
+        {
+            if (!p)
+                throw std::runtime_error(std::string("Feature precompute needs the ") + name + " column");
+            return p;
+        };
+        auto input_column = [&](size_t id, const float *src)
+        {
+            if (out && out[id])
+            {
+                std::memcpy(out[id], src, n * sizeof(float));
+                col[id] = out[id];
+            }
+            else
+            {
+                col[id] = src;
+            }
+        };
+
+        for (size_t id = 0; id < count; ++id)
+        {
+            const int node = static_cast<int>(id);
+            const int period = graph.node_period(node);
+            const float *in = graph.node_input(node) >= 0 ? col[static_cast<size_t>(graph.node_input(node))] : nullptr;
+            switch (graph.node_op(node))
+            {
+            case FeatureOp::Open:
+                input_column(id, need(bars.open, "open"));
+                break;
+            case FeatureOp::High:
+                input_column(id, need(bars.high, "high"));
+                break;
+            case FeatureOp::Low:
+                input_column(id, need(bars.low, "low"));
+                break;
+            case FeatureOp::Close:
+                input_column(id, need(bars.close, "close"));
+                break;
+            case FeatureOp::Volume:
+                input_column(id, need(bars.volume, "volume"));
+                break;
+
+            case FeatureOp::TrueRange:
+            {
+                float *d = dest(id);
+                true_range_column(need(bars.high, "high"), need(bars.low, "low"), need(bars.close, "close"), n, d,
+                                  threads);
+                col[id] = d;
+                break;
+            }
+            case FeatureOp::Typical:
+            {
+                float *d = dest(id);
+                const float *h = need(bars.high, "high"), *l = need(bars.low, "low"), *c = need(bars.close, "close");
+                for (size_t i = 0; i < n; ++i)
+                    d[i] = (h[i] + l[i] + c[i]) / 3.0f;
+                col[id] = d;
+                break;
+            }
+            case FeatureOp::Median:
+            {
+                float *d = dest(id);
+                const float *h = need(bars.high, "high"), *l = need(bars.low, "low");
+                for (size_t i = 0; i < n; ++i)
+                    d[i] = (h[i] + l[i]) * 0.5f;
+                col[id] = d;
+                break;
+            }
+
+            case FeatureOp::Ema:
+            {
+                float *d = dest(id);
+                ema_column(in, n, period, d, threads);
+                col[id] = d;
+                break;
+            }
+            case FeatureOp::Wilder:
+            {
+                float *d = dest(id);
+                wilder_column(in, n, period, d, threads);
+                col[id] = d;
+                break;
+            }
+            case FeatureOp::ZScore:
+            {
+                float *d = dest(id);
+                zscore_column(in, n, period, d, threads);
+                col[id] = d;
+                break;
+            }
+            case FeatureOp::Sma:
+            {
+                float *d = dest(id);
+                sma_column(in, n, period, d, threads);
+                col[id] = d;
+                break;
+            }
+            case FeatureOp::Std:
+            {
+                float *d = dest(id);
+                std_column(in, n, period, d, threads);
+                col[id] = d;
+                break;
+            }
+            case FeatureOp::Rsi:
+            {
+                float *d = dest(id);
+                rsi_column(in, n, period, d, threads);
+                col[id] = d;
+                break;
+            }
+            case FeatureOp::Highest:
+            {
+                float *d = dest(id);
+                highest_column(in, n, period, d, threads);
+                col[id] = d;
+                break;
+            }
+            case FeatureOp::Lowest:
+            {
+                float *d = dest(id);
+                lowest_column(in, n, period, d, threads);
+                col[id] = d;
+                break;
+            }
+            }
+        }
+    }
+
+} // namespace features
@@ -0,0 +1,61 @@
+#pragma once
+#include "FeatureGraph.h"
+
+#include <cstddef>
+
+namespace features
+{
+
+    // Whole-history feature evaluation: every column of a FeatureGraph computed
+    // up front instead of one bar at a time inside the run loop.
+    //
+    // The recurrences (EMA: y = (1 - alpha) y + alpha x; Wilder: y = ((n - 1) y
+    // + x) / n) are split across cores as a parallel prefix: each chunk first
+    // reduces to its end value assuming a zero start, the carries are chained
+    // chunk to chunk, and each chunk is then rescanned from its true carry-in.
+    // Scans run in double and store float. RSI is two such scans, over the
+    // gains and the losses. True range and the other per-bar inputs are
+    // straight branch-free loops the compiler vectorises; the rolling-window
+    // ops (sma, std, zscore, highest, lowest) give each chunk its own window.
+    //
+    // Tolerance against the streams the graph runs (FeatureStreams.h): the
+    // float ones accumulate rounding and these don't, so the two differ by
+    // the streams' error, which grows with the period. EMA and Wilder values
+    // agree to a relative max(2e-6, 2e-8 * period): 2e-5 at 1000, 2e-4 at
+    // 10000 (measured up to 1.3e-4 there on a steady trend). True range,
+    // typical and median prices are identical, as are the NaN warmup
+    // positions, highest and lowest. sma and std agree to a relative 1e-6
+    // and rsi to 1e-5. A zscore magnifies its input's difference by
+    // 1/stddev: 1e-2 absolute over a smoothed input (measured 6e-3),
+    // identical over a raw one. tests/featureStreamsTest.cpp checks all of
+    // these.
+
+    struct FeatureInputs
+    {
+        const float *open = nullptr; // may be null when the graph has no open node
+        const float *high = nullptr;
+        const float *low = nullptr;
+        const float *close = nullptr;
+        const float *volume = nullptr; // may be null when the graph has no volume node
+        size_t n = 0;
+    };
+
+    // Column kernels. out has n entries; threads 0 means one per core.
+    void true_range_column(const float *high, const float *low, const float *close, size_t n, float *out,
+                           unsigned threads = 0);
+    void ema_column(const float *x, size_t n, int period, float *out, unsigned threads = 0);
+    void wilder_column(const float *x, size_t n, int period, float *out, unsigned threads = 0);
+    void zscore_column(const float *x, size_t n, int period, float *out, unsigned threads = 0);
+    void sma_column(const float *x, size_t n, int period, float *out, unsigned threads = 0);
+    void std_column(const float *x, size_t n, int period, float *out, unsigned threads = 0);
+    void rsi_column(const float *x, size_t n, int period, float *out, unsigned threads = 0);
+    void highest_column(const float *x, size_t n, int period, float *out, unsigned threads = 0);
+    void lowest_column(const float *x, size_t n, int period, float *out, unsigned threads = 0);
+
+    // Evaluates every node of graph over bars, in node (topological) order.
+    // out[id], when not null, receives node id's n values; the other
+    // columns are computed in scratch space as needed.
+    void precompute_columns(const FeatureGraph &graph, const FeatureInputs &bars, float *const *out,
+                            unsigned threads = 0);
+
+} // namespace features
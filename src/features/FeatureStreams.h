@@ -0,0 +1,381 @@
+#pragma once
+#include <cmath> // NAN, std::isnan, std::fabs, std::sqrt
+#include <cstdint>
+#include <vector>
+
+// Streaming indicator kernels: O(1) state, one update per bar. The rolling
+// ones keep the last period inputs in a ring and cost O(1) amortised.
+
+namespace features
+{
+
+    // ---------------------------
+    // EMA (exponential moving avg)
+    // ---------------------------
+    struct EMAStream
+    {
+        int period = 0;
+        float alpha = 0.0f;
+        float value = NAN;
+        bool ready = false;
+
+        EMAStream() = default;
+        explicit EMAStream(int p) { init(p); }
+
+        void init(int p)
+        {
+            period = p;
+            alpha = 2.0f / (p + 1.0f);
+            value = NAN;
+            ready = false;
+        }
+
+        inline void update(float x)
+        {
+            if (!ready)
+            {
+                value = x;
+                ready = true;
+            }
+            else
+            {
+                value += alpha * (x - value);
+            }
+        }
+    };
+
+    // ---------------------------
+    // ATR (Wilder)
+    // ---------------------------
+    struct ATRStream
+    {
+        int period = 0;
+        float value = NAN;
+        bool ready = false;
+
+        float prev_close = NAN;
+        float wilder = 0.0f;
+        int warm_count = 0;
+        float warm_sum = 0.0f;
+
+        ATRStream() = default;
+        explicit ATRStream(int p) { init(p); }
+
+        void init(int p)
+        {
+            period = p;
+            value = NAN;
+            ready = false;
+            prev_close = NAN;
+            wilder = 0.0f;
+            warm_count = 0;
+            warm_sum = 0.0f;
+        }
+
+        inline void update(float high, float low, float close)
+        {
+            float tr;
+            if (std::isnan(prev_close))
+            {
+                tr = high - low;
+                prev_close = close;
+            }
+            else
+            {
+                const float tr1 = high - low;
+                const float tr2 = std::fabs(high - prev_close);
+                const float tr3 = std::fabs(low - prev_close);
+                tr = tr1;
+                if (tr2 > tr)
+                    tr = tr2;
+                if (tr3 > tr)
+                    tr = tr3;
+                prev_close = close;
+            }
+            update_tr(tr);
+        }
+
+        // Wilder smoothing step alone, for a true range (or any input)
+        // computed elsewhere.
+        inline void update_tr(float tr)
+        {
+            if (!ready)
+            {
+                warm_sum += tr;
+                warm_count++;
+                if (warm_count >= period)
+                {
+                    wilder = warm_sum / (float)period;
+                    value = wilder;
+                    ready = true;
+                }
+                return;
+            }
+
+            wilder = (wilder * (period - 1) + tr) / (float)period;
+            value = wilder;
+        }
+    };
+
+    // ---------------------------
+    // SMA (rolling mean)
+    // ---------------------------
+    // Running sum of the window, resummed once per lap so add/subtract
+    // rounding can't build up.
+    struct SMAStream
+    {
+        int period = 0;
+        float value = NAN;
+        bool ready = false;
+
+        std::vector<float> window;
+        int count = 0; // values seen, capped at period
+        int head = 0;  // next slot to overwrite
+        double sum = 0.0;
+
+        SMAStream() = default;
+        explicit SMAStream(int p) { init(p); }
+
+        void init(int p)
+        {
+            period = p;
+            value = NAN;
+            ready = false;
+            window.assign(static_cast<size_t>(p), 0.0f);
+            count = 0;
+            head = 0;
+            sum = 0.0;
+        }
+
+        inline void update(float x)
+        {
+            if (count == period)
+                sum -= window[head];
+            else
+                ++count;
+            window[head] = x;
+            sum += x;
+            if (++head == period)
+            {
+                head = 0;
+                sum = 0.0;
+                for (float w : window)
+                    sum += w;
+            }
+            if (count == period)
+            {
+                value = static_cast<float>(sum / period);
+                ready = true;
+            }
+        }
+    };
+
+    // ---------------------------
+    // Rolling variance (Welford)
+    // ---------------------------
+    // Mean and population variance of the window: Welford's update for the
+    // value entering and the one leaving it, with mean and m2 recomputed in
+    // two passes once per lap. Backs the std and zscore features.
+    struct RollingVarStream
+    {
+        int period = 0;
+        bool ready = false;
+
+        std::vector<float> window;
+        int count = 0;
+        int head = 0;
+        double mean = 0.0;
+        double m2 = 0.0; // sum of squared deviations from mean
+
+        RollingVarStream() = default;
+        explicit RollingVarStream(int p) { init(p); }
+
+        void init(int p)
+        {
+            period = p;
+            ready = false;
+            window.assign(static_cast<size_t>(p), 0.0f);
+            count = 0;
+            head = 0;
+            mean = 0.0;
+            m2 = 0.0;
+        }
+
+        inline void update(float x)
+        {
+            if (count < period)
+            {
+                ++count;
+                const double d = x - mean;
+                mean += d / count;
+                m2 += d * (x - mean);
+            }
+            else
+            {
+                const double old = window[head];
+                const double old_mean = mean;
+                mean += (x - old) / period;
+                m2 += (x - old) * (x - mean + old - old_mean);
+            }
+            window[head] = x;
+            if (++head == period)
+            {
+                head = 0;
+                double sum = 0.0;
+                for (float w : window)
+                    sum += w;
+                mean = sum / period;
+                m2 = 0.0;
+                for (float w : window)
+                    m2 += (w - mean) * (w - mean);
+            }
+            ready = count == period;
+        }
+
+        double variance() const { return m2 > 0.0 ? m2 / period : 0.0; }
+
+        float stddev() const { return ready ? static_cast<float>(std::sqrt(variance())) : NAN; }
+
+        // (x - mean) / stddev; 0 for a flat window (stddev under 1e-6 of the RMS)
+        // rather than noise.
+        float zscore(float x) const
+        {
+            if (!ready)
+                return NAN;
+            const double var = variance();
+            return var > 1e-12 * (var + mean * mean) ? static_cast<float>((x - mean) / std::sqrt(var)) : 0.0f;
+        }
+    };
+
+    // ---------------------------
+    // RSI (Wilder)
+    // ---------------------------
+    // Gains and losses between consecutive inputs, each averaged like ATR:
+    // the mean of the first period, then Wilder smoothing. Ready after period
+    // changes (period + 1 inputs); 50 when nothing moved.
+    struct RSIStream
+    {
+        int period = 0;
+        float value = NAN;
+        bool ready = false;
+
+        float prev = NAN;
+        int warm_count = 0;
+        double avg_gain = 0.0; // sums while warming up
+        double avg_loss = 0.0;
+
+        RSIStream() = default;
+        explicit RSIStream(int p) { init(p); }
+
+        void init(int p)
+        {
+            period = p;
+            value = NAN;
+            ready = false;
+            prev = NAN;
+            warm_count = 0;
+            avg_gain = 0.0;
+            avg_loss = 0.0;
+        }
+
+        inline void update(float x)
+        {
+            if (std::isnan(prev))
+            {
+                prev = x;
+                return;
+            }
+            const float change = x - prev;
+            prev = x;
+            const double gain = change > 0.0f ? change : 0.0f;
+            const double loss = change < 0.0f ? -change : 0.0f;
+
+            if (!ready)
+            {
+                avg_gain += gain;
+                avg_loss += loss;
+                if (++warm_count < period)
+                    return;
+                avg_gain /= period;
+                avg_loss /= period;
+                ready = true;
+            }
+            else
+            {
+                avg_gain = (avg_gain * (period - 1) + gain) / period;
+                avg_loss = (avg_loss * (period - 1) + loss) / period;
+            }
+            const double total = avg_gain + avg_loss;
+            value = total > 0.0 ? static_cast<float>(100.0 * avg_gain / total) : 50.0f;
+        }
+    };
+
+    // ---------------------------
+    // Highest / lowest of the window
+    // ---------------------------
+    // Monotonic deque of (index, value) in a ring of period slots: values
+    // that can no longer be the extreme are dropped from the back, expired
+    // ones from the front, so each input is pushed and popped at most once.
+    template <bool Highest>
+    struct RollingExtremeStream
+    {
+        int period = 0;
+        float value = NAN;
+        bool ready = false;
+
+        std::vector<float> vals;
+        std::vector<int64_t> idx;
+        int front = 0;
+        int size = 0;
+        int64_t seen = 0;
+
+        RollingExtremeStream() = default;
+        explicit RollingExtremeStream(int p) { init(p); }
+
+        void init(int p)
+        {
+            period = p;
+            value = NAN;
+            ready = false;
+            vals.assign(static_cast<size_t>(p), 0.0f);
+            idx.assign(static_cast<size_t>(p), 0);
+            front = 0;
+            size = 0;
+            seen = 0;
+        }
+
+        inline void update(float x)
+        {
+            if (size > 0 && idx[front] <= seen - period)
+            {
+                if (++front == period)
+                    front = 0;
+                --size;
+            }
+            while (size > 0)
+            {
+                int back = front + size - 1;
+                if (back >= period)
+                    back -= period;
+                if (Highest ? vals[back] > x : vals[back] < x)
+                    break;
+                --size;
+            }
+            int slot = front + size;
+            if (slot >= period)
+                slot -= period;
+            vals[slot] = x;
+            idx[slot] = seen++;
+            ++size;
+            if (seen >= period)
+            {
+                value = vals[front];
+                ready = true;
+            }
+        }
+    };
+
+    using HighestStream = RollingExtremeStream<true>;
+    using LowestStream = RollingExtremeStream<false>;
+
+} // namespace features
@@ -0,0 +1,193 @@
+#include "MirroredRing.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <atomic>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace features
+{
+
+    namespace
+    {
+        // Granularity a copy of the ring must be a multiple of.
+        size_t granule_bytes()
+        {
+#ifdef _WIN32
+            SYSTEM_INFO si;
+            GetSystemInfo(&si);
+            return si.dwAllocationGranularity;
+#else
+            return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+        }
+
+#ifndef _WIN32
+        // Anonymous shared memory of bytes, or -1.
+        int shared_memory(size_t bytes)
+        {
+#ifdef __linux__
+            const int fd = ::memfd_create("feature_ring", MFD_CLOEXEC);
+#else
+            static std::atomic<unsigned> serial{0};
+            char name[64];
+            std::snprintf(name, sizeof(name), "/feature_ring_%ld_%u", static_cast<long>(::getpid()), serial++);
+            const int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd >= 0)
+                ::shm_unlink(name);
+#endif
+            if (fd >= 0 && ::ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+            {
+                ::close(fd);
+                return -1;
+            }
+            return fd;
+        }
+#endif
+    }
+
+    size_t MirroredRing::min_window(size_t span)
+    {
+        const size_t granule = granule_bytes();
+        size_t window = 1;
+        while (window * sizeof(float) < granule || window * MAX_COPIES < span)
+            window <<= 1;
+        return window;
+    }
+
+    bool MirroredRing::open(size_t window, size_t span)
+    {
+        close();
+        if (window == 0 || (window & (window - 1)) != 0 || window < min_window(span))
+            return false;
+        const size_t ring_bytes = window * sizeof(float);
+        const size_t copies = std::max<size_t>(1, (span + window - 1) / window);
+
+#ifdef _WIN32
+#ifdef MEM_RESERVE_PLACEHOLDER
+        // Placeholders need Windows 10 1803; older systems don't export these.
+        using FnVirtualAlloc2 = PVOID(WINAPI *)(HANDLE, PVOID, SIZE_T, ULONG, ULONG, MEM_EXTENDED_PARAMETER *, ULONG);
+        using FnMapViewOfFile3 = PVOID(WINAPI *)(HANDLE, HANDLE, PVOID, ULONG64, SIZE_T, ULONG, ULONG,
+                                                 MEM_EXTENDED_PARAMETER *, ULONG);
+        const HMODULE kernel = GetModuleHandleW(L"kernelbase.dll");
+        const auto virtual_alloc2 =
+            kernel ? reinterpret_cast<FnVirtualAlloc2>(GetProcAddress(kernel, "VirtualAlloc2")) : nullptr;
+        const auto map_view3 =
+            kernel ? reinterpret_cast<FnMapViewOfFile3>(GetProcAddress(kernel, "MapViewOfFile3")) : nullptr;
+        if (!virtual_alloc2 || !map_view3)
+            return false;
+
+        const uint64_t section_bytes = ring_bytes;
+        HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                            static_cast<DWORD>(section_bytes >> 32),
+                                            static_cast<DWORD>(section_bytes), nullptr);
+        if (!section)
+            return false;
+        auto *base = static_cast<char *>(virtual_alloc2(nullptr, nullptr, copies * ring_bytes,
+                                                        MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS,
+                                                        nullptr, 0));
+        if (!base)
+        {
+            CloseHandle(section);
+            return false;
+        }
+
+        // Split one copy off the front of the placeholder, then map over it.
+        size_t mapped = 0;
+        bool split = true;
+        for (; mapped < copies; ++mapped)
+        {
+            char *at = base + mapped * ring_bytes;
+            if (mapped + 1 < copies && !VirtualFree(at, ring_bytes, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER))
+            {
+                split = false;
+                break;
+            }
+            if (!map_view3(section, GetCurrentProcess(), at, 0, ring_bytes, MEM_REPLACE_PLACEHOLDER,
+                           PAGE_READWRITE, nullptr, 0))
+                break;
+        }
+        if (mapped < copies)
+        {
+            for (size_t k = 0; k < mapped; ++k)
+                UnmapViewOfFile(base + k * ring_bytes);
+            char *rest = base + mapped * ring_bytes;
+            VirtualFree(rest, 0, MEM_RELEASE);
+            if (split && mapped + 1 < copies)
+                VirtualFree(rest + ring_bytes, 0, MEM_RELEASE);
+            CloseHandle(section);
+            return false;
+        }
+        section_ = section;
+        data_ = reinterpret_cast<float *>(base);
+#else
+        (void)ring_bytes;
+        (void)copies;
+        return false;
+#endif
+#else
+        const int fd = shared_memory(ring_bytes);
+        if (fd < 0)
+            return false;
+        void *reserved = ::mmap(nullptr, copies * ring_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+        {
+            ::close(fd);
+            return false;
+        }
+        auto *base = static_cast<char *>(reserved);
+        bool ok = true;
+        for (size_t k = 0; k < copies && ok; ++k)
+            ok = ::mmap(base + k * ring_bytes, ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) !=
+                 MAP_FAILED;
+        ::close(fd); // the mappings keep the memory
+        if (!ok)
+        {
+            ::munmap(base, copies * ring_bytes);
+            return false;
+        }
+        data_ = reinterpret_cast<float *>(base);
+#endif
+        window_ = window;
+        copies_ = copies;
+        return true;
+    }
+
+    void MirroredRing::close()
+    {
+        if (!data_)
+            return;
+        const size_t ring_bytes = window_ * sizeof(float);
+#ifdef _WIN32
+        for (size_t k = 0; k < copies_; ++k)
+            UnmapViewOfFile(reinterpret_cast<char *>(data_) + k * ring_bytes);
+        CloseHandle(section_);
+        section_ = nullptr;
+#else
+        ::munmap(data_, copies_ * ring_bytes);
+#endif
+        data_ = nullptr;
+        window_ = 0;
+        copies_ = 0;
+    }
+
+    void MirroredRing::swap(MirroredRing &other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(window_, other.window_);
+        std::swap(copies_, other.copies_);
+#ifdef _WIN32
+        std::swap(section_, other.section_);
+#endif
+    }
+
+} // namespace features
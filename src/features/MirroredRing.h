@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+
+namespace features
+{
+
+    // A ring of window floats whose pages are mapped again and again across
+    // an address range of span floats, so data()[i] for every i < span is
+    // ring slot i & (window - 1): the physical memory is one window, the
+    // addresses cover the whole run. A column written at slot bar & (window -
+    // 1) can then be read as data()[bar] for the last window bars.
+    //
+    // Linux maps a memfd (other POSIX systems a shm object) over a reserved
+    // range; Windows maps a section over placeholders (VirtualAlloc2 /
+    // MapViewOfFile3, Windows 10 1803 and later). Each copy of the ring is one
+    // mapping, so min_window() keeps their number bounded.
+    class MirroredRing
+    {
+    public:
+        MirroredRing() = default;
+        ~MirroredRing() { close(); }
+
+        MirroredRing(const MirroredRing &) = delete;
+        MirroredRing &operator=(const MirroredRing &) = delete;
+
+        MirroredRing(MirroredRing &&other) noexcept { swap(other); }
+        MirroredRing &operator=(MirroredRing &&other) noexcept
+        {
+            if (this != &other)
+            {
+                close();
+                swap(other);
+            }
+            return *this;
+        }
+
+        // Smallest window (a power of two) that fills whole pages (allocation
+        // granules on Windows) and needs at most MAX_COPIES copies for span.
+        static size_t min_window(size_t span);
+        static constexpr size_t MAX_COPIES = 1024;
+
+        // Maps a zeroed ring of window floats (a power of two, at least
+        // min_window(span)) over span floats. False when the system can't
+        // mirror memory or a mapping fails; the ring stays closed.
+        bool open(size_t window, size_t span);
+        void close();
+
+        float *data() const { return data_; }
+        size_t window() const { return window_; }
+        bool is_open() const { return data_ != nullptr; }
+
+        void swap(MirroredRing &other) noexcept;
+
+    private:
+        float *data_ = nullptr;
+        size_t window_ = 0;
+        size_t copies_ = 0;
+#ifdef _WIN32
+        void *section_ = nullptr;
+#endif
+    };
+
+} // namespace features
@@ -16,6 +16,7 @@ void MetricsEngine::reset()
     bars_in_equity_dd_ = 0;
     bars_in_balance_dd_ = 0;
 
+    day_clock_ = datahandler::DayClock(cfg_.day_boundary);
     current_day_key_ = -1;
     day_start_equity_ = NAN;
     day_start_balance_ = NAN;
@@ -107,7 +108,7 @@ void MetricsEngine::on_bar(int64_t ts, float balance, float equity, float unreal
     float trades_per_day = NAN;
     if (first_ts_ != 0 && last_ts_ > first_ts_)
     {
-        const double days = (double)(last_ts_ - first_ts_) / (1000.0 * 60.0 * 60.0 * 24.0);
+        const double days = (double)(last_ts_ - first_ts_) / (double)datahandler::NS_PER_DAY;
         if (days > 0.0)
             trades_per_day = (float)((double)total_trades_ / days);
     }
@@ -155,7 +156,7 @@ void MetricsEngine::on_bar(int64_t ts, float balance, float equity, float unreal
     {
         // approximate annualized return from bar frequency
         const double total_ret = (equity / series_.equity.front()) - 1.0;
-        const double years = ((double)(last_ts_ - first_ts_)) / (1000.0 * 60.0 * 60.0 * 24.0 * 365.0);
+        const double years = ((double)(last_ts_ - first_ts_)) / ((double)datahandler::NS_PER_DAY * 365.0);
         if (years > 0.0 && !std::isnan(series_.max_equity_dd.back()))
         {
             const double ann = std::pow(1.0 + total_ret, 1.0 / years) - 1.0;
@@ -263,7 +264,7 @@ void MetricsEngine::update_drawdown(float equity, float balance)
 
 void MetricsEngine::update_daily_dd(int64_t ts, float equity, float balance)
 {
-    const int day = ts;
+    const int day = day_clock_.ymd(static_cast<uint64_t>(ts));
     if (day != current_day_key_)
     {
         current_day_key_ = day;
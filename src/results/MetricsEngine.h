@@ -1,6 +1,7 @@
 #pragma once
 #include "RunSeries.h"
 #include "TradeLog.h"
+#include "data/DateUtils.hpp"
 #include <vector>
 #include <cstdint>
 #include <cmath>
@@ -10,12 +11,13 @@ struct MetricsConfig
 {
     float initial_equity = 100000.0f;
     int annualization_bars = 252 * 24 * 60; // M1 default; change per timeframe
+    datahandler::DayBoundary day_boundary = datahandler::DayBoundary::NewYork1700; // daily DD rollover (FX: 17:00 New York)
 };
 
 class MetricsEngine
 {
 public:
-    explicit MetricsEngine(MetricsConfig cfg) : cfg_(cfg) {}
+    explicit MetricsEngine(MetricsConfig cfg) : cfg_(cfg), day_clock_(cfg.day_boundary) {}
 
     void reset();
     void reserve(size_t bars, size_t trades_guess = 0);
@@ -62,6 +64,7 @@ private:
     int bars_in_balance_dd_ = 0;
 
     // Daily DD tracking
+    datahandler::DayClock day_clock_; // ts -> trading day, cached per day
     int current_day_key_ = -1; // YYYYMMDD
     float day_start_equity_ = NAN;
     float day_start_balance_ = NAN;
@@ -2,7 +2,9 @@
 // Build this as a DLL and load it with your PluginLoader.
 //
 // Behavior:
-// - Requests EMA(period) via ctx->get_feature()
+// - Binds EMA(period) once in on_start via ctx->require_feature() and reads
+//   the column directly each bar; on an engine whose EngineCtx predates
+//   require_feature (ENGINE_CTX_HAS) it uses ctx->get_feature() instead
 // - When close crosses above EMA -> go long (close existing short first)
 // - When close crosses below EMA -> go short (close existing long first)
 // - Uses fixed lots from params (default 0.10)
@@ -56,6 +58,8 @@ struct StratState
     int ema_period = 50;
     float lots = 0.10f;
 
+    const float *ema_col = nullptr; // bound EMA column, indexed by bar.index
+
     float prev_close = NAN;
     float prev_ema = NAN;
     bool started = false;
@@ -84,7 +88,14 @@ extern "C"
     STRAT_API void strategy_on_start(StrategyHandle h, EngineCtx *ctx)
     {
         auto *s = (StratState *)h;
-        (void)ctx;
+
+        s->ema_col = nullptr;
+        if (ENGINE_CTX_HAS(ctx, feature_data))
+        {
+            const int ema = ctx->require_feature(ctx, FEAT_EMA, s->ema_period);
+            if (ema >= 0)
+                s->ema_col = ctx->feature_data(ctx, ema);
+        }
 
         s->prev_close = NAN;
         s->prev_ema = NAN;
@@ -100,11 +111,18 @@ extern "C"
         const size_t i = ctx->bar.index;
         const float close = ctx->bar.close;
 
-        FeatureRef ema = ctx->get_feature(ctx, FEAT_EMA, s->ema_period);
-        if (!ema.data || i >= ema.len)
-            return;
-
-        const float ema_now = ema.data[i];
+        float ema_now;
+        if (s->ema_col)
+        {
+            ema_now = s->ema_col[i];
+        }
+        else
+        {
+            FeatureRef ema = ctx->get_feature(ctx, FEAT_EMA, s->ema_period);
+            if (!ema.data || i >= ema.len)
+                return;
+            ema_now = ema.data[i];
+        }
         if (std::isnan(ema_now))
             return;
 
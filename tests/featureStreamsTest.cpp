@@ -0,0 +1,364 @@
+// tests/featureStreamsTest.cpp
+// Checks the rolling feature streams (SMA, stddev/z-score, RSI, highest/lowest)
+// against an O(period) recompute of every window, on random, flat and trending
+// inputs, several periods and series several laps of the ring long. Then
+// checks the same features served to plugins through get_feature, with and
+// without a lookback (ring columns, still read by bar), and the
+// whole-history columns of precompute_columns against FeatureGraph::update
+// within the tolerances FeaturePrecompute.h states.
+//
+// Usage: featureStreamsTest      (exit code 0 when everything matches)
+
+#include "core/EngineCtxBridge.h"
+#include "features/FeatureManager.h"
+#include "features/FeaturePrecompute.h"
+#include "features/FeatureStreams.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace features;
+
+namespace
+{
+    int failures = 0;
+
+    struct Series
+    {
+        std::string name;
+        std::vector<float> high, low, close;
+    };
+
+    // Brute-force references, NaN until the first full window.
+    struct Reference
+    {
+        std::vector<double> sma, stddev, zscore, rsi, highest, lowest;
+    };
+
+    Series make_series(const std::string &name, size_t n, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> noise(0.0f, 1e-4f);
+        Series s;
+        s.name = name;
+        s.high.resize(n);
+        s.low.resize(n);
+        s.close.resize(n);
+        float p = 1.1f;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const float open = p;
+            if (name == "random")
+            {
+                p += noise(rng);
+                if (i % 1000 < 5)
+                    p = std::round(p * 1e4f) / 1e4f; // repeated closes: ties in the extremes
+            }
+            else if (name == "trending")
+            {
+                p = 1.1f + 2e-6f * static_cast<float>(i) + 0.1f * noise(rng);
+            }
+            s.close[i] = p;
+            s.high[i] = std::max(open, p) + (name == "flat" ? 0.0f : static_cast<float>(i % 7) * 1e-5f);
+            s.low[i] = std::min(open, p) - (name == "flat" ? 0.0f : static_cast<float>(i % 5) * 1e-5f);
+        }
+        return s;
+    }
+
+    Reference brute_force(const Series &s, int period)
+    {
+        const size_t n = s.close.size();
+        const size_t p = static_cast<size_t>(period);
+        Reference r;
+        r.sma.assign(n, NAN);
+        r.stddev.assign(n, NAN);
+        r.zscore.assign(n, NAN);
+        r.rsi.assign(n, NAN);
+        r.highest.assign(n, NAN);
+        r.lowest.assign(n, NAN);
+
+        for (size_t i = p - 1; i < n; ++i)
+        {
+            double sum = 0.0;
+            float hi = s.high[i], lo = s.low[i];
+            for (size_t k = i + 1 - p; k <= i; ++k)
+            {
+                sum += s.close[k];
+                hi = std::max(hi, s.high[k]);
+                lo = std::min(lo, s.low[k]);
+            }
+            const double mean = sum / period;
+            double m2 = 0.0;
+            for (size_t k = i + 1 - p; k <= i; ++k)
+                m2 += (s.close[k] - mean) * (s.close[k] - mean);
+            const double var = m2 / period;
+            r.sma[i] = mean;
+            r.stddev[i] = std::sqrt(var);
+            r.zscore[i] = var > 1e-12 * (var + mean * mean) ? (s.close[i] - mean) / std::sqrt(var) : 0.0;
+            r.highest[i] = hi;
+            r.lowest[i] = lo;
+        }
+
+        // Wilder: the mean of the first period changes, then smoothed.
+        double gain = 0.0, loss = 0.0;
+        for (size_t i = 1; i < n; ++i)
+        {
+            const float change = s.close[i] - s.close[i - 1];
+            const double g = change > 0.0f ? change : 0.0;
+            const double l = change < 0.0f ? -change : 0.0;
+            if (i <= p)
+            {
+                gain += g;
+                loss += l;
+                if (i < p)
+                    continue;
+                gain /= period;
+                loss /= period;
+            }
+            else
+            {
+                gain = (gain * (period - 1) + g) / period;
+                loss = (loss * (period - 1) + l) / period;
+            }
+            r.rsi[i] = gain + loss > 0.0 ? 100.0 * gain / (gain + loss) : 50.0;
+        }
+        return r;
+    }
+
+    // got within tol of ref, relative to max(1, |ref|); NaN must match NaN.
+    void check(const std::string &what, size_t i, double got, double ref, double tol)
+    {
+        const bool ok = std::isnan(got) || std::isnan(ref)
+                            ? std::isnan(got) == std::isnan(ref)
+                            : std::fabs(got - ref) <= tol * std::max(1.0, std::fabs(ref));
+        if (!ok && failures++ < 20)
+            std::printf("FAIL %s bar %zu: got %.9g, expected %.9g\n", what.c_str(), i, got, ref);
+    }
+
+    // Relative to |ref| alone, for values far below 1 (stddev, true range).
+    void check_rel(const std::string &what, size_t i, double got, double ref, double tol)
+    {
+        const bool ok = std::isnan(got) || std::isnan(ref)
+                            ? std::isnan(got) == std::isnan(ref)
+                            : std::fabs(got - ref) <= tol * std::fabs(ref);
+        if (!ok && failures++ < 20)
+            std::printf("FAIL %s bar %zu: got %.9g, expected %.9g\n", what.c_str(), i, got, ref);
+    }
+
+    void test_streams(const Series &s, int period)
+    {
+        const Reference r = brute_force(s, period);
+        const std::string tag = s.name + " period " + std::to_string(period) + " ";
+
+        SMAStream sma(period);
+        RollingVarStream var(period);
+        RSIStream rsi(period);
+        HighestStream highest(period);
+        LowestStream lowest(period);
+        for (size_t i = 0; i < s.close.size(); ++i)
+        {
+            const float x = s.close[i];
+            sma.update(x);
+            var.update(x);
+            rsi.update(x);
+            highest.update(s.high[i]);
+            lowest.update(s.low[i]);
+
+            check(tag + "sma", i, sma.value, r.sma[i], 1e-6);
+            check(tag + "stddev", i, var.stddev(), r.stddev[i], 1e-6);
+            check(tag + "zscore", i, var.zscore(x), r.zscore[i], 1e-3);
+            check(tag + "rsi", i, rsi.value, r.rsi[i], 1e-5);
+            check(tag + "highest", i, highest.value, r.highest[i], 0.0);
+            check(tag + "lowest", i, lowest.value, r.lowest[i], 0.0);
+        }
+    }
+
+    // The columns a legacy plugin reads through get_feature; with a lookback,
+    // only the last window bars, which must still be data[bar].
+    void test_get_feature(const Series &s, int period, int lookback = 0)
+    {
+        const Reference r = brute_force(s, period);
+        const std::string tag = s.name + " period " + std::to_string(period) + " get_feature " +
+                                (lookback ? "lookback " + std::to_string(lookback) + " " : "");
+        const size_t n = s.close.size();
+
+        FeatureManager fm;
+        EngineUserState user;
+        user.feats = &fm;
+        user.feature_capacity = n;
+        EngineCtx ctx{};
+        init_engine_ctx(ctx, user);
+
+        const struct
+        {
+            int type;
+            const char *name;
+            const std::vector<double> &ref;
+            double tol;
+        } cases[] = {
+            {FEAT_RSI, "rsi", r.rsi, 1e-5},
+            {FEAT_SMA, "sma", r.sma, 1e-6},
+            {FEAT_STD, "std", r.stddev, 1e-6},
+            {FEAT_ZSCORE, "zscore", r.zscore, 1e-3},
+            {FEAT_HH, "hh", r.highest, 0.0},
+            {FEAT_LL, "ll", r.lowest, 0.0},
+        };
+        for (const auto &c : cases)
+        {
+            if (bind_feature(user, c.type, period) < 0 && failures++ < 20)
+                std::printf("FAIL %s%s: not bound\n", tag.c_str(), c.name);
+        }
+        size_t first = 0;
+        if (lookback)
+        {
+            const int window = set_feature_lookback(user, lookback);
+            if (window < lookback)
+            {
+                if (failures++ < 20)
+                    std::printf("FAIL %slookback refused (%d)\n", tag.c_str(), window);
+                return;
+            }
+            first = n > static_cast<size_t>(window) ? n - static_cast<size_t>(window) : 0;
+        }
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            fm.update(s.close[i], s.high[i], s.low[i], s.close[i], 0.0f);
+            record_features(user);
+        }
+
+        for (const auto &c : cases)
+        {
+            const FeatureRef f = ctx.get_feature(&ctx, c.type, period);
+            if (!f.data || f.len != n)
+            {
+                if (failures++ < 20)
+                    std::printf("FAIL %s%s: column of %zu bars, expected %zu\n", tag.c_str(), c.name, f.len, n);
+                continue;
+            }
+            for (size_t i = first; i < n; ++i)
+                check(tag + c.name, i, f.data[i], c.ref[i], c.tol);
+
+            // The ring view reads the same memory.
+            const FeatureRing ring = ctx.feature_ring(&ctx, bind_feature(user, c.type, period));
+            if (ring.base != f.data && failures++ < 20)
+                std::printf("FAIL %s%s: feature_ring and get_feature differ\n", tag.c_str(), c.name);
+        }
+    }
+
+    // precompute_columns against the graph's own per-bar update.
+    void test_precompute(const Series &s)
+    {
+        enum Bound
+        {
+            Exact,
+            Recurrence, // ema, wilder: relative max(2e-6, 2e-8 * period)
+            Relative,
+            Absolute,
+        };
+        struct Case
+        {
+            std::string spec;
+            Bound bound;
+            double tol;
+            int period;
+        };
+        std::vector<Case> cases = {
+            {"tr", Exact, 0.0, 0},
+            {"typical", Exact, 0.0, 0},
+            {"median", Exact, 0.0, 0},
+            {"atr(14)", Recurrence, 0.0, 14},
+            {"zscore(ema(close,20),100)", Absolute, 1e-2, 0},
+            {"zscore(atr(14),50)", Absolute, 1e-2, 0},
+        };
+        for (int p : {1, 2, 14, 50, 257, 1000, 10000})
+        {
+            const std::string arg = "(close," + std::to_string(p) + ")";
+            cases.push_back({"ema" + arg, Recurrence, 0.0, p});
+            cases.push_back({"wilder" + arg, Recurrence, 0.0, p});
+            cases.push_back({"sma" + arg, Relative, 1e-6, p});
+            cases.push_back({"std" + arg, Relative, 1e-6, p});
+            cases.push_back({"rsi" + arg, Relative, 1e-5, p});
+            cases.push_back({"zscore" + arg, Exact, 0.0, p});
+            cases.push_back({"highest" + arg, Exact, 0.0, p});
+            cases.push_back({"lowest" + arg, Exact, 0.0, p});
+        }
+
+        FeatureGraph graph;
+        std::vector<int> ids;
+        for (const Case &c : cases)
+            ids.push_back(graph.add(c.spec));
+
+        const size_t n = s.close.size();
+        std::vector<std::vector<float>> columns(graph.size(), std::vector<float>(n));
+        std::vector<float *> out(graph.size());
+        for (size_t k = 0; k < out.size(); ++k)
+            out[k] = columns[k].data();
+        FeatureInputs bars;
+        bars.high = s.high.data();
+        bars.low = s.low.data();
+        bars.close = s.close.data();
+        bars.n = n;
+        precompute_columns(graph, bars, out.data());
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            graph.update(s.close[i], s.high[i], s.low[i], s.close[i], 0.0f);
+            for (size_t k = 0; k < cases.size(); ++k)
+            {
+                const Case &c = cases[k];
+                const std::string tag = s.name + " precompute " + c.spec;
+                const float got = columns[static_cast<size_t>(ids[k])][i];
+                const float ref = graph.value(ids[k]);
+                switch (c.bound)
+                {
+                case Exact:
+                    check_rel(tag, i, got, ref, 0.0);
+                    break;
+                case Recurrence:
+                    check_rel(tag, i, got, ref, std::max(2e-6, 2e-8 * c.period));
+                    break;
+                case Relative:
+                    check_rel(tag, i, got, ref, c.tol);
+                    break;
+                case Absolute:
+                    check(tag, i, got, ref, c.tol);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    const int periods[] = {1, 2, 3, 14, 50, 257};
+    const size_t n = 8 * 257 + 123; // several laps of the largest ring, ending mid-lap
+
+    for (const char *name : {"random", "flat", "trending"})
+    {
+        const Series s = make_series(name, n, 7);
+        for (int p : periods)
+        {
+            test_streams(s, p);
+            test_get_feature(s, p);
+            test_get_feature(s, p, 2 * p);
+        }
+    }
+
+    // Long enough for ten windows of the largest period.
+    for (const char *name : {"random", "flat", "trending"})
+        test_precompute(make_series(name, 100000, 11));
+
+    if (failures > 0)
+    {
+        std::printf("%d mismatches\n", failures);
+        return 1;
+    }
+    std::printf("All feature streams match the brute-force recompute and the precomputed columns\n");
+    return 0;
+}
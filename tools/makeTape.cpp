@@ -0,0 +1,373 @@
+// tools/makeTape.cpp
+// Native replacement for tools/makeTape.py: converts DAT_MT M1 CSV files into
+// daily TAPEv001 tapes + IDXv001 sidecars (byte-identical to the Python output)
+// and refreshes the symbol catalog.
+//
+// Usage: makeTape [options] <csv>...
+//   --base <dir>        tape tree root (BASE_DIR/bars/SYMBOL/1m/YYYY/...)   [required]
+//   --symbol <name>     symbol name                                          [EURUSD]
+//   --stride <n>        .idx entry stride                                    [720]
+//   --threads <n>       worker threads, one CSV at a time each                [all cores]
+//   --utc               interpret CSV times as UTC (default: the local time zone,
+//                       like makeTape.py's naive datetime.timestamp(), so both
+//                       tools stamp the same tree the same way)
+//   --rebuild           rewrite every day (default: skip days whose tape already
+//                       exists with the same record count)
+//   --crc               store CRC32C block checksums in each tape (the output is
+//                       then no longer byte-identical to the Python tool's)
+//
+// CSV rows look like: 2000.05.30,17:27,0.930200,0.930300,0.930100,0.930200,0
+// Files are memory-mapped and parsed in place; the only per-day state is a
+// reused record buffer.
+
+#include "data/MMapFile.hpp"
+#include "data/DateUtils.hpp"
+#include "data/TapeCatalog.hpp"
+#include "data/TapeChecksum.hpp"
+#include "data/TapeTypes.hpp"
+#include "data/TapeWriter.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace datahandler;
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    struct Options
+    {
+        std::string base_dir;
+        std::string symbol = "EURUSD";
+        std::string timeframe = "1m";
+        uint32_t stride = 720;
+        unsigned threads = 0;
+        bool local_time = true;
+        bool rebuild = false;
+        bool checksums = false;
+        std::vector<std::string> csvs;
+    };
+
+    struct FileStats
+    {
+        uint64_t lines = 0;
+        uint64_t days_written = 0;
+        uint64_t days_skipped = 0;
+    };
+
+    [[noreturn]] void parse_fail(const std::string &csv, uint64_t line_no, const char *what)
+    {
+        throw std::runtime_error(csv + ":" + std::to_string(line_no) + ": " + what);
+    }
+
+    // Fixed-width unsigned decimal; false on a non-digit.
+    inline bool digits(const char *p, int n, int &out)
+    {
+        int v = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            const unsigned c = static_cast<unsigned>(p[i] - '0');
+            if (c > 9)
+                return false;
+            v = v * 10 + static_cast<int>(c);
+        }
+        out = v;
+        return true;
+    }
+
+    // Parses one number up to the next ',' (or end). Advances p past the separator.
+    inline bool field(const char *&p, const char *end, double &out)
+    {
+        auto r = std::from_chars(p, end, out);
+        if (r.ec != std::errc())
+            return false;
+        p = r.ptr;
+        if (p < end && *p == ',')
+            ++p;
+        return true;
+    }
+
+    // CSV time -> epoch seconds. Local times are UTC plus the zone's offset,
+    // which only changes on a quarter hour (DST and zone changes, including
+    // half-hour ones), so mktime runs once per quarter hour of data instead of
+    // once per line: glibc takes a process-wide lock in it, which serialises
+    // the worker threads.
+    class EpochClock
+    {
+    public:
+        explicit EpochClock(bool local_time) : local_time_(local_time) {}
+
+        int64_t seconds(int y, int mo, int d, int hh, int mm)
+        {
+            const int quarter = mm / 15 * 15;
+            const int64_t utc_quarter = days_from_civil(y, mo, d) * 86400 + hh * 3600 + quarter * 60;
+            if (local_time_)
+            {
+                const int64_t key = ((static_cast<int64_t>(y) * 10000 + mo * 100 + d) * 100 + hh) * 100 + quarter;
+                if (key != offset_key_)
+                {
+                    std::tm tm{};
+                    tm.tm_year = y - 1900;
+                    tm.tm_mon = mo - 1;
+                    tm.tm_mday = d;
+                    tm.tm_hour = hh;
+                    tm.tm_min = quarter;
+                    tm.tm_isdst = -1;
+                    offset_ = static_cast<int64_t>(std::mktime(&tm)) - utc_quarter;
+                    offset_key_ = key;
+                }
+                return utc_quarter + offset_ + (mm - quarter) * 60;
+            }
+            return utc_quarter + (mm - quarter) * 60;
+        }
+
+    private:
+        bool local_time_;
+        int64_t offset_key_ = -1; // YYYYMMDDHHMM of the quarter hour the offset is for
+        int64_t offset_ = 0;
+    };
+
+    class DayFlusher
+    {
+    public:
+        DayFlusher(const Options &opt, FileStats &stats) : opt_(opt), stats_(stats), writer_(opt.stride)
+        {
+            if (opt.checksums)
+                writer_.set_checksum_block(TAPE_CRC_BLOCK);
+        }
+
+        void flush(int ymd, const std::vector<Bar1m> &recs)
+        {
+            if (recs.empty())
+                return;
+
+            const std::string path = make_tape_path(opt_.base_dir, opt_.symbol, opt_.timeframe, ymd);
+            if (!opt_.rebuild && same_count_on_disk(path, recs.size()))
+            {
+                stats_.days_skipped++;
+                return;
+            }
+
+            const int year = ymd / 10000;
+            if (year != last_year_)
+            {
+                fs::create_directories(fs::path(path).parent_path());
+                last_year_ = year;
+            }
+
+            writer_.write_day(path, recs.data(), recs.size());
+            stats_.days_written++;
+        }
+
+    private:
+        static bool same_count_on_disk(const std::string &path, size_t n)
+        {
+            std::FILE *f = std::fopen(path.c_str(), "rb");
+            if (!f)
+                return false;
+            TapeHeader hdr{};
+            const bool ok = std::fread(&hdr, sizeof(hdr), 1, f) == 1;
+            std::fclose(f);
+            return ok && std::memcmp(hdr.magic, "TAPEv001", 8) == 0 && hdr.record_count == n;
+        }
+
+        const Options &opt_;
+        FileStats &stats_;
+        TapeWriter writer_;
+        int last_year_ = 0;
+    };
+
+    FileStats build_file(const Options &opt, const std::string &csv)
+    {
+        FileStats stats;
+
+        MMapFile map;
+        map.open_readonly(csv, MapPolicy{true, true, false, false});
+        const char *p = static_cast<const char *>(map.data());
+        const char *const end = p + map.size();
+
+        DayFlusher flusher(opt, stats);
+        EpochClock clock(opt.local_time);
+        std::vector<Bar1m> day;
+        day.reserve(1440);
+        int current_ymd = 0;
+
+        while (p < end)
+        {
+            const char *eol = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!eol)
+                eol = end;
+            const char *line_end = eol;
+            if (line_end > p && line_end[-1] == '\r')
+                --line_end;
+
+            const char *q = p;
+            p = (eol < end) ? eol + 1 : end;
+            if (q == line_end)
+                continue;
+            ++stats.lines;
+
+            // YYYY.MM.DD,HH:MM,
+            int y, mo, d, hh, mm;
+            if (line_end - q < 17 ||
+                !digits(q, 4, y) || q[4] != '.' ||
+                !digits(q + 5, 2, mo) || q[7] != '.' ||
+                !digits(q + 8, 2, d) || q[10] != ',' ||
+                !digits(q + 11, 2, hh) || q[13] != ':' ||
+                !digits(q + 14, 2, mm) || q[16] != ',')
+                parse_fail(csv, stats.lines, "bad date/time");
+            q += 17;
+
+            double o, h, l, c, v;
+            if (!field(q, line_end, o) || !field(q, line_end, h) || !field(q, line_end, l) ||
+                !field(q, line_end, c) || !field(q, line_end, v))
+                parse_fail(csv, stats.lines, "bad price/volume");
+
+            const int ymd = y * 10000 + mo * 100 + d;
+            if (ymd != current_ymd)
+            {
+                flusher.flush(current_ymd, day);
+                day.clear();
+                current_ymd = ymd;
+            }
+
+            Bar1m rec;
+            rec.ts_ns = static_cast<uint64_t>(clock.seconds(y, mo, d, hh, mm)) * 1000000000ull;
+            rec.open = o;
+            rec.high = h;
+            rec.low = l;
+            rec.close = c;
+            rec.volume = static_cast<float>(v);
+            day.push_back(rec);
+        }
+        flusher.flush(current_ymd, day);
+        return stats;
+    }
+
+    int usage()
+    {
+        std::fprintf(stderr,
+                     "Usage: makeTape --base <dir> [--symbol EURUSD] [--stride 720] [--threads N]\n"
+                     "                [--utc] [--rebuild] [--crc] <csv>...\n");
+        return 2;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string a = argv[i];
+        auto next = [&]() -> const char * { return (i + 1 < argc) ? argv[++i] : nullptr; };
+
+        if (a == "--base")
+        {
+            const char *v = next();
+            if (!v) return usage();
+            opt.base_dir = v;
+        }
+        else if (a == "--symbol")
+        {
+            const char *v = next();
+            if (!v) return usage();
+            opt.symbol = v;
+        }
+        else if (a == "--stride")
+        {
+            const char *v = next();
+            if (!v) return usage();
+            opt.stride = static_cast<uint32_t>(std::atoi(v));
+        }
+        else if (a == "--threads")
+        {
+            const char *v = next();
+            if (!v) return usage();
+            opt.threads = static_cast<unsigned>(std::atoi(v));
+        }
+        else if (a == "--utc")
+            opt.local_time = false;
+        else if (a == "--rebuild")
+            opt.rebuild = true;
+        else if (a == "--crc")
+            opt.checksums = true;
+        else if (!a.empty() && a[0] == '-')
+            return usage();
+        else
+            opt.csvs.push_back(a);
+    }
+    if (opt.base_dir.empty() || opt.csvs.empty())
+        return usage();
+
+    unsigned threads = opt.threads ? opt.threads : std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+    if (threads > opt.csvs.size())
+        threads = static_cast<unsigned>(opt.csvs.size());
+
+    std::atomic<size_t> next_file{0};
+    std::atomic<bool> failed{false};
+    std::mutex io_mu;
+
+    auto worker = [&]()
+    {
+        for (;;)
+        {
+            const size_t k = next_file.fetch_add(1);
+            if (k >= opt.csvs.size() || failed.load())
+                return;
+            const std::string &csv = opt.csvs[k];
+            try
+            {
+                const FileStats st = build_file(opt, csv);
+                std::lock_guard<std::mutex> lock(io_mu);
+                std::printf("%s: %llu bars, %llu days written, %llu unchanged\n", csv.c_str(),
+                            (unsigned long long)st.lines, (unsigned long long)st.days_written,
+                            (unsigned long long)st.days_skipped);
+            }
+            catch (const std::exception &e)
+            {
+                failed.store(true);
+                std::lock_guard<std::mutex> lock(io_mu);
+                std::fprintf(stderr, "Error: %s\n", e.what());
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t)
+        pool.emplace_back(worker);
+    for (auto &th : pool)
+        th.join();
+
+    if (failed.load())
+        return 1;
+
+    try
+    {
+        const std::string cat_path = make_catalog_path(opt.base_dir, opt.symbol, opt.timeframe);
+        TapeCatalog cat;
+        cat.load(cat_path);
+        const size_t changed = cat.update(opt.base_dir, opt.symbol, opt.timeframe);
+        cat.save(cat_path);
+        std::printf("Catalog: %zu days (%zu changed)\n", cat.entries().size(), changed);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -1,4 +1,6 @@
 #!/usr/bin/env python3
+# Reference implementation of the tape layout. The makeTape C++ target
+# (tools/makeTape.cpp) produces byte-identical output and is what builds the tree.
 import os
 import struct
 import argparse
@@ -48,7 +50,9 @@ def write_day(day, records, outdir, symbol, stride):
     index_entries = []
     next_index_at = 0
 
-    with open(tape_path, "wb") as tf:
+    # Written to temp files and renamed over the old ones, so replacing a day
+    # touches its year directory's write time, which the catalog checks.
+    with open(tape_path + ".tmp", "wb") as tf:
         tf.write(b"\x00" * TAPE_HDR_SIZE)
 
         start_ts = records[0][0]
@@ -77,12 +81,15 @@ def write_day(day, records, outdir, symbol, stride):
         tf.seek(0)
         tf.write(header)
 
-    with open(idx_path, "wb") as ix:
+    with open(idx_path + ".tmp", "wb") as ix:
         ix.write(struct.pack(IDX_HDR_FMT, IDX_MAGIC,
                  1, stride, len(index_entries), 0))
         for ts, off in index_entries:
             ix.write(struct.pack(IDX_ENTRY_FMT, ts, off))
 
+    os.replace(tape_path + ".tmp", tape_path)
+    os.replace(idx_path + ".tmp", idx_path)
+
     print(f"Wrote {day}: {len(records)} bars")
 
 
@@ -0,0 +1,718 @@
+// tools/tapetool.cpp
+// Maintenance commands for a tape tree.
+//
+// Usage: tapetool <command> [args...]
+//
+//   catalog <base_dir> <symbol> <timeframe>
+//       Build or incrementally update SYMBOL_TIMEFRAME.catalog. Always rescans,
+//       so it also picks up tapes another tool overwrote in place.
+//   convert <base_dir> <symbol> <timeframe> rows|columns|packed [start_ymd end_ymd]
+//       Rewrite tapes in place as version 1 rows, version 2 aligned columns or
+//       version 3 bit-packed blocks (days that can't be packed exactly stay rows).
+//       Days inside a container are skipped; unpack them first.
+//   pack <base_dir> <symbol> <timeframe> [start_year end_year]
+//       Move each year's daily tapes into YYYY/SYMBOL_YYYY.tapepack (merging with
+//       an existing container) and delete the daily tapes and their sidecars.
+//   unpack <base_dir> <symbol> <timeframe> [start_year end_year [stride]]
+//       Restore daily tapes from the containers byte-for-byte and delete them.
+//       pack doesn't keep the .idx sidecars, so they are regenerated with
+//       stride records between entries (default 720, makeTape's default; 0
+//       writes none, as for resample and eventbars caches).
+//   resample <base_dir> <symbol> <timeframe> [start_ymd end_ymd [origin_minutes|ny]]
+//       Build <timeframe> bars from the 1m tapes and cache them as tapes, so
+//       ResampleReader reads them directly from then on. "ny" in place of the
+//       origin cuts one-day bars at 17:00 New York (cached as "D@NY").
+//   eventbars <base_dir> <symbol> <spec> [start_ymd end_ymd [ticks|bars]]
+//       Build range/renko/tick-count/volume bars (spec "range:0.0010",
+//       "renko:0.0005", "ticks:500", "volume:1e6") and cache them as tapes, so
+//       EventBarReader reads them directly from then on.
+//   checksum <base_dir> <symbol> <timeframe> [start_ymd end_ymd]
+//       Add CRC32C checksums to daily tapes that don't have them yet (in place;
+//       days inside a container are skipped). convert and unpack keep checksums.
+//   verify <base_dir> <symbol> <timeframe> [start_ymd end_ymd]
+//       Check every block and file checksum in the range, containers included.
+//       Exits with status 1 if any day fails.
+//   calendar <base_dir> <symbol> <timeframe>
+//       Build (or refresh after the catalog changed) SYMBOL_TIMEFRAME.calendar,
+//       the slot grid TapeReader::seek and bar/time lookups use.
+//   query <base_dir> <symbol> <timeframe> [--days] [--from ymd] [--to ymd]
+//         [--threads n] [--limit n] <field> <op> <value> [<field> <op> <value> ...]
+//       Print the bars (or with --days, the days) where every term holds.
+//       field: open high low close volume range; op: gt ge lt le (or > >= < <=),
+//       xabove xbelow (crosses). Builds SYMBOL_TIMEFRAME.zonemap on first use.
+
+#include "data/CalendarIndex.hpp"
+#include "data/Crc32c.hpp"
+#include "data/TapeCatalog.hpp"
+#include "data/TapeChecksum.hpp"
+#include "data/TapePack.hpp"
+#include "data/TapeQuery.hpp"
+#include "data/ResampleReader.hpp"
+#include "data/TapeReader.hpp"
+#include "data/TapeWriter.hpp"
+#include "data/DateUtils.hpp"
+#include "data/EventBarReader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace datahandler;
+
+static int usage()
+{
+    std::fprintf(stderr,
+                 "Usage: tapetool <command> [args...]\n"
+                 "  catalog <base_dir> <symbol> <timeframe>\n"
+                 "  convert <base_dir> <symbol> <timeframe> rows|columns|packed [start_ymd end_ymd]\n"
+                 "  pack <base_dir> <symbol> <timeframe> [start_year end_year]\n"
+                 "  unpack <base_dir> <symbol> <timeframe> [start_year end_year [stride]]\n"
+                 "  resample <base_dir> <symbol> <timeframe> [start_ymd end_ymd [origin_minutes|ny]]\n"
+                 "  eventbars <base_dir> <symbol> <spec> [start_ymd end_ymd [ticks|bars]]\n"
+                 "  checksum <base_dir> <symbol> <timeframe> [start_ymd end_ymd]\n"
+                 "  verify <base_dir> <symbol> <timeframe> [start_ymd end_ymd]\n"
+                 "  calendar <base_dir> <symbol> <timeframe>\n"
+                 "  query <base_dir> <symbol> <timeframe> [--days] [--from ymd] [--to ymd] [--threads n] [--limit n]\n"
+                 "        <field> <op> <value> ...   (fields open high low close volume range;\n"
+                 "        ops gt ge lt le xabove xbelow)\n");
+    return 2;
+}
+
+static int cmd_catalog(int argc, char **argv)
+{
+    if (argc < 5)
+        return usage();
+
+    const std::string base_dir = argv[2];
+    const std::string symbol = argv[3];
+    const std::string timeframe = argv[4];
+    const std::string path = make_catalog_path(base_dir, symbol, timeframe);
+
+    TapeCatalog cat;
+    const bool existed = cat.load(path);
+    const size_t changed = cat.update(base_dir, symbol, timeframe);
+    cat.save(path); // even unchanged days come with a new directory stamp
+
+    uint64_t bars = 0;
+    for (const auto &e : cat.entries())
+        bars += e.record_count;
+
+    std::printf("%s: %zu days, %llu bars, %zu changed%s\n",
+                path.c_str(), cat.entries().size(), (unsigned long long)bars, changed,
+                existed ? "" : " (new catalog)");
+    return 0;
+}
+
+// Reads one day (any layout) into rows.
+static void read_day(const std::string &base_dir, const std::string &symbol,
+                     const std::string &timeframe, int ymd, std::vector<Bar1m> &out)
+{
+    out.clear();
+    TapeReader reader(base_dir, symbol, timeframe, ymd, ymd);
+    reader.set_use_catalog(false);
+    reader.set_read_ahead(false);
+    BarBatch batch;
+    while (reader.nextBatch(batch))
+        out.insert(out.end(), batch.begin(), batch.end());
+}
+
+// Checksum block size of a tape (0 when it has no checksums).
+static uint32_t checksum_block_of(const uint8_t *tape)
+{
+    TapeHeader hdr{};
+    std::memcpy(&hdr, tape, sizeof(hdr));
+    return hdr.crc_block_size;
+}
+
+static uint32_t checksum_block_of(const std::string &tape_path)
+{
+    uint8_t hdr[sizeof(TapeHeader)] = {};
+    if (std::FILE *f = std::fopen(tape_path.c_str(), "rb"))
+    {
+        const bool ok = std::fread(hdr, sizeof(hdr), 1, f) == 1;
+        std::fclose(f);
+        if (ok)
+            return checksum_block_of(hdr);
+    }
+    return 0;
+}
+
+static void refresh_catalog(const std::string &base_dir, const std::string &symbol, const std::string &timeframe)
+{
+    const std::string path = make_catalog_path(base_dir, symbol, timeframe);
+    TapeCatalog cat;
+    cat.load(path);
+    cat.update(base_dir, symbol, timeframe);
+    cat.save(path);
+}
+
+static int cmd_convert(int argc, char **argv)
+{
+    if (argc < 6)
+        return usage();
+
+    const std::string base_dir = argv[2];
+    const std::string symbol = argv[3];
+    const std::string timeframe = argv[4];
+    const std::string mode = argv[5];
+    const int start_ymd = (argc > 6) ? std::atoi(argv[6]) : 0;
+    const int end_ymd = (argc > 7) ? std::atoi(argv[7]) : 99991231;
+
+    TapeLayout layout;
+    uint32_t want_type;
+    if (mode == "rows")
+    {
+        layout = TapeLayout::Rows;
+        want_type = RECORD_BAR_1M;
+    }
+    else if (mode == "columns")
+    {
+        layout = TapeLayout::Columns;
+        want_type = RECORD_BAR_1M_COLUMNAR;
+    }
+    else if (mode == "packed")
+    {
+        layout = TapeLayout::Packed;
+        want_type = RECORD_BAR_1M_PACKED;
+    }
+    else
+        return usage();
+
+    auto cat = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
+    TapeWriter writer(720, layout);
+    std::vector<Bar1m> rows;
+    size_t converted = 0, skipped = 0, in_pack = 0;
+    uint64_t bytes_before = 0, bytes_after = 0;
+
+    for (const auto &e : cat->range(start_ymd, end_ymd))
+    {
+        if (e.pack_offset != 0)
+        {
+            ++in_pack;
+            continue;
+        }
+        if (e.record_type == want_type)
+        {
+            ++skipped;
+            continue;
+        }
+        // Fully read (and unmap) the day before overwriting it.
+        const std::string path = make_tape_path(base_dir, symbol, timeframe, e.ymd);
+        read_day(base_dir, symbol, timeframe, e.ymd, rows);
+        if (rows.empty())
+            continue;
+        writer.set_checksum_block(checksum_block_of(path));
+        writer.write_day(path, rows.data(), rows.size());
+        ++converted;
+    }
+
+    refresh_catalog(base_dir, symbol, timeframe);
+    auto after = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
+    size_t fallback = 0;
+    for (const auto &e : after->range(start_ymd, end_ymd))
+    {
+        if (e.pack_offset != 0)
+            continue;
+        bytes_after += e.file_bytes;
+        if (e.record_type != want_type)
+            ++fallback;
+    }
+    for (const auto &e : cat->range(start_ymd, end_ymd))
+        if (e.pack_offset == 0)
+            bytes_before += e.file_bytes;
+
+    std::printf("Converted %zu days to %s (%zu already %s), %llu -> %llu bytes\n", converted, mode.c_str(),
+                skipped, mode.c_str(), (unsigned long long)bytes_before, (unsigned long long)bytes_after);
+    if (in_pack > 0)
+        std::printf("%zu days are inside containers and were left alone (unpack first)\n", in_pack);
+    if (fallback > 0)
+        std::printf("%zu days could not be stored as %s and were written as rows\n", fallback, mode.c_str());
+    return 0;
+}
+
+static std::vector<uint8_t> read_file(const std::string &path)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        throw std::runtime_error("Cannot open " + path);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static int cmd_pack(int argc, char **argv)
+{
+    if (argc < 5)
+        return usage();
+
+    const std::string base_dir = argv[2];
+    const std::string symbol = argv[3];
+    const std::string timeframe = argv[4];
+    const int start_year = (argc > 5) ? std::atoi(argv[5]) : 0;
+    const int end_year = (argc > 6) ? std::atoi(argv[6]) : 9999;
+
+    auto cat = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
+    std::map<int, std::vector<int>> standalone; // year -> days stored as their own files
+    for (const auto &e : cat->range(start_year * 10000, end_year * 10000 + 1231))
+        if (e.pack_offset == 0)
+            standalone[e.ymd / 10000].push_back(e.ymd);
+
+    size_t days = 0;
+    for (const auto &[year, ymds] : standalone)
+    {
+        const std::string pack_path = make_pack_path(base_dir, symbol, timeframe, year);
+        TapePackWriter writer;
+        for (int ymd : ymds)
+        {
+            const std::vector<uint8_t> tape = read_file(make_tape_path(base_dir, symbol, timeframe, ymd));
+            writer.add_day(ymd, tape.data(), tape.size());
+        }
+        {
+            // Keep days that are already packed (a standalone tape replaces its packed copy).
+            TapePack old;
+            if (old.open(pack_path))
+                for (const auto &d : old.days())
+                    if (!std::binary_search(ymds.begin(), ymds.end(), d.ymd))
+                        writer.add_day(d.ymd, old.day_data(d), static_cast<size_t>(d.bytes));
+        }
+        writer.write(pack_path);
+
+        for (int ymd : ymds)
+        {
+            std::filesystem::remove(make_tape_path(base_dir, symbol, timeframe, ymd));
+            std::filesystem::remove(make_index_path(base_dir, symbol, timeframe, ymd));
+        }
+        std::printf("%s: %zu days\n", pack_path.c_str(), writer.day_count());
+        days += ymds.size();
+    }
+
+    refresh_catalog(base_dir, symbol, timeframe);
+    std::printf("Packed %zu daily tapes into %zu containers\n", days, standalone.size());
+    return 0;
+}
+
+static int cmd_unpack(int argc, char **argv)
+{
+    if (argc < 5)
+        return usage();
+
+    const std::string base_dir = argv[2];
+    const std::string symbol = argv[3];
+    const std::string timeframe = argv[4];
+    const int start_year = (argc > 5) ? std::atoi(argv[5]) : 0;
+    const int end_year = (argc > 6) ? std::atoi(argv[6]) : 9999;
+    const uint32_t stride = (argc > 7) ? static_cast<uint32_t>(std::atoi(argv[7])) : 720;
+
+    auto cat = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
+    std::map<int, std::vector<CatalogEntry>> packed;
+    for (const auto &e : cat->range(start_year * 10000, end_year * 10000 + 1231))
+        if (e.pack_offset != 0)
+            packed[e.ymd / 10000].push_back(e);
+
+    // Each tape comes back byte-for-byte (checksums included); only its .idx
+    // sidecar, which pack drops, is regenerated, with the given stride.
+    TapeWriter writer(stride);
+    size_t days = 0;
+    for (const auto &[year, entries] : packed)
+    {
+        TapePack pack;
+        if (!pack.open(make_pack_path(base_dir, symbol, timeframe, year)))
+            continue;
+        for (const auto &e : entries)
+        {
+            const PackDayEntry *d = pack.find(e.ymd);
+            if (!d)
+                continue;
+            writer.copy_day(make_tape_path(base_dir, symbol, timeframe, e.ymd), pack.day_data(*d),
+                            static_cast<size_t>(d->bytes));
+            ++days;
+        }
+        pack.close();
+        std::filesystem::remove(make_pack_path(base_dir, symbol, timeframe, year));
+    }
+
+    refresh_catalog(base_dir, symbol, timeframe);
+    std::printf("Unpacked %zu days from %zu containers\n", days, packed.size());
+    return 0;
+}
+
+static int cmd_resample(int argc, char **argv)
+{
+    if (argc < 5)
+        return usage();
+
+    const std::string base_dir = argv[2];
+    const std::string symbol = argv[3];
+    const std::string timeframe = argv[4];
+    const int start_ymd = (argc > 5) ? std::atoi(argv[5]) : 0;
+    const int end_ymd = (argc > 6) ? std::atoi(argv[6]) : 99991231;
+    // "ny" cuts one-day bars at 17:00 New York (the FX session) instead.
+    const bool ny = argc > 7 && std::strcmp(argv[7], "ny") == 0;
+    const int origin = (argc > 7 && !ny) ? std::atoi(argv[7]) : 0;
+    const DayBoundary boundary = ny ? DayBoundary::NewYork1700 : DayBoundary::UtcMidnight;
+
+    if (timeframe_minutes(timeframe) <= 1)
+    {
+        std::fprintf(stderr, "Timeframe must be a multiple of 1m above 1m: %s\n", timeframe.c_str());
+        return 2;
+    }
+
+    ResampleReader reader(base_dir, symbol, timeframe, start_ymd, end_ymd);
+    reader.set_origin_minutes(origin);
+    reader.set_day_boundary(boundary);
+    const size_t days = write_timeframe_cache(base_dir, symbol, timeframe, start_ymd, end_ymd, origin,
+                                              TapeLayout::Rows, boundary);
+    std::printf("Wrote %zu days of %s bars to %s\n", days, timeframe.c_str(), reader.cache_timeframe().c_str());
+    return 0;
+}
+
+static int cmd_eventbars(int argc, char **argv)
+{
+    if (argc < 5)
+        return usage();
+
+    const std::string base_dir = argv[2];
+    const std::string symbol = argv[3];
+    const int start_ymd = (argc > 5) ? std::atoi(argv[5]) : 0;
+    const int end_ymd = (argc > 6) ? std::atoi(argv[6]) : 99991231;
+
+    EventBarSpec spec;
+    if (!parse_event_bar_spec(argv[4], spec))
+    {
+        std::fprintf(stderr, "Bad event bar spec: %s\n", argv[4]);
+        return 2;
+    }
+    EventSource source = EventSource::Auto;
+    if (argc > 7)
+    {
+        if (std::strcmp(argv[7], "ticks") == 0)
+            source = EventSource::Ticks;
+        else if (std::strcmp(argv[7], "bars") == 0)
+            source = EventSource::Bars;
+        else
+            return usage();
+    }
+
+    const size_t days = write_event_bar_cache(base_dir, symbol, spec, start_ymd, end_ymd, source);
+    std::printf("Wrote %zu days of %s bars\n", days, event_timeframe_name(spec).c_str());
+    return 0;
+}
+
+static int cmd_checksum(int argc, char **argv)
+{
+    if (argc < 5)
+        return usage();
+
+    const std::string base_dir = argv[2];
+    const std::string symbol = argv[3];
+    const std::string timeframe = argv[4];
+    const int start_ymd = (argc > 5) ? std::atoi(argv[5]) : 0;
+    const int end_ymd = (argc > 6) ? std::atoi(argv[6]) : 99991231;
+
+    auto cat = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
+    size_t added = 0, skipped = 0, in_pack = 0;
+    for (const auto &e : cat->range(start_ymd, end_ymd))
+    {
+        if (e.pack_offset != 0)
+        {
+            ++in_pack;
+            continue;
+        }
+        const std::string path = make_tape_path(base_dir, symbol, timeframe, e.ymd);
+        std::vector<uint8_t> tape = read_file(path);
+        if (tape.size() <= sizeof(TapeHeader) || checksum_block_of(tape.data()) != 0)
+        {
+            ++skipped;
+            continue;
+        }
+        add_tape_checksums(tape);
+
+        // Replaced by rename, so the catalog sees the year directory change.
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            f.write(reinterpret_cast<const char *>(tape.data()), static_cast<std::streamsize>(tape.size()));
+            if (!f.flush())
+                throw std::runtime_error("Write failed: " + tmp);
+        }
+        std::filesystem::rename(tmp, path);
+        ++added;
+    }
+
+    refresh_catalog(base_dir, symbol, timeframe);
+    std::printf("Added checksums to %zu days (%zu already had them)\n", added, skipped);
+    if (in_pack > 0)
+        std::printf("%zu days are inside containers and were left alone (unpack first)\n", in_pack);
+    return 0;
+}
+
+static int cmd_verify(int argc, char **argv)
+{
+    if (argc < 5)
+        return usage();
+
+    const std::string base_dir = argv[2];
+    const std::string symbol = argv[3];
+    const std::string timeframe = argv[4];
+    const int start_ymd = (argc > 5) ? std::atoi(argv[5]) : 0;
+    const int end_ymd = (argc > 6) ? std::atoi(argv[6]) : 99991231;
+
+    auto cat = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
+    // Every byte is read: fault the pages in up front so the loop runs at memory speed.
+    const MapPolicy policy{true, false, true, false};
+    MMapFile map;
+    TapePack pack;
+    int pack_year = 0;
+    size_t ok = 0, unchecked = 0, bad = 0;
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+
+    for (const auto &e : cat->range(start_ymd, end_ymd))
+    {
+        const uint8_t *tape = nullptr;
+        size_t size = 0;
+        if (e.pack_offset == 0)
+        {
+            map.open_readonly(make_tape_path(base_dir, symbol, timeframe, e.ymd), policy);
+            tape = static_cast<const uint8_t *>(map.data());
+            size = map.size();
+        }
+        else
+        {
+            if (pack_year != e.ymd / 10000)
+            {
+                pack_year = e.ymd / 10000;
+                pack.open(make_pack_path(base_dir, symbol, timeframe, pack_year), policy);
+            }
+            const PackDayEntry *d = pack.is_open() ? pack.find(e.ymd) : nullptr;
+            if (!d)
+                throw std::runtime_error("Day missing from tape container: " + std::to_string(e.ymd));
+            tape = pack.day_data(*d);
+            size = static_cast<size_t>(d->bytes);
+        }
+
+        const auto t0 = std::chrono::steady_clock::now();
+        std::string problem;
+        try
+        {
+            TapeChecksums crc;
+            if (!crc.bind(tape, size))
+            {
+                ++unchecked;
+                continue;
+            }
+            const size_t b = crc.check_all();
+            if (b == crc.block_count())
+                problem = "file checksum mismatch";
+            else if (b != TapeChecksums::ALL_OK)
+                problem = "block " + std::to_string(b) + " of " + std::to_string(crc.block_count()) + " mismatch";
+            bytes += crc.payload_end();
+        }
+        catch (const std::exception &ex)
+        {
+            problem = ex.what();
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        if (problem.empty())
+        {
+            ++ok;
+        }
+        else
+        {
+            ++bad;
+            std::printf("%d: %s\n", e.ymd, problem.c_str());
+        }
+    }
+
+    std::printf("%zu days ok, %zu bad, %zu without checksums\n", ok, bad, unchecked);
+    if (seconds > 0.0)
+        std::printf("Checked %.1f MB in %.3f s (%.2f GB/s, crc32c %s)\n", bytes / 1e6, seconds,
+                    bytes / seconds / 1e9, crc32c_hardware() ? "hardware" : "software");
+    return bad > 0 ? 1 : 0;
+}
+
+static int cmd_calendar(int argc, char **argv)
+{
+    if (argc < 5)
+        return usage();
+
+    const std::string base_dir = argv[2];
+    const std::string symbol = argv[3];
+    const std::string timeframe = argv[4];
+
+    refresh_catalog(base_dir, symbol, timeframe);
+    auto cat = TapeCatalog::load_or_build(base_dir, symbol, timeframe);
+    const auto t0 = std::chrono::steady_clock::now();
+    auto cal = CalendarIndex::load_or_build(base_dir, symbol, timeframe, cat);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    const uint64_t slots = cal->slot_count();
+    std::printf("%s: %llu bars on %llu slots of %llus (%.1f%% filled), %zu days, %.3f s\n",
+                make_calendar_path(base_dir, symbol, timeframe).c_str(),
+                (unsigned long long)cal->bar_count(), (unsigned long long)slots,
+                (unsigned long long)(cal->step_ns() / 1000000000ull),
+                slots ? 100.0 * cal->bar_count() / slots : 0.0, cal->days().size(), seconds);
+    return 0;
+}
+
+static bool parse_field(const char *s, QueryField &out)
+{
+    static const char *const names[QUERY_FIELDS] = {"open", "high", "low", "close", "volume", "range"};
+    for (size_t i = 0; i < QUERY_FIELDS; ++i)
+    {
+        if (std::strcmp(s, names[i]) == 0)
+        {
+            out = static_cast<QueryField>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_op(const char *s, QueryOp &out)
+{
+    static const struct
+    {
+        const char *name;
+        QueryOp op;
+    } ops[] = {
+        {"gt", QueryOp::Gt}, {">", QueryOp::Gt}, {"ge", QueryOp::Ge}, {">=", QueryOp::Ge},
+        {"lt", QueryOp::Lt}, {"<", QueryOp::Lt}, {"le", QueryOp::Le}, {"<=", QueryOp::Le},
+        {"xabove", QueryOp::CrossAbove}, {"xbelow", QueryOp::CrossBelow},
+    };
+    for (const auto &o : ops)
+    {
+        if (std::strcmp(s, o.name) == 0)
+        {
+            out = o.op;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int cmd_query(int argc, char **argv)
+{
+    if (argc < 5)
+        return usage();
+
+    const std::string base_dir = argv[2];
+    const std::string symbol = argv[3];
+    const std::string timeframe = argv[4];
+
+    TapeQuerySpec spec;
+    unsigned threads = 0;
+    size_t limit = 100;
+    for (int i = 5; i < argc;)
+    {
+        const char *a = argv[i];
+        if (std::strcmp(a, "--days") == 0)
+        {
+            spec.scope = QueryScope::Days;
+            ++i;
+        }
+        else if (i + 1 < argc && std::strcmp(a, "--from") == 0)
+        {
+            spec.start_ymd = std::atoi(argv[i + 1]);
+            i += 2;
+        }
+        else if (i + 1 < argc && std::strcmp(a, "--to") == 0)
+        {
+            spec.end_ymd = std::atoi(argv[i + 1]);
+            i += 2;
+        }
+        else if (i + 1 < argc && std::strcmp(a, "--threads") == 0)
+        {
+            threads = static_cast<unsigned>(std::atoi(argv[i + 1]));
+            i += 2;
+        }
+        else if (i + 1 < argc && std::strcmp(a, "--limit") == 0)
+        {
+            limit = static_cast<size_t>(std::strtoull(argv[i + 1], nullptr, 10));
+            i += 2;
+        }
+        else
+        {
+            QueryTerm t{};
+            if (i + 2 >= argc || !parse_field(argv[i], t.field) || !parse_op(argv[i + 1], t.op))
+            {
+                std::fprintf(stderr, "Bad query term at: %s\n", a);
+                return usage();
+            }
+            t.value = std::strtod(argv[i + 2], nullptr);
+            spec.terms.push_back(t);
+            i += 3;
+        }
+    }
+    if (spec.terms.empty())
+        return usage();
+
+    refresh_catalog(base_dir, symbol, timeframe);
+    TapeQuery query(base_dir, symbol, timeframe);
+    query.set_threads(threads);
+    QueryStats st;
+    const auto matches = query.run(spec, &st);
+
+    uint64_t bars = 0;
+    for (size_t i = 0; i < matches.size(); ++i)
+    {
+        const auto &m = matches[i];
+        bars += m.bars;
+        if (i < limit)
+            std::printf("%d bars %u-%u (%u) ts %llu-%llu\n", m.ymd, m.first_bar, m.first_bar + m.bars - 1, m.bars,
+                        (unsigned long long)m.first_ts_ns, (unsigned long long)m.last_ts_ns);
+    }
+    if (matches.size() > limit)
+        std::printf("... %zu more\n", matches.size() - limit);
+    std::printf("%zu matches (%llu bars); read %zu of %zu days, %llu of %llu blocks, %llu bars in %.3f s\n",
+                matches.size(), (unsigned long long)bars, st.days_read, st.days,
+                (unsigned long long)st.blocks_read, (unsigned long long)st.blocks,
+                (unsigned long long)st.bars_read, st.seconds);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+        return usage();
+
+    try
+    {
+        const char *cmd = argv[1];
+        if (std::strcmp(cmd, "catalog") == 0)
+            return cmd_catalog(argc, argv);
+        if (std::strcmp(cmd, "convert") == 0)
+            return cmd_convert(argc, argv);
+        if (std::strcmp(cmd, "pack") == 0)
+            return cmd_pack(argc, argv);
+        if (std::strcmp(cmd, "unpack") == 0)
+            return cmd_unpack(argc, argv);
+        if (std::strcmp(cmd, "resample") == 0)
+            return cmd_resample(argc, argv);
+        if (std::strcmp(cmd, "eventbars") == 0)
+            return cmd_eventbars(argc, argv);
+        if (std::strcmp(cmd, "checksum") == 0)
+            return cmd_checksum(argc, argv);
+        if (std::strcmp(cmd, "verify") == 0)
+            return cmd_verify(argc, argv);
+        if (std::strcmp(cmd, "calendar") == 0)
+            return cmd_calendar(argc, argv);
+        if (std::strcmp(cmd, "query") == 0)
+            return cmd_query(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return usage();
+}